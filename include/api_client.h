@@ -17,12 +17,98 @@ enum class ApiError : uint8_t {
   Non200,
 };
 
-// Returns last error set by apiPing()/future API calls.
+// Connection reuse and timing of the last ping.
+struct ApiPingStats {
+  uint32_t lastConnectMs;      // TCP connect time (0 when the connection was reused)
+  uint32_t lastRequestMs;      // request sent -> response read
+  bool lastReused;
+  bool keepAlive;              // false: fell back to per-ping connections
+  uint32_t newConnections;
+  uint32_t reusedConnections;
+  uint32_t halfOpen;           // kept socket was silent; retried on a fresh one
+  uint32_t serverCloses;       // server closed the kept connection
+  uint32_t transportFallbacks; // UDP heartbeat unanswered -> HTTP
+};
+
+// Returns last error set by the last finished ping.
 ApiError apiLastError();
 
 // Returns a short constant string for the last error.
 const char* apiLastErrorText();
 
-// Sends a ping request using portalConfig().channelKey.
-// Returns true if server responded with HTTP 200.
-bool apiPing();
+// True if a failed ping is worth a quick retry: network blips (DNS, connect,
+// write, timeout, garbled reply) and 5xx except 503. Config/link problems,
+// 4xx and server throttling (429/503) are not.
+bool apiErrorRetryable(ApiError e, int httpCode);
+
+// Loads the persisted API host address and precomputes the ping request.
+// Call once after the config is loaded.
+void apiSetup();
+
+// Drops the precomputed request; the next ping rebuilds it from portalConfig().
+// Call after the channel key changes.
+void apiConfigChanged();
+
+// Starts a ping for every channel key (portalChannelKey()). Never blocks:
+// the request runs as a state machine (resolve -> connect -> send -> status
+// -> drain) advanced by apiLoop(). Extra keys follow the primary one on the
+// same connection, and the connection is kept open between pings (HTTP/1.1
+// keep-alive) while the server allows it. The result is the primary key's.
+// Returns false if the ping could not be started (error is reported to the
+// portal right away) or another ping is still in flight.
+// Exception: with NOCTUA_API_TLS the connect step blocks for the TLS
+// handshake (see apiTlsConnect()); everything else stays non-blocking.
+bool apiPingStart();
+
+// Advances the ping in flight by one bounded step. Call from main loop.
+void apiLoop();
+
+// Copies connection reuse/timing counters.
+void apiGetPingStats(ApiPingStats& out);
+
+// True while a ping is in flight.
+bool apiPingBusy();
+
+// Outcome of a finished ping (input for the ping scheduler).
+struct ApiPingResult {
+  bool ok;                // HTTP 2xx
+  int httpCode;           // 0 if no HTTP response was received
+  int32_t retryAfterS;    // Retry-After (seconds), -1 if absent
+  int32_t intervalHintS;  // X-Ping-Interval (seconds), -1 if absent
+  ApiError error;         // ApiError::None on success
+  bool retryable;         // failed, and apiErrorRetryable() says so
+};
+
+// Returns true once per finished ping.
+bool apiPingTakeResult(ApiPingResult& out);
+
+// Short constant name of the current ping phase ("idle", "connect", ...).
+const char* apiPingPhaseText();
+
+// Transport of the next ping ("http", "udp").
+const char* apiPingTransportName();
+
+// Last outcome per channel key (index as in portalChannelKey()).
+struct ApiChannelStatus {
+  bool known;          // pinged at least once since boot / config change
+  bool ok;
+  int httpCode;        // 0 = no HTTP response
+  ApiError error;
+  uint32_t lastOkMs;   // millis() of the last success, 0 = never
+  uint32_t pings;
+  uint32_t failures;
+  uint32_t holdS;      // skipped for this long (server sent Retry-After)
+  bool enabled;        // false: left out of pings (its circuit has no power)
+};
+
+uint8_t apiChannelCount();
+bool apiChannelStatus(uint8_t idx, ApiChannelStatus& out);
+
+// Leaves an extra key (idx >= 1) out of the ping cycles while disabled, so
+// the server sees that channel go silent. Used by the mains-sense inputs.
+void apiChannelSetEnabled(uint8_t idx, bool en);
+
+// Pings one extra key right away, outside the schedule (e.g. its circuit
+// just got power back). The primary ping result is not touched. Returns
+// false if the key does not exist, is disabled/held, or a ping is in flight.
+bool apiPingStartChannel(uint8_t idx);
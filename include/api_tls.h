@@ -0,0 +1,48 @@
+//api_tls.h
+#pragma once
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+// Optional TLS transport for the API ping (BearSSL).
+// Enabled with -DNOCTUA_API_TLS=1 and a pinned server key:
+//   -DNOCTUA_API_TLS_PUBKEY=\"-----BEGIN PUBLIC KEY-----\n...\n-----END PUBLIC KEY-----\n\"
+// Sessions are cached (and persisted to flash, a new ID at most hourly) so
+// most connects only need an abbreviated handshake; MFLN shrinks the record
+// buffers when the server supports it (probed once, the result persisted
+// with the session once a connect got through).
+
+#ifndef NOCTUA_API_TLS
+#define NOCTUA_API_TLS 0
+#endif
+
+struct ApiTlsStats {
+  bool enabled;
+  bool mfln;               // reduced (512 B) record buffers in use
+  bool lastResumed;
+  uint32_t lastHandshakeMs;
+  uint32_t fullHandshakes;
+  uint32_t resumedHandshakes;
+  uint32_t fullAvgMs;
+  uint32_t resumedAvgMs;
+  int lastError;           // BearSSL error of the last failed connect
+};
+
+// Loads the persisted session. Call once after the filesystem is mounted.
+void apiTlsSetup();
+
+// TCP connect + TLS handshake. Blocks loop() for the handshake (an
+// abbreviated one with a cached session), up to 5 s; the very first connect
+// also runs the MFLN probe, another blocking connect of up to 5 s.
+// No SNI: the server is identified by the pinned key.
+bool apiTlsConnect(const IPAddress& ip, uint16_t port);
+
+// True between a successful connect and apiTlsStop().
+bool apiTlsOpen();
+bool apiTlsConnected();
+size_t apiTlsAvailable();
+size_t apiTlsRead(uint8_t* buf, size_t n);
+size_t apiTlsWrite(const uint8_t* data, size_t len);
+void apiTlsStop();
+
+void apiTlsGetStats(ApiTlsStats& out);
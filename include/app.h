@@ -1,5 +0,0 @@
-#pragma once
-
-// Application entry points called from Arduino setup()/loop().
-void appSetup();
-void appLoop();
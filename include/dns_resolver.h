@@ -0,0 +1,50 @@
+//dns_resolver.h
+#pragma once
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+// Non-blocking resolver for the API host.
+// - Queries the DHCP-provided DNS servers and public fallbacks in parallel
+//   over raw UDP; the first valid answer wins.
+// - Honors the record TTL; an expired address keeps being served (stale)
+//   while a refresh runs in the background.
+// - The last good address is persisted to flash, so even the first ping
+//   after boot does not depend on DNS.
+// - An IP-literal host is used as is: always fresh, never looked up.
+
+enum class DnsCacheState : uint8_t {
+  None = 0,  // nothing known yet (lookup may be running)
+  Fresh,
+  Stale,     // TTL expired or address failed; refresh in progress/pending
+};
+
+struct DnsResolverStats {
+  IPAddress ip;
+  IPAddress server;     // resolver that answered last
+  uint32_t ttlLeftS;
+  uint32_t lastLookupMs;
+  uint32_t lookups;
+  uint32_t failures;
+  bool stale;
+};
+
+// Sets the host name and loads the persisted address (or takes an IP
+// literal as is). Call once.
+void dnsResolverSetup(const char* host);
+
+// Drives retransmits/timeouts. Call from main loop.
+void dnsResolverLoop();
+
+// Returns the cached address (if any). A stale or missing entry starts a
+// background refresh.
+DnsCacheState dnsResolverGet(IPAddress& out);
+
+// Marks the cached address stale (e.g. connect failed) and refreshes it.
+// The old address is still served until a new one arrives.
+void dnsResolverInvalidate();
+
+// True while queries are in flight.
+bool dnsResolverBusy();
+
+void dnsResolverGetStats(DnsResolverStats& out);
@@ -0,0 +1,59 @@
+//heartbeat_wire.h
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Wire format and retransmit schedule of the UDP heartbeat (layout in
+// udp_heartbeat.h). No dependency on Arduino, lwIP or BearSSL, so it also
+// builds on a host: the caller supplies the MAC function.
+
+static const size_t HB_LEN = 42;
+static const size_t HB_MAC_AT = 26;
+static const size_t HB_ACK_LEN = 34;
+static const size_t HB_ACK_MAC_AT = 18;
+static const size_t HB_MAC_LEN = 16;
+static const size_t HB_KEY_ID_LEN = 8;
+
+// HMAC-SHA-256(channel key, data), truncated to HB_MAC_LEN bytes.
+typedef void (*HbMacFn)(const uint8_t* data, size_t len, uint8_t* out);
+
+struct HbAck {
+  uint8_t status;        // 0 ok, 1 unknown key, 2 throttled, 3 server error
+  uint16_t intervalS;    // 0 = no hint
+  uint16_t retryAfterS;  // 0 = none
+};
+
+// Fixed part of a heartbeat ("NHB1") or last gasp ("NLG1").
+void hbWireInit(uint8_t* pkt, const char* magic, uint8_t flags, uint32_t nonce,
+                const uint8_t* keyId);
+
+// Fills in seq and uptime and appends the MAC.
+void hbWireSeal(uint8_t* pkt, uint32_t seq, uint32_t uptimeS, HbMacFn mac);
+
+// True for a well-formed "NHA1" ack of (nonce, seq) with a valid MAC
+// (compared in constant time).
+bool hbWireParseAck(const uint8_t* buf, size_t len, uint32_t nonce, uint32_t seq, HbMacFn mac,
+                    HbAck& out);
+
+// Ack wait: the first timeout doubles per retransmit, the same seq is sent
+// at most HB_MAX_SENDS times (0, 600, 1800 ms; gives up at 4200 ms).
+static const uint32_t HB_ACK_TIMEOUT_MS = 600;
+static const uint8_t HB_MAX_SENDS = 3;
+
+enum class HbRetxAction : uint8_t {
+  Wait = 0,
+  Resend,  // send the same datagram again now
+  GiveUp,
+};
+
+struct HbRetransmit {
+  uint8_t sends;
+  uint32_t lastTxMs;
+  uint32_t waitMs;
+};
+
+// The first transmission went out at nowMs.
+void hbRetxStart(HbRetransmit& r, uint32_t nowMs);
+
+HbRetxAction hbRetxPoll(HbRetransmit& r, uint32_t nowMs);
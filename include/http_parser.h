@@ -0,0 +1,85 @@
+//http_parser.h
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Incremental HTTP/1.x response parser.
+// Works on whatever chunks the socket delivers (no per-byte reads, no
+// delays) and keeps no dependency on Arduino, so it also builds on a host.
+//
+// Parses the status line, the headers we care about (Content-Length,
+// Transfer-Encoding: chunked, Connection, Retry-After, X-Ping-Interval)
+// and captures a bounded head of the body into a caller-provided buffer
+// while draining the rest according to the framing.
+class HttpResponseParser {
+ public:
+  enum class State : uint8_t {
+    StatusLine = 0,
+    Headers,
+    Body,        // Content-Length or read-to-EOF body
+    ChunkSize,
+    ChunkData,
+    ChunkEnd,    // CRLF after chunk data
+    Trailers,
+    Done,
+    Error,
+  };
+
+  // bodyBuf (optional) receives up to bodyCap-1 body bytes, NUL-terminated.
+  void reset(char* bodyBuf = nullptr, size_t bodyCap = 0);
+
+  // Consumes bytes; returns how many were used. Stops early only when the
+  // response is complete (Done) or malformed (Error); the remainder
+  // belongs to the next response.
+  size_t feed(const uint8_t* data, size_t len);
+
+  // Peer closed the connection: completes a read-to-EOF body.
+  void finishEof();
+
+  State state() const { return _state; }
+  bool done() const { return _state == State::Done; }
+  bool failed() const { return _state == State::Error; }
+  bool headersDone() const { return _state >= State::Body && _state != State::Error; }
+
+  int statusCode() const { return _status; }
+  int32_t contentLength() const { return _contentLength; }  // -1 if absent
+  bool chunked() const { return _chunked; }
+  bool connectionClose() const { return _close; }
+  int32_t retryAfterS() const { return _retryAfterS; }      // -1 if absent/unparsed
+  int32_t intervalHintS() const { return _intervalHintS; }  // X-Ping-Interval, -1 if absent
+
+  // True if the end of the body is known without closing the connection.
+  bool framed() const { return _chunked || _contentLength >= 0 || !_hasBody; }
+
+  // Body bytes seen so far (captured or not).
+  uint32_t bodyBytes() const { return _bodyBytes; }
+  size_t bodyCaptured() const { return _bodyLen; }
+
+ private:
+  bool lineByte(uint8_t c);  // returns true when a full line is in _line
+  void onStatusLine();
+  void onHeaderLine();
+  void onHeadersEnd();
+  void captureBody(const uint8_t* data, size_t n);
+
+  State _state = State::StatusLine;
+  char _line[128];
+  size_t _lineLen = 0;
+
+  int _status = 0;
+  int32_t _contentLength = -1;
+  int32_t _retryAfterS = -1;
+  int32_t _intervalHintS = -1;
+  bool _chunked = false;
+  bool _close = false;
+  bool _http10 = false;
+  bool _hasBody = true;
+
+  uint32_t _remaining = 0;  // Content-Length or current chunk
+  uint32_t _bodyBytes = 0;
+
+  char* _bodyBuf = nullptr;
+  size_t _bodyCap = 0;
+  size_t _bodyLen = 0;
+};
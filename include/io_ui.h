@@ -6,9 +6,12 @@
 // Initializes LED and BOOT button GPIO.
 void ioSetup(int ledPin, bool ledActiveLow, int bootPin);
 
-// Returns true on BOOT button press edge (debounced).
+// Returns true once per short BOOT press (debounced, fires on release).
 bool ioBootPressedOnce();
 
+// Returns true once when BOOT has been held for the long-press time.
+bool ioBootLongPressedOnce();
+
 // Call from the main loop to update LED state machine.
 void ioLoop();
 
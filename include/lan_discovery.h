@@ -0,0 +1,50 @@
+//lan_discovery.h
+#pragma once
+
+#include <Arduino.h>
+
+#include "api_client.h"
+
+// LAN discovery, so a fleet tool can find every unit without scanning:
+//
+// - mDNS responder (224.0.0.251:5353): noctua-<chip id>.local (A) and an
+//   _http._tcp service "noctua-<chip id>" (PTR/SRV/TXT, also listed under
+//   _services._dns-sd._udp). TXT: id, fw (build), ping, inet.
+//   Multicast queries only (no legacy unicast / probing: names are unique
+//   by chip id).
+//
+// - Discovery protocol (UDP NOCTUA_DISCOVERY_PORT, default 7711):
+//     query:  "NDQ1" (broadcast by the tool; anything after it is ignored)
+//     reply:  "NDR1" + one JSON object, unicast to the sender after a
+//             0..250 ms random delay (spreads a fleet's answers)
+//     beacon: the same "NDR1" datagram broadcast on Wi-Fi up and every
+//             NOCTUA_DISCOVERY_BEACON_S seconds (0 = no beacons)
+//   JSON: {"id","host","ip","fw","ping","inet","rssi","up_s","channels"}
+//
+// All replies are precomputed (double-buffered, rebuilt when the state
+// changes or at most every 10 s for rssi/uptime); a query only queues a
+// send of the current buffer. Disabled with -DNOCTUA_LAN_DISCOVERY=0.
+
+struct LanDiscoveryStats {
+  bool enabled;
+  uint32_t mdnsQueries;    // questions that matched one of our names
+  uint32_t mdnsReplies;
+  uint32_t queries;        // NDQ1 received
+  uint32_t replies;        // NDR1 sent (replies + beacons)
+  uint32_t rebuilds;       // precomputed packets rebuilt
+};
+
+// Opens the sockets and names the unit. Call once.
+void lanDiscoverySetup();
+
+// Feeds the outcome of a finished ping (TXT/JSON status).
+void lanDiscoveryNotePing(const ApiPingResult& r);
+
+// Joins/leaves the mDNS group on Wi-Fi transitions, sends queued replies
+// and beacons. Call from main loop.
+void lanDiscoveryLoop(bool wifiUp, bool internetKnown, bool internetUp);
+
+// "noctua-abcdef" (no ".local").
+const char* lanDiscoveryHostName();
+
+void lanDiscoveryGetStats(LanDiscoveryStats& out);
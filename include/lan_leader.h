@@ -0,0 +1,81 @@
+//lan_leader.h
+#pragma once
+
+#include <Arduino.h>
+
+#include "api_client.h"
+#include "leader_election.h"
+
+// LAN leader election for units that share the same channel keys (sites
+// with a redundant second unit): one leader pings, the others only watch
+// it and skip their scheduled pings while it is alive.
+//
+// Every unit multicasts a hello (NOCTUA_LEADER_GROUP:NOCTUA_LEADER_PORT,
+// TTL 1) every NOCTUA_LEADER_HELLO_S seconds, at once when its role changes
+// and, at most once a second, to a unit that has not heard it lately
+// (62 bytes, big-endian):
+//   "NLE2" | flags (bit0: leader, bit1: healthy) | echo count |
+//   group id[8] | chip id[4] | boot nonce[4] | seq[4] | challenge[4] |
+//   echo[4][4] | mac[16]
+// group id = SHA-256 of all channel keys ('\n'-joined)[0..8): only units
+// with identical key sets form a group. mac = HMAC-SHA-256(primary channel
+// key, preceding bytes), truncated to 16 bytes.
+//
+// Freshness: each scheduled hello carries a new random challenge, and every
+// hello echoes the latest challenge heard from each peer. A hello counts
+// only if it echoes one of our challenges, and the sender stays live for
+// 4.5 hellos from when we issued that challenge: a recorded hello, even
+// from an earlier boot, cannot keep a unit alive past that. (nonce, seq)
+// stops an older hello of the same boot from rolling its state back.
+//
+// Election: "healthy" (fewer than 2 failed pings in a row, supply OK) beats
+// unhealthy, then the lower chip id wins. A leader keeps its role against
+// newcomers (a rebooted unit follows the incumbent). It yields to a better
+// leader after a partition heals, when its own pings fail and a healthy
+// unit is around, or at once when it can no longer ping (supply failing).
+// A follower whose leader went silent takes over and pings right away,
+// 3.5 to 4.5 hellos after the last one: at most 67.5 s by default, under
+// one ping interval.
+//
+// Fails safe: a unit skips pings only while it hears a live leader, so a
+// lost, forged or replayed hello can cost at most a missed heartbeat (an
+// alarm), never hide an outage. Disabled with -DNOCTUA_LEADER_ELECTION=0.
+
+struct LanLeaderStats {
+  bool enabled;
+  LeaderRole role;
+  uint32_t leaderId;   // chip id of the leader (own id when leading), 0 = none
+  uint8_t peers;       // live units of the group besides this one
+  uint32_t elections;  // times this unit became leader
+  uint32_t takeovers;  // ... from a lost, failing or resigning leader
+  uint32_t skipped;    // scheduled pings left to the leader
+  uint32_t sent;       // hellos
+  uint32_t received;   // valid hellos of our group
+  uint32_t rejected;   // bad MAC / replayed within a challenge's lifetime
+};
+
+// Opens the socket and derives the group from the channel keys. Call once.
+void lanLeaderSetup();
+
+// Channel keys changed: new group, election starts over.
+void lanLeaderConfigChanged();
+
+// Feeds the outcome of a finished ping (health flag).
+void lanLeaderNotePing(const ApiPingResult& r);
+
+// Joins/leaves the group on Wi-Fi transitions, runs the election and sends
+// hellos. canLead: this unit is able to ping (supply OK). Call from main loop.
+void lanLeaderLoop(bool wifiUp, bool canLead);
+
+// True if a live leader pings for this unit: the scheduled ping is skipped
+// (and counted).
+bool lanLeaderSkipPing();
+
+// Returns true once after this unit took over from another leader: the
+// caller pings right away instead of waiting for its slot.
+bool lanLeaderTakeTakeover();
+
+// "off", "listening", "leader", "follower".
+const char* lanLeaderRoleText(LeaderRole role);
+
+void lanLeaderGetStats(LanLeaderStats& out);
@@ -0,0 +1,122 @@
+//leader_election.h
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// LAN leader election state machine and hello format (wire layout and rules
+// in lan_leader.h). No dependency on Arduino, lwIP or BearSSL, so several
+// instances can run on a host: the caller passes the time and supplies the
+// MAC, the socket and the random source.
+
+// Failover takes 3.5 to 4.5 hellos; keep it under one ping interval (90 s).
+#ifndef NOCTUA_LEADER_HELLO_S
+#define NOCTUA_LEADER_HELLO_S 15
+#endif
+
+static const uint32_t LEADER_HELLO_MS = NOCTUA_LEADER_HELLO_S * 1000UL;
+static const uint32_t LEADER_HELLO_JITTER_MS = LEADER_HELLO_MS / 10;
+// A peer is live this long after we issued the challenge it last echoed.
+static const uint32_t LEADER_LIVE_MS = LEADER_HELLO_MS * 4 + LEADER_HELLO_MS / 2;
+static const uint32_t LEADER_LISTEN_MS = 3000;  // peers answer a newcomer at once
+static const uint32_t LEADER_REPLY_GAP_MS = 1000;  // at most one out-of-turn hello a second
+
+static const uint8_t LEADER_MAX_PEERS = 4;
+// Own challenges still accepted in an echo: one per hello over LIVE_MS.
+static const uint8_t LEADER_CHALLENGES = 6;
+
+static const size_t LEADER_HELLO_LEN = 62;
+static const size_t LEADER_MAC_AT = 46;
+static const size_t LEADER_MAC_LEN = 16;
+static const size_t LEADER_GROUP_ID_LEN = 8;
+
+// HMAC-SHA-256(primary channel key, data), truncated to LEADER_MAC_LEN bytes.
+typedef void (*LeaderMacFn)(const uint8_t* data, size_t len, uint8_t* out);
+// Multicasts one hello; false if it could not be sent.
+typedef bool (*LeaderSendFn)(const uint8_t* pkt, size_t len);
+typedef uint32_t (*LeaderRandomFn)();
+
+enum class LeaderRole : uint8_t {
+  Off = 0,    // no Wi-Fi / no channel key
+  Listening,  // just joined: waiting for a leader to answer
+  Leader,
+  Follower,
+};
+
+struct LeaderPeer {
+  bool used;
+  bool fresh;          // heardMs, flags, nonce and seq are known
+  uint32_t id;
+  uint32_t challenge;  // latest heard from it: echoed in our hellos
+  uint32_t nonce;
+  uint32_t seq;
+  uint32_t heardMs;    // when we issued the newest challenge it echoed
+  uint8_t flags;
+};
+
+struct LeaderChallenge {
+  bool used;
+  uint32_t value;
+  uint32_t issuedMs;
+};
+
+struct LeaderElection {
+  uint32_t id;      // chip id
+  uint32_t nonce;   // per boot
+  uint8_t groupId[LEADER_GROUP_ID_LEN];
+  LeaderMacFn mac;
+  LeaderSendFn send;
+  LeaderRandomFn random;
+
+  LeaderRole role;
+  uint32_t leaderId;  // own id when leading, 0 = none
+  LeaderPeer peers[LEADER_MAX_PEERS];
+  LeaderChallenge challenges[LEADER_CHALLENGES];
+  uint8_t nextChallenge;
+  uint32_t seq;
+
+  uint32_t listenUntilMs;
+  uint32_t noLeaderSinceMs;
+  uint32_t helloAtMs;
+  uint32_t replyMs;
+  bool helloNow;      // role or health changed: send at once
+  bool replyPending;  // a peer has not heard us lately: send after the gap
+  bool takeover;
+  bool canLead;
+  uint8_t failStreak;
+
+  uint8_t livePeers;
+  uint32_t elections;
+  uint32_t takeovers;
+  uint32_t skipped;
+  uint32_t sent;
+  uint32_t received;
+  uint32_t rejected;
+};
+
+// Clears everything; role Off. groupId may be set later (config change).
+void leaderInit(LeaderElection& e, uint32_t id, uint32_t nonce, LeaderMacFn mac,
+                LeaderSendFn send, LeaderRandomFn random);
+
+// Joined the group (or it changed): forget peers and challenges, listen and
+// announce ourselves.
+void leaderStart(LeaderElection& e, uint32_t nowMs);
+
+// Left the group: role Off.
+void leaderStop(LeaderElection& e);
+
+// Outcome of a finished ping (health flag).
+void leaderNotePing(LeaderElection& e, bool ok);
+
+// A datagram from the group address; anything but a valid hello of our
+// group is ignored.
+void leaderRecv(LeaderElection& e, const uint8_t* buf, size_t len, uint32_t nowMs);
+
+// Runs the election and sends due hellos. canLead: able to ping (supply OK).
+void leaderLoop(LeaderElection& e, uint32_t nowMs, bool canLead);
+
+// True (and counted) if a live leader pings for this unit.
+bool leaderSkipPing(LeaderElection& e, uint32_t nowMs);
+
+// True once after this unit took over from another leader.
+bool leaderTakeTakeover(LeaderElection& e);
@@ -0,0 +1,49 @@
+//mains_sense.h
+#pragma once
+
+#include <Arduino.h>
+
+// Optional mains-sense inputs: one GPIO per monitored circuit, driven by an
+// optocoupler (level: active while the circuit has power) or a zero-cross
+// detector (pulses at 100 Hz while the circuit has power).
+// Enabled with -DNOCTUA_MAINS_SENSE_PINS=5,4 (GPIO0..15).
+//
+// Edges are timestamped in the GPIO interrupt and handed to the main loop
+// through a single-producer/single-consumer queue (no locks, no allocation);
+// the loop debounces them into state-change events. Each input reports to
+// a fixed extra channel key slot: the n-th entry of NOCTUA_MAINS_SENSE_PINS
+// -> extraChannelKeys[n] (see portalExtraChannelIndex()). Entries beyond
+// NOCTUA_EXTRA_CHANNEL_KEYS are refused at setup.
+
+struct MainsEvent {
+  uint8_t input;
+  uint8_t slot;     // extra channel key slot
+  bool powered;
+  uint32_t atMs;  // millis() of the first edge of the new state
+};
+
+struct MainsInputStatus {
+  uint8_t pin;
+  uint8_t slot;     // extra channel key slot
+  bool known;       // a debounced state exists
+  bool powered;
+  uint32_t changedMs;
+  uint32_t changes;
+};
+
+// Configures the pins and attaches the interrupts. Call once.
+void mainsSenseSetup();
+
+// Drains the edge queue and debounces. Call from main loop.
+void mainsSenseLoop();
+
+// Number of configured inputs (0 = feature off).
+uint8_t mainsSenseInputs();
+
+bool mainsSenseGet(uint8_t input, MainsInputStatus& out);
+
+// Next debounced state change (the first known state counts as one).
+bool mainsSenseTakeEvent(MainsEvent& out);
+
+// Edges lost to a full queue (the loop then resyncs from the pin level).
+uint32_t mainsSenseDropped();
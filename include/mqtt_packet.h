@@ -0,0 +1,70 @@
+//mqtt_packet.h
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// MQTT 3.1.1 codec for the publisher: the packets it sends (CONNECT with a
+// retained will, retained QoS 0 PUBLISH, PINGREQ) and a byte-wise reader
+// for what comes back. Keeps no dependency on Arduino, so it also builds on
+// a host.
+
+// Control packet types (high nibble of the first byte).
+static const uint8_t MQTT_CONNECT = 0x10;
+static const uint8_t MQTT_CONNACK = 0x20;
+static const uint8_t MQTT_PUBLISH_RETAIN = 0x31;  // QoS 0, retain
+static const uint8_t MQTT_PINGREQ = 0xC0;
+static const uint8_t MQTT_PINGRESP = 0xD0;
+
+// Builders leave room for the longest fixed header in front of the body.
+static const size_t MQTT_HEADER_MAX = 5;
+
+struct MqttConnectOptions {
+  const char* clientId;
+  const char* willTopic;  // will: QoS 0, retained
+  const char* willMessage;
+  const char* user;       // "" = anonymous; the password is only sent with a user
+  const char* pass;
+  uint16_t keepAliveS;
+};
+
+// Remaining-length encoding (1..4 bytes); returns the bytes written.
+size_t mqttPutLength(uint8_t* p, size_t len);
+
+// Writes the fixed header in front of a body built at buf + MQTT_HEADER_MAX
+// and moves the body down to follow it. Returns the packet length.
+size_t mqttFrame(uint8_t* buf, uint8_t type, size_t bodyLen);
+
+// Packet builders: return the packet length, 0 if it does not fit in cap.
+size_t mqttBuildConnect(uint8_t* buf, size_t cap, const MqttConnectOptions& o);
+size_t mqttBuildPublish(uint8_t* buf, size_t cap, const char* topic, const char* payload);
+size_t mqttBuildPingReq(uint8_t* buf, size_t cap);
+
+// Incoming packets, one byte at a time. Only the first two body bytes are
+// kept (CONNACK flags/return code); the rest is skipped.
+class MqttPacketReader {
+ public:
+  void reset();
+
+  // True when c completed a packet (type()/length()/body() describe it
+  // until the next push).
+  bool push(uint8_t c);
+
+  // Remaining length longer than 4 bytes: the stream cannot be resynced.
+  bool failed() const { return _stage == Stage::Error; }
+
+  uint8_t type() const { return _type; }
+  uint32_t length() const { return _len; }
+  const uint8_t* body() const { return _body; }
+  size_t bodyKept() const { return _got < sizeof(_body) ? _got : sizeof(_body); }
+
+ private:
+  enum class Stage : uint8_t { Type = 0, Length, Body, Error };
+
+  Stage _stage = Stage::Type;
+  uint8_t _type = 0;
+  uint32_t _len = 0;
+  uint8_t _shift = 0;
+  uint32_t _got = 0;
+  uint8_t _body[2] = {0, 0};
+};
@@ -0,0 +1,50 @@
+//mqtt_publisher.h
+#pragma once
+
+#include <Arduino.h>
+
+#include "api_client.h"
+
+// Optional MQTT 3.1.1 publisher: pushes the device state to a (local) broker
+// so home-automation/NOC systems do not have to poll /status.json.
+// Enabled with -DNOCTUA_MQTT_HOST="\"192.168.1.10\"" (IP literal).
+//
+// Topics under <NOCTUA_MQTT_PREFIX>/<chip id>/, all retained, QoS 0,
+// published only when the value changes:
+//   status      "online" / "offline" (last will)
+//   wifi        BSSID of the access point in use
+//   rssi        dBm (only on a change of 5 dB or more, at most once a minute)
+//   internet    "up" / "down" / "unknown"
+//   ping        "ok" / "fail" / "none"
+//   ping_error  "HTTP 403" / "dns failed" ... (empty after a good ping)
+//   uptime      seconds (every 5 min)
+//
+// Pending topics wait in a bounded FIFO (one slot per topic; a newer value
+// replaces the queued one), so a broker outage never grows memory.
+// Never blocks: connect, CONNACK, publishes and keep-alive run as a state
+// machine from mqttLoop(); failed connects back off exponentially. The
+// packet codec lives in mqtt_packet.
+
+struct MqttStats {
+  bool enabled;
+  bool connected;
+  uint32_t connects;     // CONNACK accepted
+  uint32_t disconnects;  // lost after being connected
+  uint32_t publishes;
+  uint32_t backoffMs;    // current reconnect delay
+  char error[24];        // last failure ("" if none)
+};
+
+// Builds the topic base and client id. Call once.
+void mqttSetup();
+
+// Feeds the outcome of a finished ping.
+void mqttNotePing(const ApiPingResult& r);
+
+// Tracks state and advances the connection. Call from main loop.
+void mqttLoop(bool wifiUp, bool internetKnown, bool internetUp);
+
+// True if a broker address is configured.
+bool mqttConfigured();
+
+void mqttGetStats(MqttStats& out);
@@ -0,0 +1,55 @@
+//net_diag.h
+#pragma once
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+#include "api_client.h"
+
+// Per-hop fault classification for failed pings.
+// Each Internet probe round (net_probe) also checks the first hops:
+// - gateway: one ICMP echo; a router that drops ICMP still counts as up when
+//   an Internet target answered through it
+// - DNS server: one root query to the DHCP-provided resolver
+// Combined with the probe verdict and the last ping result, a failure is
+// blamed on the LAN, the WAN (ISP), DNS, or the API server.
+
+enum class NetFault : uint8_t {
+  None = 0,  // last ping succeeded
+  Unknown,   // not enough evidence yet
+  Lan,       // Wi-Fi / gateway unreachable
+  Wan,       // gateway fine, Internet targets unreachable
+  Dns,       // Internet fine, resolver broken and the ping needed it
+  Api,       // Internet fine, the API server failed
+};
+
+struct NetDiagStats {
+  IPAddress gateway;
+  IPAddress dns;
+  int32_t gwRttMs;   // ICMP echo round trip, -1 = no reply
+  int32_t dnsRttMs;  // resolver round trip, -1 = no (usable) reply
+  int32_t wanMs;     // first Internet target connect time, -1 = none
+  uint32_t runs;
+};
+
+// Starts the gateway/DNS probes (called when a probe round starts).
+void netDiagStart();
+
+// Collects replies / timeouts. Called from netProbeLoop().
+void netDiagLoop();
+
+// Link changed: forget hop results.
+void netDiagReset();
+
+// Internet verdict of the round (wanMs = -1 when not measured).
+void netDiagNoteWan(bool up, int32_t wanMs);
+
+// Result of the last ping.
+void netDiagNotePing(const ApiPingResult& r);
+
+NetFault netDiagFault();
+
+void netDiagGetStats(NetDiagStats& out);
+
+// Short constant name ("lan", "wan", ...).
+const char* netDiagFaultText(NetFault f);
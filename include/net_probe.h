@@ -0,0 +1,61 @@
+//net_probe.h
+#pragma once
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+// Internet reachability verdict for the portal and the outage journal.
+// - Recent traffic that got an answer (an API ping) is passive evidence:
+//   no probe is sent while it is fresh.
+// - Otherwise non-blocking TCP connects go to several public targets in
+//   parallel; the first success decides "up", and the round stays open a
+//   short grace for a second answer ("high"). One blocked provider no
+//   longer reads as "no route".
+// - The verdict is published via portalSetInternetStatus() with a
+//   confidence level.
+
+enum class NetConfidence : uint8_t {
+  None = 0,  // no verdict yet
+  Low,       // one signal: a single probe target answered / all targets failed
+  High,      // real traffic answered, or several targets / signals agree
+};
+
+enum class NetEvidence : uint8_t {
+  None = 0,
+  Passive,   // recent API traffic
+  Probe,     // active connects
+};
+
+struct NetProbeStats {
+  uint32_t probes;        // active probe rounds
+  uint32_t passiveSkips;  // rounds answered by passive evidence
+  uint32_t failedRounds;  // rounds where no target answered
+  uint32_t lastProbeMs;   // duration of the last round
+  IPAddress lastTarget;   // first target that answered last time (0.0.0.0 if none)
+};
+
+// Link changed: drop the verdict (portal shows "unknown") and re-check soon.
+void netProbeReset();
+
+// Passive evidence. answered = a server replied to our traffic; false = a
+// request went unanswered (triggers an early re-check).
+void netProbeNoteTraffic(bool answered);
+
+// Drives the probe. linkUp = STA connected and not reconfiguring;
+// holdOff = don't start a new round (a ping in flight will bring evidence).
+// Never blocks. Call from main loop.
+void netProbeLoop(bool linkUp, bool holdOff);
+
+bool netProbeKnown();
+bool netProbeUp();
+NetConfidence netProbeConfidence();
+NetEvidence netProbeEvidence();
+
+// True while connects are in flight.
+bool netProbeBusy();
+
+void netProbeGetStats(NetProbeStats& out);
+
+// Short constant names ("high", "passive", ...).
+const char* netProbeConfidenceText(NetConfidence c);
+const char* netProbeEvidenceText(NetEvidence e);
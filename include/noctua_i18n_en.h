@@ -29,10 +29,12 @@
 // Home page
 #define NOCTUA_I18N_HOME_SUBTITLE_PREFIX F("Svitlobot Service Monitor · Uptime: ")
 #define NOCTUA_I18N_HOME_STATUS_PREFIX_HTML F("<b>Status:</b> ")
+#define NOCTUA_I18N_HOME_CHANNELS_PREFIX_HTML F("<b>Channels:</b> ")
 
 #define NOCTUA_I18N_API_WAITING F("Waiting")
 #define NOCTUA_I18N_API_OK F("Ok")
 #define NOCTUA_I18N_API_FAIL F("Fail")
+#define NOCTUA_I18N_API_BUSY F("Pinging")
 
 #define NOCTUA_I18N_BTN_CONFIGURE F("Configure")
 
@@ -78,8 +80,13 @@
 #define NOCTUA_I18N_PLACEHOLDER_REPEAT_PASSWORD F("(repeat password)")
 
 #define NOCTUA_I18N_LABEL_CHANNEL_KEY F("Channel key")
+#define NOCTUA_I18N_LABEL_EXTRA_CHANNEL_KEYS F("Additional channel keys")
 #define NOCTUA_I18N_LABEL_LED F("LED")
 #define NOCTUA_I18N_LED_ENABLED F("LED enabled")
+#define NOCTUA_I18N_LABEL_POWER_PROFILE F("Power profile")
+#define NOCTUA_I18N_POWER_PERFORMANCE F("Performance")
+#define NOCTUA_I18N_POWER_BALANCED F("Balanced (modem sleep)")
+#define NOCTUA_I18N_POWER_LOW F("Low power (light sleep)")
 
 #define NOCTUA_I18N_BTN_SAVE F("Save")
 #define NOCTUA_I18N_BTN_CANCEL F("Cancel")
@@ -29,10 +29,12 @@
 // Home page
 #define NOCTUA_I18N_HOME_SUBTITLE_PREFIX F("Монітор сервісу Svitlobot · Час роботи: ")
 #define NOCTUA_I18N_HOME_STATUS_PREFIX_HTML F("<b>Статус:</b> ")
+#define NOCTUA_I18N_HOME_CHANNELS_PREFIX_HTML F("<b>Канали:</b> ")
 
 #define NOCTUA_I18N_API_WAITING F("Очікування")
 #define NOCTUA_I18N_API_OK F("Ок")
 #define NOCTUA_I18N_API_FAIL F("Помилка")
+#define NOCTUA_I18N_API_BUSY F("Пінг")
 
 #define NOCTUA_I18N_BTN_CONFIGURE F("Налаштування")
 
@@ -78,8 +80,13 @@
 #define NOCTUA_I18N_PLACEHOLDER_REPEAT_PASSWORD F("(повторіть пароль)")
 
 #define NOCTUA_I18N_LABEL_CHANNEL_KEY F("Ключ каналу")
+#define NOCTUA_I18N_LABEL_EXTRA_CHANNEL_KEYS F("Додаткові ключі каналів")
 #define NOCTUA_I18N_LABEL_LED F("Світлодіод")
 #define NOCTUA_I18N_LED_ENABLED F("Світлодіод увімкнено")
+#define NOCTUA_I18N_LABEL_POWER_PROFILE F("Профіль живлення")
+#define NOCTUA_I18N_POWER_PERFORMANCE F("Продуктивність")
+#define NOCTUA_I18N_POWER_BALANCED F("Збалансований (modem sleep)")
+#define NOCTUA_I18N_POWER_LOW F("Економний (light sleep)")
 
 #define NOCTUA_I18N_BTN_SAVE F("Зберегти")
 #define NOCTUA_I18N_BTN_CANCEL F("Скасувати")
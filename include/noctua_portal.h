@@ -7,14 +7,26 @@
 // Types
 // ============================================================
 
+// Extra channel keys per device (e.g. building + entrance channels), pinged
+// in the same connection cycle as the primary key.
+#ifndef NOCTUA_EXTRA_CHANNEL_KEYS
+#define NOCTUA_EXTRA_CHANNEL_KEYS 3
+#endif
+
+static const uint8_t MAX_CHANNEL_KEYS = 1 + NOCTUA_EXTRA_CHANNEL_KEYS;
+
 struct NoctuaConfig {
   char wifiSsid[33];
   char wifiPass[65];
   char channelKey[65];
+  char extraChannelKeys[NOCTUA_EXTRA_CHANNEL_KEYS][65];  // "" = unused
   char adminPass[65];
 
   // If true, LED is completely disabled (off in all modes).
   bool ledDisabled;
+
+  // Power profile (see PowerProfile in power.h). 0 = Performance.
+  uint8_t powerProfile;
 };
 
 // ============================================================
@@ -34,6 +46,15 @@ bool portalHasStaConfig();
 // Returns true if application configuration is present (channel key).
 bool portalHasAppConfig();
 
+// Channel keys in ping order: the primary key first, then the extra ones
+// (empty and duplicate entries skipped). 0 if no primary key is set.
+uint8_t portalChannelKeyCount();
+const char* portalChannelKey(uint8_t idx);  // "" if out of range
+
+// Ping index (as above) of extraChannelKeys[slot]; -1 if the slot is empty,
+// repeats an earlier key, or there is no primary key.
+int8_t portalExtraChannelIndex(uint8_t slot);
+
 // ============================================================
 // Config persistence
 // ============================================================
@@ -45,6 +66,9 @@ bool portalLoadConfig(NoctuaConfig& cfg);
 // Save config to filesystem.
 bool portalSaveConfig(const NoctuaConfig& cfg);
 
+// Result of the config load done by portalSetup() (same as portalLoadConfig()).
+bool portalConfigLoaded();
+
 // ============================================================
 // Runtime config apply (no reboot)
 // ============================================================
@@ -78,11 +102,19 @@ void portalSetHostReachable(bool ok);
 
 // Updates "Internet" status shown in portal pages.
 // Semantics: basic outbound connectivity (separate from API host reachability).
-void portalSetInternetStatus(bool ok);
+// confidence: NetConfidence (net_probe.h), 0 = not given.
+void portalSetInternetStatus(bool ok, uint8_t confidence = 0);
 
 // Clears Internet status to "unknown".
 void portalClearInternetStatus();
 
+// Worst-case loop() pass time: overall since boot, and during the last ping.
+void portalSetLoopTiming(uint32_t maxUs, uint32_t maxDuringPingUs);
+
+// Boot latency: cold = power-on fast path taken; ms since boot until the first
+// IP / first successful ping (0 = not yet).
+void portalSetBootTiming(bool cold, uint32_t toIpMs, uint32_t toPingMs);
+
 // ============================================================
 // Portal / Web / AP lifecycle
 // ============================================================
@@ -101,3 +133,17 @@ void portalStopAP();
 
 // Returns true if AP is currently running.
 bool portalIsAPRunning();
+
+// Sets the soft AP channel (1..13). If the AP is running on another channel
+// it is moved right away. Returns true if a running AP was moved.
+bool portalSetApChannel(uint8_t ch);
+
+// Channel the soft AP uses (or will use on start).
+uint8_t portalApChannel();
+
+// Returns true while someone is using the portal (AP station associated or
+// an HTTP request was served recently).
+bool portalHasActiveClient();
+
+// Firmware build id shown in the footer (build date and time).
+const char* portalFirmwareVersion();
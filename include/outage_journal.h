@@ -0,0 +1,51 @@
+//outage_journal.h
+#pragma once
+
+#include <Arduino.h>
+
+// Compact journal of power-on, Wi-Fi-loss and Internet-loss intervals.
+// Survives soft resets (RTC memory) and power cycles (flash checkpoint), so
+// the time a unit was really powered can be reported after the fact.
+// Closed intervals are uploaded in batches on the first healthy connection
+// (see NOCTUA_OUTAGE_UPLOAD_HOST).
+
+enum class OutageKind : uint8_t {
+  None = 0,
+  PowerOn,       // boot .. last time the unit was seen alive
+  WifiLoss,      // STA link down
+  InternetLoss,  // Wi-Fi up, outbound probe failing
+};
+
+// Restores the journal and opens this boot's PowerOn interval.
+// Call once after the filesystem is mounted.
+void outageJournalSetup();
+
+// Feeds link state and runs checkpoints/uploads. Call from main loop.
+// internetKnown=false means "not checked yet" (no transition is recorded).
+void outageJournalLoop(bool wifiUp, bool internetKnown, bool internetUp);
+
+// Supply is failing (see supply_monitor.h): stamps this boot's "last alive"
+// now and flags it as exact, in RTC memory and in a flash checkpoint, so the
+// next boot closes the PowerOn interval at that moment instead of at the
+// last periodic mark. No-op if already called.
+void outageJournalPowerFailing();
+
+// The supply came back without a reset: periodic "alive" marks resume.
+void outageJournalPowerRecovered();
+
+// True if the previous boot ended with outageJournalPowerFailing(); `at` is
+// its stamp (Unix seconds if unixTime, else seconds since that boot).
+bool outageJournalPreviousLastGasp(uint32_t& at, bool& unixTime);
+
+// True once NTP time is available and timestamps of this boot are absolute.
+bool outageJournalTimeAnchored();
+
+// Number of stored / not yet uploaded intervals.
+uint8_t outageJournalCount();
+uint8_t outageJournalUnsent();
+
+// Successful batch uploads since boot.
+uint32_t outageJournalUploads();
+
+// Short text of the last upload failure ("" if none / upload disabled).
+const char* outageJournalUploadError();
@@ -0,0 +1,59 @@
+//ping_latency.h
+#pragma once
+
+#include <Arduino.h>
+
+// Per-phase ping latency: fixed log-scale histograms since boot plus the
+// most recent samples (with RSSI and wall-clock time, when NTP is synced).
+// Served as /latency.json by the portal.
+
+enum class LatencyPhase : uint8_t {
+  Dns = 0,   // waited for a lookup (cached addresses are not counted)
+  Connect,   // TCP connect (+ TLS handshake); not counted on a reused connection
+  Ttfb,      // request sent -> first response byte
+  Total,     // ping start -> response parsed
+  Count,
+};
+
+static const uint8_t LATENCY_PHASES = (uint8_t)LatencyPhase::Count;
+
+// Bucket 0: < 1 ms; bucket i: [2^(i-1), 2^i) ms; the last one is open-ended.
+static const uint8_t LATENCY_BUCKETS = 14;
+
+// Phase not measured in this ping.
+static const uint32_t LATENCY_NONE = 0xFFFFFFFFUL;
+
+struct PingTiming {
+  uint32_t us[LATENCY_PHASES];  // LATENCY_NONE if not measured
+};
+
+struct LatencySample {
+  uint32_t uptimeS;
+  uint32_t epoch;    // Unix time, 0 if not synced yet
+  uint32_t us[LATENCY_PHASES];
+  uint16_t httpCode; // 0 = no HTTP response
+  int8_t rssi;
+  bool reused;
+};
+
+struct LatencyPhaseStats {
+  uint32_t count;
+  uint32_t avgUs;
+  uint32_t maxUs;
+  uint32_t buckets[LATENCY_BUCKETS];
+};
+
+// Adds one finished ping.
+void latencyRecord(const PingTiming& t, int httpCode, bool reused);
+
+void latencyGetPhase(LatencyPhase p, LatencyPhaseStats& out);
+
+// Upper bound of a bucket in ms (0 for the last, open-ended one).
+uint32_t latencyBucketUpperMs(uint8_t bucket);
+
+// Recent samples (0 = oldest).
+uint8_t latencySampleCount();
+bool latencySampleGet(uint8_t idx, LatencySample& out);
+
+// Short constant name ("dns", "connect", "ttfb", "total").
+const char* latencyPhaseText(LatencyPhase p);
@@ -0,0 +1,56 @@
+//ping_scheduler.h
+#pragma once
+
+#include <Arduino.h>
+
+#include "api_client.h"
+
+// Drift-free ping cadence, spread across a fleet.
+// - Pings fire on fixed slots (slot += interval), so the time a ping takes
+//   never shifts the cadence.
+// - Each device gets a stable phase from its chip ID, plus fresh jitter per
+//   slot, so units that boot together (power restore) don't ping together.
+// - 429/503 and Retry-After push the next slot out; a server interval hint
+//   (X-Ping-Interval response header, seconds) replaces the interval.
+// - A transient failure gets a few quick retries (short exponential backoff)
+//   within a per-interval budget, so a network blip doesn't cost a heartbeat.
+//   Retries never move the regular slots.
+
+// Sets the base interval and derives the device phase. Call once.
+void pingSchedSetup(uint32_t intervalMs);
+
+// Starts a new schedule: first ping after minDelayMs + device phase + jitter.
+// Used at boot and after Wi-Fi reconnects.
+void pingSchedRestart(uint32_t minDelayMs);
+
+// Power-on fast path: the next ping is due right away. After it starts, the
+// schedule rejoins the device phase (next slot at least half an interval out).
+void pingSchedStartNow();
+
+// True when the current slot is due.
+bool pingSchedDue();
+
+// A ping was started: advance to the next slot.
+void pingSchedOnStarted();
+
+// Result of the last ping (see ApiPingResult).
+void pingSchedOnResult(const ApiPingResult& r);
+
+// Milliseconds until the next ping is due (0 if due).
+uint32_t pingSchedMsUntilDue();
+
+uint32_t pingSchedIntervalMs();
+uint32_t pingSchedPhaseMs();
+
+// Consecutive 429/503 responses (0 when not backing off).
+uint8_t pingSchedBackoffLevel();
+
+// Fast-retry counters (reported in status.json).
+struct PingRetryStats {
+  uint32_t scheduled;     // quick retries started
+  uint32_t recovered;     // a retry succeeded (heartbeat saved)
+  uint32_t exhausted;     // failure left standing: budget used up / next slot too close
+  uint32_t notRetryable;  // failures classified as not worth a retry
+};
+
+void pingSchedGetRetryStats(PingRetryStats& out);
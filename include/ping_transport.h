@@ -0,0 +1,40 @@
+//ping_transport.h
+#pragma once
+
+#include <Arduino.h>
+
+#include "api_client.h"
+
+// How a ping reaches the backend. api_client keeps everything that does not
+// depend on the wire format (portal status, the result for the scheduler,
+// transport fallback); a transport only delivers one ping and reports back.
+// - HTTP GET over TCP/TLS (api_client.cpp): the default
+// - UDP heartbeat (udp_heartbeat.cpp): one authenticated datagram + ack,
+//   enabled with NOCTUA_HEARTBEAT_UDP_HOST
+
+// Outcome of one ping, reported exactly once per successful start().
+struct PingReport {
+  bool gotReply;          // the server answered (HTTP status line / valid ack)
+  int code;               // HTTP status, or the ack status mapped to one
+  ApiError error;         // why there is no reply (gotReply == false)
+  int32_t retryAfterS;    // -1 if absent
+  int32_t intervalHintS;  // -1 if absent
+  const char* detail;     // server error text for the portal ("" if none)
+};
+
+struct PingTransport {
+  const char* name;
+  void (*setup)();
+  void (*configChanged)();  // channel key changed
+  bool (*start)();          // false: could not start (already reported)
+  void (*loop)();           // also runs between pings (idle housekeeping)
+  bool (*busy)();
+  void (*release)();        // drop anything kept open (switching transports)
+  const char* (*phaseText)();
+};
+
+// Called by a transport when a started ping ends.
+void apiPingReport(const PingReport& r);
+
+extern const PingTransport HTTP_PING_TRANSPORT;
+extern const PingTransport UDP_PING_TRANSPORT;
@@ -0,0 +1,36 @@
+//power.h
+#pragma once
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+
+// Selectable power profiles (stored in NoctuaConfig::powerProfile).
+enum class PowerProfile : uint8_t {
+  Performance = 0,  // no Wi-Fi sleep, boot CPU clock (legacy behavior)
+  Balanced,         // DTIM-aligned modem sleep, 80 MHz when idle
+  LowPower,         // light sleep between DTIMs, 80 MHz when idle
+};
+
+// Selects the active profile. Call once after config load, before Wi-Fi setup.
+void powerSetup(uint8_t profile);
+
+// Wi-Fi sleep settings for the current state (used by wifi_manager).
+// Always WIFI_NONE_SLEEP while busy or in the Performance profile.
+WiFiSleepType_t powerWifiSleepType();
+uint8_t powerWifiListenInterval();
+
+// Call from the main loop. While busy (portal client, ping in flight) the CPU
+// runs at 160 MHz and Wi-Fi sleep is suspended to keep latency low.
+void powerLoop(bool busy);
+
+// How long the main loop may idle at the end of an iteration.
+uint32_t powerIdleDelayMs();
+
+// Short constant name for the active profile.
+const char* powerProfileText();
+
+// Current CPU clock in MHz.
+uint8_t powerCpuMHz();
+
+// Share of uptime spent in the busy (boosted) state, 0..100.
+uint8_t powerBusyPercent();
@@ -0,0 +1,20 @@
+//provision.h
+#pragma once
+
+#include <Arduino.h>
+
+// Zero-touch Wi-Fi provisioning via ESP-Touch (SmartConfig).
+// Credentials received from the phone app are written through the regular
+// config store; the captive portal stays the fallback.
+
+// Starts listening for ESP-Touch (stops the AP, suspends wifi_manager).
+void provisionStart();
+
+// Cancels provisioning and resumes normal Wi-Fi handling.
+void provisionCancel();
+
+// Call from the main loop.
+void provisionLoop();
+
+// Returns true while waiting for credentials.
+bool provisionIsActive();
@@ -0,0 +1,23 @@
+//rtc_mem.h
+#pragma once
+
+#include <Arduino.h>
+
+// ============================================================
+// RTC user memory map
+// ============================================================
+//
+// ESP8266 RTC user memory is 128 blocks x 4 bytes. It survives soft resets
+// (WDT, exceptions, ESP.restart()) but not a power cycle.
+// Offsets are in 4-byte blocks, as expected by ESP.rtcUserMemoryRead/Write().
+
+// 1 block: "clear config on next boot" magic.
+static const uint32_t RTC_BLOCK_RESET_CFG = 0;
+
+// 50 blocks: Wi-Fi event journal (see wifi_journal.cpp).
+static const uint32_t RTC_BLOCK_WIFI_JOURNAL = 1;
+static const uint32_t RTC_WIFI_JOURNAL_BLOCKS = 50;
+
+// 50 blocks: outage journal (see outage_journal.cpp).
+static const uint32_t RTC_BLOCK_OUTAGE_JOURNAL = 51;
+static const uint32_t RTC_OUTAGE_JOURNAL_BLOCKS = 50;
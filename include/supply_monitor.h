@@ -0,0 +1,37 @@
+//supply_monitor.h
+#pragma once
+
+#include <Arduino.h>
+
+// Optional supply-voltage monitor for units behind a capacitor or a small
+// UPS: when the supply starts falling, the few hundred ms left are used for
+// a "last gasp" instead of going silent.
+// - NOCTUA_SUPPLY_MONITOR=1: the ESP's own VCC (internal ADC; A0 unusable)
+// - NOCTUA_SUPPLY_MONITOR=2: the input rail through a divider on A0
+//
+// Last gasp, in this order (cheapest first):
+// 1) the pre-built UDP last-gasp datagram (udp_heartbeat.h), if a receiver
+//    is configured;
+// 2) the outage journal stamps the exact moment in RTC memory and a flash
+//    checkpoint, so the next boot reports when the outage really started.
+
+struct SupplyStatus {
+  bool enabled;
+  uint16_t mv;         // latest reading (0 = none yet)
+  uint16_t minMv;      // lowest reading since boot
+  bool failing;        // below the threshold; waiting for recovery
+  uint32_t gasps;      // failures detected since boot
+  uint32_t gaspUs;     // time the last gasp took
+  bool gaspSent;       // the last gasp reached the network stack
+};
+
+// Call once after apiSetup() and outageJournalSetup().
+void supplyMonitorSetup();
+
+// Samples the supply and runs the last gasp. Call early in main loop.
+void supplyMonitorLoop();
+
+// True between a detected failure and recovery.
+bool supplyMonitorFailing();
+
+void supplyMonitorGet(SupplyStatus& out);
@@ -0,0 +1,73 @@
+//tcp_conn.h
+#pragma once
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+struct tcp_pcb;
+struct pbuf;
+
+// Minimal non-blocking TCP connection on top of the raw lwIP API.
+// Unlike WiFiClient::connect(), nothing here ever waits: connect() returns
+// immediately and state()/available() are polled from the main loop.
+// lwIP callbacks run in the SDK context between loop iterations, so no
+// locking is needed.
+class TcpConn {
+ public:
+  enum class State : uint8_t {
+    Idle = 0,
+    Connecting,
+    Connected,
+    Closed,   // closed locally
+    Failed,   // connect failed, reset or aborted by the stack
+  };
+
+  TcpConn() = default;
+  ~TcpConn() { abort(); }
+  TcpConn(const TcpConn&) = delete;
+  TcpConn& operator=(const TcpConn&) = delete;
+
+  // Starts a connect. Returns false if it could not even be started.
+  bool connect(const IPAddress& ip, uint16_t port);
+
+  State state() const { return _state; }
+  bool connected() const { return _state == State::Connected; }
+
+  // True once the peer sent FIN (buffered data may still be available).
+  bool peerClosed() const { return _peerClosed; }
+
+  // Last lwIP error (err_t) seen on this connection.
+  int8_t lastError() const { return _err; }
+
+  // Queues up to len bytes (copied) and pushes them out.
+  // Returns the number of bytes queued (0 if the send buffer is full).
+  size_t write(const uint8_t* data, size_t len);
+
+  // Bytes received and not read yet.
+  size_t available() const;
+
+  // Reads up to n buffered bytes. Never waits.
+  size_t read(uint8_t* buf, size_t n);
+
+  // Graceful close (FIN). Drops unread data.
+  void close();
+
+  // Hard close (RST). Drops unread data.
+  void abort();
+
+ private:
+  static int8_t onConnected(void* arg, tcp_pcb* pcb, int8_t err);
+  static int8_t onRecv(void* arg, tcp_pcb* pcb, pbuf* p, int8_t err);
+  static void onError(void* arg, int8_t err);
+
+  void detach();
+  void freeRx();
+  void consume(size_t n);
+
+  tcp_pcb* _pcb = nullptr;
+  pbuf* _rx = nullptr;
+  uint16_t _rxOff = 0;
+  State _state = State::Idle;
+  bool _peerClosed = false;
+  int8_t _err = 0;
+};
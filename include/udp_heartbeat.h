@@ -0,0 +1,46 @@
+//udp_heartbeat.h
+#pragma once
+
+#include <Arduino.h>
+
+#include "ping_transport.h"
+
+// UDP heartbeat: a ping transport that replaces the HTTP request with one
+// authenticated datagram (and an optional ack), for receivers that speak it.
+// Enabled with -DNOCTUA_HEARTBEAT_UDP_HOST="\"a.b.c.d\"" (IP literal).
+//
+// Heartbeat (42 bytes, big-endian):
+//   "NHB1" | flags (bit0: ack wanted) | 0 | boot nonce[4] | seq[4] |
+//   uptime_s[4] | key id[8] = SHA-256(channel key)[0..8) | mac[16]
+// Ack (34 bytes):
+//   "NHA1" | status | 0 | boot nonce[4] | seq[4] | interval_s[2] |
+//   retry_after_s[2] | mac[16]
+// mac = HMAC-SHA-256(channel key, preceding bytes), truncated to 16 bytes.
+// Ack status: 0 ok, 1 unknown key, 2 throttled, 3 server error.
+//
+// Last gasp (42 bytes, never acked, sent twice): the heartbeat layout with
+//   "NLG1" | 0 | 0 | ... and seq = the last heartbeat's seq (so a receiver
+//   keying replays on (type, nonce, seq) accepts it once per boot).
+//
+// A heartbeat without an ack is retransmitted with the same seq, so the
+// receiver can drop duplicates; (nonce, seq) also rejects replays.
+// Packing and the retransmit schedule live in heartbeat_wire; a stand-in
+// receiver is tools/heartbeat_receiver.py.
+
+struct UdpHeartbeatStats {
+  uint32_t sent;         // heartbeats (first transmissions)
+  uint32_t retransmits;
+  uint32_t acks;
+  uint32_t badAcks;      // wrong length/seq/MAC
+  int32_t lastRttMs;     // -1 = no ack yet
+  uint32_t lastGasps;    // last-gasp datagrams handed to the stack
+};
+
+// True if a receiver address is configured (the transport is usable).
+bool udpHeartbeatConfigured();
+
+void udpHeartbeatGetStats(UdpHeartbeatStats& out);
+
+// Sends the last-gasp datagram on the socket opened at setup. Works with
+// either ping transport; needs the receiver address and Wi-Fi up.
+bool udpHeartbeatLastGasp();
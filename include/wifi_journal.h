@@ -0,0 +1,53 @@
+//wifi_journal.h
+#pragma once
+
+#include <Arduino.h>
+
+// Fixed-size binary journal of Wi-Fi link events.
+// Lives in RTC memory (survives soft resets) and is checkpointed to flash
+// periodically (survives power cycles).
+
+enum class WifiJournalEvent : uint8_t {
+  None = 0,
+  Boot,         // arg: reset reason (rst_info.reason)
+  Assoc,        // arg: channel, value: ms from WiFi.begin() to association
+  GotIp,        // value: ms from association to IP (time-to-IP)
+  Disconnect,   // arg: disconnect reason code, value: repeats coalesced into this entry
+  DhcpKick,     // assoc but no IP -> DHCP client restarted
+  StaRestart,   // assoc but still no IP -> STA stack restarted
+  AutoApStart,  // arg: consecutive reconnect failures
+  CoexApMove,   // arg: new soft AP channel (followed the target AP)
+};
+
+// 12 bytes, stored as-is in RTC memory and in the flash checkpoint.
+struct WifiJournalEntry {
+  uint32_t ms;     // millis() at the time of the event
+  uint16_t boot;   // boot sequence number (wraps)
+  uint8_t type;    // WifiJournalEvent
+  uint8_t arg;     // event-specific (see WifiJournalEvent)
+  uint16_t value;  // event-specific, clamped to 65535
+  int8_t rssi;     // dBm at the time of the event (0 if not associated)
+  uint8_t reserved;
+};
+
+// Restores the journal from RTC memory (soft reset) or flash (power-on)
+// and records a Boot event. Call once after the filesystem is mounted.
+void wifiJournalSetup();
+
+// Appends an event. Safe to call from Wi-Fi event handlers.
+void wifiJournalAdd(WifiJournalEvent ev, uint8_t arg = 0, uint32_t value = 0);
+
+// Periodic flash checkpoint (call from main loop).
+void wifiJournalLoop();
+
+// Number of stored entries.
+uint8_t wifiJournalCount();
+
+// Reads entry by index (0 = oldest). Returns false if out of range.
+bool wifiJournalGet(uint8_t idx, WifiJournalEntry& out);
+
+// Current boot sequence number.
+uint16_t wifiJournalBootSeq();
+
+// Short constant name for an event type ("assoc", "got_ip", ...).
+const char* wifiJournalEventText(uint8_t type);
@@ -8,7 +8,10 @@ void wifiManagerSetup();
 
 // Connect once using credentials from portalConfig().
 // Returns true on successful connection within timeoutMs.
-bool wifiConnectOnce(uint32_t timeoutMs);
+// Uses the channel/BSSID of the last good connection (kept in flash) when the
+// SSID matches, falling back to a full scan if that AP doesn't answer.
+// fast: cold boot, skip the link teardown and poll tightly.
+bool wifiConnectOnce(uint32_t timeoutMs, bool fast = false);
 
 // Background reconnect state machine (call from main loop).
 void wifiManagerLoop();
@@ -18,3 +21,36 @@ bool wifiIsConnected();
 
 // Temporarily disables wifiManagerLoop() actions (prevents reconnect attempts).
 void wifiManagerSuspend(bool en);
+
+// AP+STA coexistence counters (reported in status.json).
+struct WifiCoexStats {
+  uint32_t reconnects;       // STA reconnects completed while the AP was up
+  uint32_t lastReconnectMs;  // link loss -> got IP, last reconnect
+  uint32_t maxReconnectMs;
+  uint32_t apMoves;          // AP moved to follow the target AP's channel
+  uint32_t apClientDrops;    // soft AP station disconnects
+  uint32_t pausedRetries;    // blind retries skipped because a portal client was active
+  uint32_t channelScans;     // scans limited to the AP channel (no hop)
+  uint32_t fullScans;
+  uint32_t targetedAttempts; // attempts started with channel+BSSID from a scan
+};
+
+void wifiCoexGetStats(WifiCoexStats& out);
+
+// Adaptive PHY mode / TX power state and counters (reported in status.json).
+// Index 0/1/2 = 802.11b/g/n.
+struct WifiRadioStats {
+  char phyMode;             // 'b', 'g' or 'n'
+  uint16_t txDbmX10;        // current TX power, 0.1 dBm
+  uint16_t avgTxDbmX10;     // time-weighted average while connected
+  int16_t rssiEma;          // smoothed RSSI (0 = no sample yet)
+  bool fallback;            // 11b / max power hold active
+  uint32_t fallbacks;       // times the fallback was entered
+  uint64_t connectedMs[3];  // connected time per PHY mode
+  uint32_t drops[3];        // unexpected link drops per PHY mode
+};
+
+void wifiRadioGetStats(WifiRadioStats& out);
+
+// Short constant name for an SDK station disconnect reason code.
+const char* wifiDisconnectReasonText(uint8_t reason);
@@ -3,23 +3,137 @@
 #include "api_client.h"
 
 #include <ESP8266WiFi.h>
-#include <WiFiClient.h>
 
+#include "api_tls.h"
+#include "dns_resolver.h"
+#include "http_parser.h"
 #include "noctua_portal.h"
+#include "ping_latency.h"
+#include "ping_transport.h"
+#include "tcp_conn.h"
+#include "udp_heartbeat.h"
 
 // ============================================================
 // Config
 // ============================================================
 
-static const char* gHost = "api.svitlobot.in.ua";
-static const uint16_t gPort = 80;
+// Host/port can be pointed at a local stand-in server for testing.
+#ifndef NOCTUA_API_HOST
+#define NOCTUA_API_HOST "api.svitlobot.in.ua"
+#endif
+
+#ifndef NOCTUA_API_PORT
+#define NOCTUA_API_PORT (NOCTUA_API_TLS ? 443 : 80)
+#endif
+
+static const char* gHost = NOCTUA_API_HOST;
+static const uint16_t gPort = NOCTUA_API_PORT;
 static const char* gPingEndpoint = "/channelPing";
 
 static ApiError gLastErr = ApiError::None;
 
-static IPAddress gHostIp;
-static uint32_t gHostIpResolvedMs = 0;
-static const uint32_t HOST_IP_TTL_MS = 10UL * 60UL * 1000UL;  // 10 minutes
+static const uint32_t DNS_TIMEOUT_MS = 5000;
+static const uint32_t CONNECT_TIMEOUT_MS = 5000;
+static const uint32_t SEND_TIMEOUT_MS = 5000;
+static const uint32_t RESPONSE_TIMEOUT_MS = 5000;
+
+// Keep-alive: a reused socket that stays silent this long is treated as
+// half-open and the request is retried once on a fresh connection.
+static const uint32_t REUSED_RESPONSE_TIMEOUT_MS = 2000;
+
+// Server closed the idle connection this many pings in a row -> fall back
+// to per-ping connections; try keep-alive again after KEEPALIVE_RETRY_PINGS.
+static const uint8_t IDLE_CLOSES_BEFORE_FALLBACK = 2;
+static const uint16_t KEEPALIVE_RETRY_PINGS = 40;
+
+// Longest an extra channel key skips pings after a Retry-After.
+static const uint32_t CHANNEL_HOLD_MAX_MS = 3600UL * 1000UL;
+
+// Upper bound of response bytes handled per apiLoop() call.
+// Keeps every loop() pass short even if the server floods us.
+static const size_t RX_STEP_BYTES = 256;
+
+// Preferred transport (UDP heartbeat) unanswered this many pings in a row ->
+// use HTTP; try the preferred one again after TRANSPORT_RETRY_PINGS.
+static const uint8_t TRANSPORT_FAILS_BEFORE_FALLBACK = 3;
+static const uint16_t TRANSPORT_RETRY_PINGS = 40;
+
+// ============================================================
+// Transport selection
+// ============================================================
+
+static const PingTransport* gTransport = &HTTP_PING_TRANSPORT;
+static const PingTransport* gPreferred = &HTTP_PING_TRANSPORT;
+static uint8_t gNoReplyInRow = 0;
+static uint16_t gPingsSinceTransportFallback = 0;
+
+// ============================================================
+// Ping state machine
+// ============================================================
+
+enum class PingPhase : uint8_t {
+  Idle = 0,
+  Resolve,
+  Connect,
+  Send,
+  Status,
+  Headers,
+  Body,
+};
+
+static PingPhase gPhase = PingPhase::Idle;
+static uint32_t gDeadlineMs = 0;
+
+#if !NOCTUA_API_TLS
+static TcpConn gConn;
+#endif
+
+// Precomputed request: one tcp_write(), one segment (lwIP TCP_MSS is >= 536).
+static char gRequest[320];
+static size_t gRequestLen = 0;   // 0: needs rebuild
+static size_t gRequestSent = 0;
+static bool gRequestKeepAlive = false;
+static uint8_t gRequestKey = 0;  // channel key index gRequest was built for
+
+static_assert(sizeof(gRequest) <= 536, "ping request must fit a single TCP segment");
+
+static HttpResponseParser gParser;
+static char gBody[192];          // head of the response body (error reports)
+static uint32_t gRxBytes = 0;    // response bytes received for this request
+
+// Keep-alive state.
+static bool gKeepAlive = true;      // false: per-ping connections (fallback)
+static bool gReused = false;        // current ping runs on a kept connection
+static bool gReusable = false;      // current response leaves the connection reusable
+static uint8_t gIdleClosesInRow = 0;
+static uint16_t gPingsSinceFallback = 0;
+
+static uint32_t gConnectStartMs = 0;
+static uint32_t gRequestStartMs = 0;
+static ApiPingStats gStats = {};
+
+static bool gResultPending = false;
+static ApiPingResult gResult = {};
+
+// Channel keys of the ping in flight: the primary key (0) is the device's
+// ping; the extra keys follow on the same connection.
+static uint8_t gKeyIdx = 0;
+static uint8_t gKeyCount = 0;
+
+struct ChannelState {
+  ApiChannelStatus st;
+  uint32_t holdUntilMs;  // 0: not held
+};
+static ChannelState gChannels[MAX_CHANNEL_KEYS] = {};
+static bool gChannelOff[MAX_CHANNEL_KEYS] = {};  // circuit has no power (mains sense)
+
+// Phase timing of the ping in flight (micros()).
+static bool gTiming = false;
+static PingTiming gTimes;
+static uint32_t gPingStartUs = 0;
+static uint32_t gResolveStartUs = 0;  // 0: no lookup waited for
+static uint32_t gConnectStartUs = 0;
+static uint32_t gSentUs = 0;
 
 // ============================================================
 // Internal helpers
@@ -27,208 +141,400 @@ static const uint32_t HOST_IP_TTL_MS = 10UL * 60UL * 1000UL;  // 10 minutes
 
 static void setErr(ApiError e) { gLastErr = e; }
 
-static bool ipIsNonZero(const IPAddress& ip) {
-  return ((uint8_t)ip[0] | (uint8_t)ip[1] | (uint8_t)ip[2] | (uint8_t)ip[3]) != 0;
+static void setPhase(PingPhase p, uint32_t timeoutMs = 0) {
+  gPhase = p;
+  if (timeoutMs) gDeadlineMs = millis() + timeoutMs;
 }
 
-static bool resolveHostIp(IPAddress& out) {
-  if (!gHost || gHost[0] == 0) return false;
+// ============================================================
+// Transport: raw non-blocking TCP, or BearSSL when NOCTUA_API_TLS
+// ============================================================
 
-  const uint32_t now = millis();
-  if (gHostIpResolvedMs != 0 && (now - gHostIpResolvedMs) < HOST_IP_TTL_MS && ipIsNonZero(gHostIp)) {
-    out = gHostIp;
-    return true;
+#if NOCTUA_API_TLS
+// The handshake is the only blocking step; a resumed session keeps it short.
+static bool txConnect(const IPAddress& ip) { return apiTlsConnect(ip, gPort); }
+static TcpConn::State txState() {
+  if (!apiTlsOpen()) return TcpConn::State::Idle;
+  return apiTlsConnected() ? TcpConn::State::Connected : TcpConn::State::Failed;
+}
+static bool txConnected() { return apiTlsConnected(); }
+static bool txPeerClosed() { return !apiTlsConnected(); }
+static size_t txAvailable() { return apiTlsAvailable(); }
+static size_t txRead(uint8_t* buf, size_t n) { return apiTlsRead(buf, n); }
+static size_t txWrite(const uint8_t* data, size_t len) { return apiTlsWrite(data, len); }
+static void txClose() { apiTlsStop(); }
+static void txAbort() { apiTlsStop(); }
+#else
+static bool txConnect(const IPAddress& ip) { return gConn.connect(ip, gPort); }
+static TcpConn::State txState() { return gConn.state(); }
+static bool txConnected() { return gConn.connected(); }
+static bool txPeerClosed() { return gConn.peerClosed(); }
+static size_t txAvailable() { return gConn.available(); }
+static size_t txRead(uint8_t* buf, size_t n) { return gConn.read(buf, n); }
+static size_t txWrite(const uint8_t* data, size_t len) { return gConn.write(data, len); }
+static void txClose() { gConn.close(); }
+static void txAbort() { gConn.abort(); }
+#endif
+
+// No more bytes will arrive on the connection.
+static bool connEof() {
+  return !txAvailable() && (txPeerClosed() || !txConnected());
+}
+
+static void keepAliveFallback(const char* why) {
+  if (!gKeepAlive) return;
+  gKeepAlive = false;
+  gPingsSinceFallback = 0;
+  Serial.printf("apiPing: keep-alive off (%s), using per-ping connections\n", why);
+}
+
+// Percent-encodes str into out (query parameter rules).
+// Returns the encoded length, or -1 if it does not fit.
+static int urlEncodeInto(const char* str, char* out, size_t outSize) {
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  size_t n = 0;
+
+  for (size_t i = 0; str && str[i] != '\0'; i++) {
+    const char c = str[i];
+    if (isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.' || c == '~') {
+      if (n + 1 >= outSize) return -1;
+      out[n++] = c;
+    } else {
+      if (n + 3 >= outSize) return -1;
+      out[n++] = '%';
+      out[n++] = HEX_DIGITS[(uint8_t)c >> 4];
+      out[n++] = HEX_DIGITS[(uint8_t)c & 0x0F];
+    }
   }
+  out[n] = 0;
+  return (int)n;
+}
 
-  IPAddress ip;
-  yield();
-  const bool ok = WiFi.hostByName(gHost, ip);
-  yield();
+// Formats the complete GET request for channel key keyIdx into gRequest.
+// With a single key it runs only when the key or the keep-alive mode
+// changes; pings just resend the buffer.
+static bool buildRequest(uint8_t keyIdx) {
+  gRequestLen = 0;
+
+  char encodedKey[3 * sizeof(NoctuaConfig::channelKey)];
+  if (urlEncodeInto(portalChannelKey(keyIdx), encodedKey, sizeof(encodedKey)) < 0) return false;
+
+  const int n = snprintf(gRequest, sizeof(gRequest),
+                         "GET %s?channel_key=%s HTTP/1.1\r\nHost: %s\r\nConnection: %s\r\n\r\n",
+                         gPingEndpoint, encodedKey, gHost, gKeepAlive ? "keep-alive" : "close");
+  if (n <= 0 || (size_t)n >= sizeof(gRequest)) return false;
+
+  gRequestLen = (size_t)n;
+  gRequestKeepAlive = gKeepAlive;
+  gRequestKey = keyIdx;
+  return true;
+}
+
+static bool requestReady(uint8_t keyIdx) {
+  return gRequestLen != 0 && gRequestKeepAlive == gKeepAlive && gRequestKey == keyIdx;
+}
 
-  if (ok && ipIsNonZero(ip)) {
-    gHostIp = ip;
-    gHostIpResolvedMs = now;
-    out = ip;
-    return true;
+static void channelNote(uint8_t idx, bool gotCode, int code, ApiError err, int32_t retryAfterS) {
+  if (idx >= MAX_CHANNEL_KEYS) return;
+  ChannelState& c = gChannels[idx];
+  const bool ok = gotCode && code >= 200 && code < 300;
+  c.st.known = true;
+  c.st.ok = ok;
+  c.st.httpCode = gotCode ? code : 0;
+  c.st.error = ok ? ApiError::None : (gotCode ? ApiError::Non200 : err);
+  c.st.pings++;
+  if (ok) {
+    c.st.lastOkMs = millis();
+  } else {
+    c.st.failures++;
   }
 
-  return false;
+  // The scheduler paces the primary key; an extra key the server throttles
+  // sits out the following cycles on its own.
+  c.holdUntilMs = 0;
+  if (idx > 0 && gotCode && (code == 429 || code == 503) && retryAfterS > 0) {
+    const uint32_t ms = (uint32_t)retryAfterS * 1000UL;
+    c.holdUntilMs = millis() + (ms < CHANNEL_HOLD_MAX_MS ? ms : CHANNEL_HOLD_MAX_MS);
+    if (c.holdUntilMs == 0) c.holdUntilMs = 1;
+  }
 }
 
-// URL-encodes a string (percent-encoding for query parameters).
-static String urlEncode(const char* str) {
-  String encoded;
-  if (!str) return encoded;
-  
-  for (size_t i = 0; str[i] != '\0'; i++) {
-    char c = str[i];
-    if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
-      encoded += c;
-    } else {
-      char buf[4];
-      snprintf(buf, sizeof(buf), "%%%02X", (unsigned char)c);
-      encoded += buf;
-    }
+static bool channelHeld(uint8_t idx) {
+  const uint32_t until = gChannels[idx].holdUntilMs;
+  return until && (int32_t)(millis() - until) < 0;
+}
+
+static bool channelSkipped(uint8_t idx) { return gChannelOff[idx] || channelHeld(idx); }
+
+// Advances gKeyIdx to the next extra key due this cycle and prepares its
+// request. False when the batch is complete.
+static bool nextChannelKey() {
+  while (++gKeyIdx < gKeyCount) {
+    if (channelSkipped(gKeyIdx)) continue;
+    if (buildRequest(gKeyIdx)) return true;
+    channelNote(gKeyIdx, false, 0, ApiError::WriteFailed, -1);
   }
-  return encoded;
+  return false;
 }
 
-// Reads a single CRLF/LF-terminated line with a hard deadline.
-// - Trims '\r'
-// - Stops at '\n' or when buffer is full (keeps it NUL-terminated)
-// Returns true if any chars were read before deadline.
-static bool readLineWithDeadline(WiFiClient& client, char* buf, size_t bufSize, uint32_t deadlineMs) {
-  if (bufSize == 0) return false;
-  buf[0] = 0;
+static void startResolve();
 
-  size_t n = 0;
+// One channel key's exchange ended. The primary key's result is reported
+// right away (it is the device's ping); extra keys then go out on the same
+// connection while the transport stays busy. Closes the connection at the
+// end unless it stays kept.
+static void pingFinish(bool gotCode) {
+  const bool primary = gKeyIdx == 0;
+  const int code = gotCode ? gParser.statusCode() : 0;
 
-  while (millis() < deadlineMs) {
-    if (!client.available()) {
-      if (!client.connected()) break;
-      delay(2);
-      yield();
-      continue;
-    }
+  if (primary && gTiming) {
+    gTiming = false;
+    if (gotCode) gTimes.us[(uint8_t)LatencyPhase::Total] = micros() - gPingStartUs;
+    latencyRecord(gTimes, code, gReused);
+  }
 
-    const int c = client.read();
-    if (c < 0) continue;
+  if (primary && gotCode) {
+    gStats.lastRequestMs = millis() - gRequestStartMs;
+    gStats.lastReused = gReused;
+    if (gReused) gIdleClosesInRow = 0;
+  }
 
-    if (c == '\r') continue;
-    if (c == '\n') break;
+  if (primary) {
+    PingReport r;
+    r.gotReply = gotCode;
+    r.code = code;
+    r.error = gLastErr;
+    r.retryAfterS = gotCode ? gParser.retryAfterS() : -1;
+    r.intervalHintS = gotCode ? gParser.intervalHintS() : -1;
+    r.detail = gBody;
+    apiPingReport(r);
+  } else {
+    channelNote(gKeyIdx, gotCode, code, gLastErr, gotCode ? gParser.retryAfterS() : -1);
+    if (gotCode && (code < 200 || code >= 300)) {
+      Serial.printf("apiPing: channel %u HTTP %d %s\n", (unsigned)(gKeyIdx + 1), code, gBody);
+    }
+  }
 
-    if (n + 1 < bufSize) {
-      buf[n++] = (char)c;
-      buf[n] = 0;
+  if (gotCode && nextChannelKey()) {
+    gRequestSent = 0;
+    gRequestStartMs = millis();
+    if (gReusable) {
+      // Same connection, next request (treated like a kept one: if it died
+      // meanwhile, the request is resent on a fresh connection).
+      gReused = true;
+      setPhase(PingPhase::Send, SEND_TIMEOUT_MS);
     } else {
-      // Buffer full: keep consuming until end of line.
+      txClose();
+      gReused = false;
+      startResolve();
     }
+    return;
   }
 
-  return (n > 0);
+  // No HTTP reply: the keys not reached yet fail the same way.
+  if (!gotCode) {
+    while (++gKeyIdx < gKeyCount) {
+      if (!channelSkipped(gKeyIdx)) channelNote(gKeyIdx, false, 0, gLastErr, -1);
+    }
+  }
+  // apiLastError() keeps describing the device's (primary) ping.
+  if (!primary) setErr(gResult.error);
+
+  if (!(gotCode && gReusable)) txClose();
+  setPhase(PingPhase::Idle);
 }
 
-// Parses HTTP status code from "HTTP/1.1 200 OK".
-// Returns true on success and writes code.
-static bool parseHttpStatusCode(const char* statusLine, int& codeOut) {
-  codeOut = 0;
-  if (!statusLine || statusLine[0] == 0) return false;
+static void pingFail(ApiError e) {
+  setErr(e);
+  pingFinish(false);
+}
 
-  const char* sp = strchr(statusLine, ' ');
-  if (!sp) return false;
+static void startConnect(const IPAddress& ip) {
+  if (gResolveStartUs) {
+    gTimes.us[(uint8_t)LatencyPhase::Dns] = micros() - gResolveStartUs;
+    gResolveStartUs = 0;
+  }
+  gConnectStartUs = micros();
+  gConnectStartMs = millis();
+  if (!txConnect(ip)) {
+    pingFail(ApiError::ConnectFailed);
+    return;
+  }
+  setPhase(PingPhase::Connect, CONNECT_TIMEOUT_MS);
+}
 
-  while (*sp == ' ') sp++;
+// A cached address (even a stale one) is used right away; the resolver
+// refreshes it in the background. Only an empty cache waits for DNS.
+static void startResolve() {
+  IPAddress ip;
+  if (dnsResolverGet(ip) != DnsCacheState::None) {
+    startConnect(ip);
+    return;
+  }
+  gResolveStartUs = micros();
+  setPhase(PingPhase::Resolve, DNS_TIMEOUT_MS);
+}
 
-  if (!(sp[0] >= '0' && sp[0] <= '9')) return false;
-  if (!(sp[1] >= '0' && sp[1] <= '9')) return false;
-  if (!(sp[2] >= '0' && sp[2] <= '9')) return false;
+static void stepResolve(bool expired) {
+  IPAddress ip;
+  if (dnsResolverGet(ip) != DnsCacheState::None) {
+    startConnect(ip);
+    return;
+  }
+  if (expired || !dnsResolverBusy()) pingFail(ApiError::DnsFailed);
+}
 
-  codeOut = (sp[0] - '0') * 100 + (sp[1] - '0') * 10 + (sp[2] - '0');
-  return true;
+static void stepConnect(bool expired) {
+  switch (txState()) {
+    case TcpConn::State::Connected:
+      gTimes.us[(uint8_t)LatencyPhase::Connect] = micros() - gConnectStartUs;
+      if (gKeyIdx == 0) gStats.lastConnectMs = millis() - gConnectStartMs;
+      gStats.newConnections++;
+      gRequestStartMs = millis();
+      setPhase(PingPhase::Send, SEND_TIMEOUT_MS);
+      break;
+
+    case TcpConn::State::Connecting:
+      if (!expired) return;
+      // fallthrough
+    default:
+      // The cached address may be outdated; refresh it in the background.
+      dnsResolverInvalidate();
+      pingFail(ApiError::ConnectFailed);
+      return;
+  }
 }
 
-// Reads and discards HTTP headers until the empty line.
-static bool discardHttpHeaders(WiFiClient& client, uint32_t deadlineMs) {
-  char line[128];
-
-  while (millis() < deadlineMs) {
-    if (client.available()) {
-      const int p = client.peek();
-      if (p == '\r' || p == '\n') {
-        while (client.available()) {
-          const int c = client.read();
-          if (c == '\n') break;
-        }
-        return true;
-      }
-    }
+// The kept connection turned out to be dead: resend once on a fresh one.
+static void retryOnFreshConnection(bool halfOpen) {
+  if (halfOpen) {
+    gStats.halfOpen++;
+  } else {
+    gStats.serverCloses++;
+  }
+  txAbort();
+  gReused = false;
+  gRequestSent = 0;
+  startResolve();
+}
 
-    const bool got = readLineWithDeadline(client, line, sizeof(line), deadlineMs);
-    if (!got) {
-      if (!client.connected() && !client.available()) return false;
-      continue;
+static void stepSend(bool expired) {
+  if (!txConnected()) {
+    if (gReused) {
+      retryOnFreshConnection(false);
+    } else {
+      pingFail(ApiError::WriteFailed);
     }
-
-    if (line[0] == 0) return true;
+    return;
   }
 
-  return false;
+  gRequestSent += txWrite((const uint8_t*)gRequest + gRequestSent, gRequestLen - gRequestSent);
+  if (gRequestSent >= gRequestLen) {
+    gSentUs = micros();
+    gParser.reset(gBody, sizeof(gBody));
+    gRxBytes = 0;
+    setPhase(PingPhase::Status, gReused ? REUSED_RESPONSE_TIMEOUT_MS : RESPONSE_TIMEOUT_MS);
+  } else if (expired) {
+    pingFail(ApiError::WriteFailed);
+  }
 }
 
-// Performs minimal HTTP GET and returns parsed status code.
-// Returns true if a status code was obtained (even if non-200).
-static bool httpGetStatus(const char* host, uint16_t port, const char* pathAndQuery, int& statusCodeOut, char* bodyBufOut = nullptr, size_t bodyBufSize = 0) {
-  statusCodeOut = 0;
-  if (bodyBufOut && bodyBufSize > 0) bodyBufOut[0] = 0;
-
-  IPAddress ip;
-  if (!resolveHostIp(ip)) {
-    setErr(ApiError::DnsFailed);
-    return false;
+static void syncReceivePhase() {
+  const PingPhase prev = gPhase;
+  switch (gParser.state()) {
+    case HttpResponseParser::State::StatusLine: gPhase = PingPhase::Status; break;
+    case HttpResponseParser::State::Headers: gPhase = PingPhase::Headers; break;
+    default: gPhase = PingPhase::Body; break;
   }
+  // The status line arrived: the short half-open timeout no longer applies.
+  if (prev == PingPhase::Status && gPhase != PingPhase::Status) gDeadlineMs = millis() + RESPONSE_TIMEOUT_MS;
+}
 
-  WiFiClient client;
-  client.setTimeout(1500);
+// The status code is known; decide whether the connection can be kept.
+static void receiveFinish(bool complete) {
+  if (gParser.connectionClose()) keepAliveFallback("server closes after response");
+  gReusable = complete && gKeepAlive && !gParser.connectionClose() && !txAvailable();
+  pingFinish(true);
+}
 
-  // Connect using pre-resolved IP to avoid potentially long blocking DNS inside connect(hostname).
-  if (!client.connect(ip, port)) {
-    setErr(ApiError::ConnectFailed);
-    return false;
+// Feeds received bytes to the HTTP parser in bulk. A framed body
+// (Content-Length or chunked) is drained completely so the connection
+// can carry the next ping.
+static void stepReceive(bool expired) {
+  uint8_t buf[RX_STEP_BYTES];
+  const size_t n = txRead(buf, sizeof(buf));
+  if (n && gRxBytes == 0) gTimes.us[(uint8_t)LatencyPhase::Ttfb] = micros() - gSentUs;
+  gRxBytes += n;
+
+  // Anything past the end of the response means framing is off.
+  const bool stray = gParser.feed(buf, n) < n;
+
+  if (gParser.failed()) {
+    if (gParser.statusCode() == 0) {
+      pingFail(ApiError::BadStatusLine);
+    } else {
+      receiveFinish(false);
+    }
+    return;
   }
 
-  size_t w = 0;
-  w += client.print(F("GET "));
-  w += client.print(pathAndQuery);
-  w += client.print(F(" HTTP/1.1\r\nHost: "));
-  w += client.print(host);
-  w += client.print(F("\r\nConnection: close\r\n\r\n"));
+  syncReceivePhase();
 
-  if (w == 0) {
-    client.stop();
-    setErr(ApiError::WriteFailed);
-    return false;
+  if (gParser.done()) {
+    receiveFinish(!stray);
+    return;
   }
 
-  const uint32_t deadline = millis() + 5000;
+  if (gRxBytes == 0 && gReused && (expired || connEof())) {
+    // Nothing came back on the kept socket: half-open (silent) or closed under us.
+    retryOnFreshConnection(expired);
+    return;
+  }
 
-  char statusLine[96];
-  const bool gotLine = readLineWithDeadline(client, statusLine, sizeof(statusLine), deadline);
-  if (!gotLine) {
-    client.stop();
-    setErr(ApiError::ReadTimeout);
-    return false;
+  if (gParser.headersDone() && !gParser.framed()) {
+    // Unframed body ends with the connection. Success needs no body, and
+    // an error report needs only what fits in gBody.
+    const bool ok2xx = (gParser.statusCode() >= 200 && gParser.statusCode() < 300);
+    if (ok2xx || gParser.bodyCaptured() + 1 >= sizeof(gBody)) {
+      receiveFinish(false);
+      return;
+    }
   }
 
-  int code = 0;
-  if (!parseHttpStatusCode(statusLine, code)) {
-    client.stop();
-    setErr(ApiError::BadStatusLine);
-    return false;
+  if (connEof()) {
+    gParser.finishEof();
+    if (gParser.statusCode() == 0) {
+      pingFail(ApiError::ReadTimeout);
+    } else {
+      receiveFinish(false);
+    }
+    return;
   }
 
-  (void)discardHttpHeaders(client, deadline);
-
-  // Capture response body (up to bodyBufSize bytes) for error logging.
-  if (bodyBufOut && bodyBufSize > 0) {
-    size_t nRead = 0;
-    while (nRead < bodyBufSize - 1 && millis() < deadline) {
-      if (client.available()) {
-        const int c = client.read();
-        if (c < 0) break;
-        bodyBufOut[nRead++] = (char)c;
-      } else {
-        if (!client.connected()) break;
-        delay(1);
-        yield();
-      }
+  if (expired) {
+    if (gParser.statusCode() == 0) {
+      pingFail(ApiError::ReadTimeout);
+    } else {
+      receiveFinish(false);
     }
-    bodyBufOut[nRead] = 0;
   }
+}
 
-  client.stop();
+// Between pings: notice the server closing the kept connection.
+static void idleConnCheck() {
+  const TcpConn::State st = txState();
+  if (st == TcpConn::State::Idle || st == TcpConn::State::Closed) return;
 
-  statusCodeOut = code;
-  return true;
+  if (WiFi.status() != WL_CONNECTED) {
+    txAbort();
+    return;
+  }
+
+  if (!txPeerClosed() && txConnected()) return;
+
+  gStats.serverCloses++;
+  txClose();
+  if (++gIdleClosesInRow >= IDLE_CLOSES_BEFORE_FALLBACK) keepAliveFallback("server closes idle connection");
 }
 
 // ============================================================
@@ -253,53 +559,169 @@ const char* apiLastErrorText() {
   }
 }
 
-bool apiPing() {
-  setErr(ApiError::None);
+bool apiErrorRetryable(ApiError e, int httpCode) {
+  switch (e) {
+    case ApiError::DnsFailed:
+    case ApiError::ConnectFailed:
+    case ApiError::WriteFailed:
+    case ApiError::ReadTimeout:
+    case ApiError::BadStatusLine:
+      return true;
+    case ApiError::Non200:
+      return httpCode >= 500 && httpCode != 503;
+    default:
+      return false;
+  }
+}
+
+// ============================================================
+// HTTP transport
+// ============================================================
+
+static void httpSetup() {
+  dnsResolverSetup(gHost);
+  apiTlsSetup();
+  (void)buildRequest(0);
+}
+
+static void httpConfigChanged() { gRequestLen = 0; }
+
+// Starts a batch at channel key `first`: 0 = the regular ping (all keys),
+// otherwise that one extra key alone.
+static bool httpStartAt(uint8_t first) {
+  gParser.reset(gBody, sizeof(gBody));
+  gReusable = false;
+  gReused = false;
+  // ping_conn describes the regular ping; a lone extra key leaves it alone.
+  if (first == 0) {
+    gStats.lastConnectMs = 0;
+    gStats.lastRequestMs = 0;
+  }
+
+  // Before any failure, so it is booked on the keys of this batch.
+  gKeyIdx = first;
+  gKeyCount = first ? first + 1 : portalChannelKeyCount();
 
   if (!gHost || gHost[0] == 0) {
-    setErr(ApiError::NoHost);
-    portalSetHostReachable(false);
-    portalSetPingError(apiLastErrorText());
-    portalSetPingStatus(false);
+    pingFail(ApiError::NoHost);
     return false;
   }
 
-  if (WiFi.status() != WL_CONNECTED) {
-    setErr(ApiError::NoWiFi);
-    portalSetHostReachable(false);
-    portalSetPingError(apiLastErrorText());
-    portalSetPingStatus(false);
-    return false;
+  if (!gKeepAlive && ++gPingsSinceFallback >= KEEPALIVE_RETRY_PINGS) {
+    gKeepAlive = true;
+    gIdleClosesInRow = 0;
   }
 
-  if (!portalHasAppConfig()) {
-    setErr(ApiError::NoAppConfig);
-    portalSetHostReachable(false);
-    portalSetPingError(apiLastErrorText());
-    portalSetPingStatus(false);
+  if (!requestReady(first) && !buildRequest(first)) {
+    pingFail(ApiError::WriteFailed);
     return false;
   }
+  gRequestSent = 0;
+
+  for (uint8_t i = 0; i < LATENCY_PHASES; i++) gTimes.us[i] = LATENCY_NONE;
+  gPingStartUs = micros();
+  gResolveStartUs = 0;
+  gTiming = first == 0;
+
+  idleConnCheck();
+  if (gKeepAlive && txConnected() && !txAvailable()) {
+    gReused = true;
+    gStats.reusedConnections++;
+    gRequestStartMs = millis();
+    setPhase(PingPhase::Send, SEND_TIMEOUT_MS);
+    stepSend(false);
+  } else {
+    if (!gKeepAlive) txClose();
+    // Stray bytes on an idle connection: framing is off, start over.
+    if (txConnected()) txAbort();
+    startResolve();
+  }
+  return gPhase != PingPhase::Idle;
+}
 
-  const char* key = portalConfig().channelKey;
-  String encodedKey = urlEncode(key ? key : "");
-  
-  char path[200];
-  snprintf(path, sizeof(path), "%s?channel_key=%s", gPingEndpoint, encodedKey.c_str());
+static bool httpStart() { return httpStartAt(0); }
 
-  int code = 0;
-  char body[192] = {0};
-  const bool gotCode = httpGetStatus(gHost, gPort, path, code, body, sizeof(body));
+static void httpLoop() {
+  if (gPhase == PingPhase::Idle) {
+    idleConnCheck();
+    return;
+  }
+
+  if (WiFi.status() != WL_CONNECTED) {
+    pingFail(ApiError::NoWiFi);
+    return;
+  }
+
+  const bool expired = (int32_t)(millis() - gDeadlineMs) >= 0;
+
+  switch (gPhase) {
+    case PingPhase::Resolve: stepResolve(expired); break;
+    case PingPhase::Connect: stepConnect(expired); break;
+    case PingPhase::Send: stepSend(expired); break;
+    case PingPhase::Status:
+    case PingPhase::Headers:
+    case PingPhase::Body: stepReceive(expired); break;
+    default: break;
+  }
+}
+
+static bool httpBusy() { return gPhase != PingPhase::Idle; }
+
+static void httpRelease() {
+  if (gPhase == PingPhase::Idle) txClose();
+}
 
-  // Host reachable == we got a valid HTTP status code.
-  portalSetHostReachable(gotCode);
+static const char* httpPhaseText() {
+  switch (gPhase) {
+    case PingPhase::Idle: return "idle";
+    case PingPhase::Resolve: return "resolve";
+    case PingPhase::Connect: return "connect";
+    case PingPhase::Send: return "send";
+    case PingPhase::Status: return "status";
+    case PingPhase::Headers: return "headers";
+    case PingPhase::Body: return "body";
+    default: return "?";
+  }
+}
+
+const PingTransport HTTP_PING_TRANSPORT = {
+  "http",
+  httpSetup,
+  httpConfigChanged,
+  httpStart,
+  httpLoop,
+  httpBusy,
+  httpRelease,
+  httpPhaseText,
+};
 
-  const bool ok = gotCode && (code >= 200) && (code < 300);
-  if (!ok && gotCode) {
+// ============================================================
+// Public API
+// ============================================================
+
+static void switchTransport(const PingTransport* t) {
+  if (t == gTransport) return;
+  gTransport->release();
+  Serial.printf("apiPing: transport %s -> %s\n", gTransport->name, t->name);
+  gTransport = t;
+  gNoReplyInRow = 0;
+  gPingsSinceTransportFallback = 0;
+}
+
+// Publishes the outcome of a ping (same semantics as the old blocking
+// apiPing(), whatever the transport).
+void apiPingReport(const PingReport& r) {
+  // Host reachable == the server answered (HTTP status code / heartbeat ack).
+  portalSetHostReachable(r.gotReply);
+
+  const int code = r.gotReply ? r.code : 0;
+  const bool ok = r.gotReply && (code >= 200) && (code < 300);
+  if (!ok && r.gotReply) {
     setErr(ApiError::Non200);
-    if (body[0]) {
+    if (r.detail && r.detail[0]) {
       // Report server response body to portal UI for debugging
-      portalSetPingError(body);
-      Serial.printf("apiPing: HTTP %d body: %s\n", code, body);
+      portalSetPingError(r.detail);
+      Serial.printf("apiPing: HTTP %d body: %s\n", code, r.detail);
     } else {
       char err[32];
       snprintf(err, sizeof(err), "HTTP %d", code);
@@ -307,14 +729,133 @@ bool apiPing() {
       Serial.printf("apiPing: HTTP %d (no body)\n", code);
     }
   } else {
-    if (!gotCode) {
+    if (!r.gotReply) {
+      setErr(r.error);
       portalSetPingError(apiLastErrorText());
     } else {
+      setErr(ApiError::None);
       portalSetPingError("");
     }
   }
 
   portalSetPingStatus(ok);
 
-  return ok;
+  gResult.ok = ok;
+  gResult.httpCode = code;
+  gResult.retryAfterS = r.gotReply ? r.retryAfterS : -1;
+  gResult.intervalHintS = r.gotReply ? r.intervalHintS : -1;
+  gResult.error = ok ? ApiError::None : gLastErr;
+  gResult.retryable = !ok && apiErrorRetryable(gLastErr, code);
+  gResultPending = true;
+
+  channelNote(0, r.gotReply, code, gLastErr, gResult.retryAfterS);
+
+  // An alternative transport that goes unanswered gives way to HTTP.
+  if (gTransport != &HTTP_PING_TRANSPORT) {
+    if (r.gotReply) {
+      gNoReplyInRow = 0;
+    } else if (gResult.retryable && ++gNoReplyInRow >= TRANSPORT_FAILS_BEFORE_FALLBACK) {
+      gStats.transportFallbacks++;
+      switchTransport(&HTTP_PING_TRANSPORT);
+    }
+  }
+}
+
+// Ping refused before any transport got involved.
+static void reportFail(ApiError e) {
+  PingReport r = {false, 0, e, -1, -1, ""};
+  apiPingReport(r);
+}
+
+// The heartbeat datagram carries one key: extra channel keys need HTTP.
+static const PingTransport* preferredTransport() {
+  if (udpHeartbeatConfigured() && portalChannelKeyCount() <= 1) return &UDP_PING_TRANSPORT;
+  return &HTTP_PING_TRANSPORT;
+}
+
+void apiSetup() {
+  HTTP_PING_TRANSPORT.setup();
+  if (udpHeartbeatConfigured()) UDP_PING_TRANSPORT.setup();
+  gPreferred = preferredTransport();
+  gTransport = gPreferred;
+}
+
+void apiConfigChanged() {
+  HTTP_PING_TRANSPORT.configChanged();
+  if (udpHeartbeatConfigured()) UDP_PING_TRANSPORT.configChanged();
+  memset(gChannels, 0, sizeof(gChannels));
+
+  gPreferred = preferredTransport();
+  if (!gTransport->busy()) switchTransport(gPreferred);
+}
+
+bool apiPingStart() {
+  if (gTransport->busy()) return false;
+
+  setErr(ApiError::None);
+
+  if (WiFi.status() != WL_CONNECTED) {
+    gTransport->release();
+    reportFail(ApiError::NoWiFi);
+    return false;
+  }
+
+  if (!portalHasAppConfig()) {
+    reportFail(ApiError::NoAppConfig);
+    return false;
+  }
+
+  if (gTransport != gPreferred && ++gPingsSinceTransportFallback >= TRANSPORT_RETRY_PINGS) {
+    switchTransport(gPreferred);
+  }
+
+  return gTransport->start();
+}
+
+void apiLoop() {
+  dnsResolverLoop();
+  gTransport->loop();
+}
+
+void apiGetPingStats(ApiPingStats& out) {
+  out = gStats;
+  out.keepAlive = gKeepAlive;
+}
+
+bool apiPingBusy() { return gTransport->busy(); }
+
+bool apiPingTakeResult(ApiPingResult& out) {
+  if (!gResultPending) return false;
+  gResultPending = false;
+  out = gResult;
+  return true;
+}
+
+const char* apiPingPhaseText() { return gTransport->phaseText(); }
+
+const char* apiPingTransportName() { return gTransport->name; }
+
+uint8_t apiChannelCount() { return portalChannelKeyCount(); }
+
+void apiChannelSetEnabled(uint8_t idx, bool en) {
+  if (idx == 0 || idx >= MAX_CHANNEL_KEYS) return;
+  gChannelOff[idx] = !en;
+}
+
+bool apiPingStartChannel(uint8_t idx) {
+  if (idx == 0 || idx >= portalChannelKeyCount() || channelSkipped(idx)) return false;
+  // Extra keys only travel over HTTP (see preferredTransport()).
+  if (gTransport != &HTTP_PING_TRANSPORT || gTransport->busy()) return false;
+  if (WiFi.status() != WL_CONNECTED) return false;
+
+  setErr(ApiError::None);
+  return httpStartAt(idx);
+}
+
+bool apiChannelStatus(uint8_t idx, ApiChannelStatus& out) {
+  if (idx >= MAX_CHANNEL_KEYS || idx >= portalChannelKeyCount()) return false;
+  out = gChannels[idx].st;
+  out.enabled = !gChannelOff[idx];
+  out.holdS = channelHeld(idx) ? (gChannels[idx].holdUntilMs - millis() + 999) / 1000 : 0;
+  return true;
 }
@@ -0,0 +1,242 @@
+//api_tls.cpp
+
+#include "api_tls.h"
+
+#if NOCTUA_API_TLS
+
+#include <LittleFS.h>
+#include <WiFiClientSecure.h>
+
+#ifndef NOCTUA_API_TLS_PUBKEY
+#error "NOCTUA_API_TLS needs the pinned server key in NOCTUA_API_TLS_PUBKEY"
+#endif
+
+// ============================================================
+// Tuning
+// ============================================================
+
+static const uint16_t MFLN_SIZE = 512;
+static const uint16_t DEFAULT_RX_SIZE = 16384;  // a full TLS record
+static const uint16_t DEFAULT_TX_SIZE = 512;
+static const uint32_t CONNECT_TIMEOUT_MS = 5000;
+
+static const char* SESSION_PATH = "/tls_session.bin";
+static const char* SESSION_TMP_PATH = "/tls_session.tmp";
+static const uint32_t SESSION_MAGIC = 0x4E545332;  // 'NTS2'
+// A server that never resumes hands out a new session ID per handshake:
+// a new ID alone is written at most this often (MFLN changes at once).
+static const uint32_t SESSION_WRITE_MIN_MS = 3600000UL;
+
+// Server MFLN support as persisted next to the session.
+enum : uint8_t {
+  MFLN_UNKNOWN = 0,  // probe on the next connect
+  MFLN_NO,
+  MFLN_YES,
+};
+
+// ============================================================
+// State
+// ============================================================
+
+static BearSSL::WiFiClientSecure gClient;
+static BearSSL::PublicKey gPinnedKey(NOCTUA_API_TLS_PUBKEY);
+static BearSSL::Session gSession;
+
+static bool gOpen = false;
+static uint8_t gMflnState = MFLN_UNKNOWN;
+static ApiTlsStats gStats = {};
+
+// What the file holds, so unchanged state is not rewritten.
+static uint8_t gStoredMfln = MFLN_UNKNOWN;
+static uint8_t gStoredIdLen = 0;
+static uint8_t gStoredId[32];
+static uint32_t gStoredMs = 0;  // last write this boot, 0 = none
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static void noteStored(uint8_t mfln, const br_ssl_session_parameters& params) {
+  gStoredMfln = mfln;
+  gStoredIdLen = params.session_id_len <= sizeof(gStoredId) ? params.session_id_len : 0;
+  memcpy(gStoredId, params.session_id, gStoredIdLen);
+}
+
+// Layout: magic, MFLN state, 3 bytes padding, br_ssl_session_parameters.
+static void sessionStore() {
+  const br_ssl_session_parameters* params = gSession.getSession();
+  const bool mflnChanged = gMflnState != gStoredMfln;
+  const bool idChanged = params->session_id_len != gStoredIdLen ||
+                         memcmp(params->session_id, gStoredId, gStoredIdLen) != 0;
+  if (!mflnChanged && !idChanged) return;
+  const uint32_t now = millis();
+  if (!mflnChanged && gStoredMs != 0 && now - gStoredMs < SESSION_WRITE_MIN_MS) return;
+
+  // Runtime writes should never format flash. If mount fails, fail fast.
+  if (!LittleFS.begin()) return;
+
+  // Write to a temp file and rename, so a power cut mid-write keeps the old copy.
+  File f = LittleFS.open(SESSION_TMP_PATH, "w");
+  if (!f) return;
+  const uint8_t head[4] = {gMflnState, 0, 0, 0};
+  size_t n = f.write((const uint8_t*)&SESSION_MAGIC, sizeof(SESSION_MAGIC));
+  n += f.write(head, sizeof(head));
+  n += f.write((const uint8_t*)params, sizeof(br_ssl_session_parameters));
+  f.close();
+
+  if (n != sizeof(SESSION_MAGIC) + sizeof(head) + sizeof(br_ssl_session_parameters)) {
+    (void)LittleFS.remove(SESSION_TMP_PATH);
+    return;
+  }
+  (void)LittleFS.remove(SESSION_PATH);
+  if (!LittleFS.rename(SESSION_TMP_PATH, SESSION_PATH)) return;
+  noteStored(gMflnState, *params);
+  gStoredMs = now ? now : 1;
+}
+
+static void sessionLoad() {
+  if (!LittleFS.exists(SESSION_PATH)) return;
+
+  File f = LittleFS.open(SESSION_PATH, "r");
+  if (!f) return;
+
+  uint32_t magic = 0;
+  uint8_t head[4];
+  br_ssl_session_parameters params;
+  const bool ok = f.read((uint8_t*)&magic, sizeof(magic)) == sizeof(magic) &&
+                  magic == SESSION_MAGIC &&
+                  f.read(head, sizeof(head)) == sizeof(head) &&
+                  f.read((uint8_t*)&params, sizeof(params)) == sizeof(params);
+  f.close();
+
+  if (!ok) return;
+  gMflnState = (head[0] <= MFLN_YES) ? head[0] : (uint8_t)MFLN_UNKNOWN;
+  memcpy(gSession.getSession(), &params, sizeof(params));
+  noteStored(gMflnState, params);
+}
+
+static void applyBufferSizes() {
+  // Default BearSSL sizes unless the server accepted MFLN.
+  if (gMflnState == MFLN_YES) {
+    (void)gClient.setBufferSizes(MFLN_SIZE, MFLN_SIZE);
+  } else {
+    (void)gClient.setBufferSizes(DEFAULT_RX_SIZE, DEFAULT_TX_SIZE);
+  }
+  gStats.mfln = gMflnState == MFLN_YES;
+}
+
+static uint32_t runningAvg(uint32_t avg, uint32_t count, uint32_t sample) {
+  return (count <= 1) ? sample : (uint32_t)((avg * (count - 1) + sample) / count);
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+void apiTlsSetup() {
+  gStats.enabled = true;
+  sessionLoad();
+
+  gClient.setKnownKey(&gPinnedKey);
+  gClient.setSession(&gSession);
+  gClient.setTimeout(CONNECT_TIMEOUT_MS);
+  applyBufferSizes();
+}
+
+bool apiTlsConnect(const IPAddress& ip, uint16_t port) {
+  apiTlsStop();
+
+  // MFLN support is a server property: the probe (a second blocking connect
+  // and partial handshake) runs once and its result is kept with the session.
+  // The probe also fails when the server is unreachable, so "no" is only
+  // believed once the real connect below gets through.
+  const bool probed = gMflnState == MFLN_UNKNOWN;
+  if (probed && BearSSL::WiFiClientSecure::probeMaxFragmentLength(ip, port, MFLN_SIZE)) {
+    gMflnState = MFLN_YES;
+    applyBufferSizes();
+  }
+
+  // Resumed == the server accepted the cached session ID.
+  br_ssl_session_parameters before;
+  memcpy(&before, gSession.getSession(), sizeof(before));
+
+  const uint32_t t0 = millis();
+  if (!gClient.connect(ip, port)) {
+    gStats.lastError = gClient.getLastSSLError();
+    gClient.stop();
+    // The server may have dropped MFLN since the probe: ask again next time.
+    // Kept in RAM only; an outage must not cost the persisted answer.
+    if (gMflnState == MFLN_YES) {
+      gMflnState = MFLN_UNKNOWN;
+      applyBufferSizes();
+    }
+    return false;
+  }
+  if (probed && gMflnState == MFLN_UNKNOWN) {
+    gMflnState = MFLN_NO;
+    applyBufferSizes();
+  }
+  const uint32_t ms = millis() - t0;
+
+  const br_ssl_session_parameters* after = gSession.getSession();
+  const bool resumed = before.session_id_len > 0 &&
+                       before.session_id_len == after->session_id_len &&
+                       memcmp(before.session_id, after->session_id, before.session_id_len) == 0;
+  sessionStore();  // new MFLN answer or session ID, if any
+
+  gStats.lastHandshakeMs = ms;
+  gStats.lastResumed = resumed;
+  if (resumed) {
+    gStats.resumedHandshakes++;
+    gStats.resumedAvgMs = runningAvg(gStats.resumedAvgMs, gStats.resumedHandshakes, ms);
+  } else {
+    gStats.fullHandshakes++;
+    gStats.fullAvgMs = runningAvg(gStats.fullAvgMs, gStats.fullHandshakes, ms);
+  }
+
+  gClient.setNoDelay(true);
+  gOpen = true;
+  return true;
+}
+
+bool apiTlsOpen() { return gOpen; }
+
+bool apiTlsConnected() { return gOpen && gClient.connected(); }
+
+size_t apiTlsAvailable() {
+  const int n = gOpen ? gClient.available() : 0;
+  return (n > 0) ? (size_t)n : 0;
+}
+
+size_t apiTlsRead(uint8_t* buf, size_t n) {
+  if (apiTlsAvailable() == 0) return 0;
+  const int r = gClient.read(buf, n);
+  return (r > 0) ? (size_t)r : 0;
+}
+
+size_t apiTlsWrite(const uint8_t* data, size_t len) {
+  if (!apiTlsConnected()) return 0;
+  return gClient.write(data, len);
+}
+
+void apiTlsStop() {
+  if (!gOpen) return;
+  gClient.stop();
+  gOpen = false;
+}
+
+void apiTlsGetStats(ApiTlsStats& out) { out = gStats; }
+
+#else  // !NOCTUA_API_TLS
+
+void apiTlsSetup() {}
+bool apiTlsConnect(const IPAddress&, uint16_t) { return false; }
+bool apiTlsOpen() { return false; }
+bool apiTlsConnected() { return false; }
+size_t apiTlsAvailable() { return 0; }
+size_t apiTlsRead(uint8_t*, size_t) { return 0; }
+size_t apiTlsWrite(const uint8_t*, size_t) { return 0; }
+void apiTlsStop() {}
+void apiTlsGetStats(ApiTlsStats& out) { out = ApiTlsStats{}; }
+
+#endif
@@ -0,0 +1,379 @@
+//dns_resolver.cpp
+
+#include "dns_resolver.h"
+
+#include <ESP8266WiFi.h>
+#include <ESP.h>
+#include <LittleFS.h>
+#include <lwip/pbuf.h>
+#include <lwip/udp.h>
+
+// ============================================================
+// Tuning
+// ============================================================
+
+static const uint16_t DNS_PORT = 53;
+static const uint8_t MAX_SERVERS = 4;
+
+// Public resolvers raced alongside the DHCP-provided ones.
+static const uint8_t FALLBACK_DNS[][4] = {
+  {1, 1, 1, 1},
+  {8, 8, 8, 8},
+};
+
+static const uint32_t RETRANSMIT_MS = 1500;
+static const uint32_t LOOKUP_TIMEOUT_MS = 4000;
+static const uint32_t RETRY_AFTER_FAIL_MS = 30000;
+
+static const uint32_t TTL_MIN_S = 30;
+static const uint32_t TTL_MAX_S = 24UL * 3600UL;
+
+static const char* CACHE_PATH = "/dns_cache.bin";
+static const uint32_t CACHE_MAGIC = 0x4E444331;  // 'NDC1'
+
+// ============================================================
+// State
+// ============================================================
+
+struct CacheFile {
+  uint32_t magic;
+  uint32_t hostHash;
+  uint8_t ip[4];
+};
+
+static const char* gHost = nullptr;
+static uint32_t gHostHash = 0;
+
+static uint8_t gQuery[272];
+static size_t gQueryLen = 0;
+
+static bool gHaveIp = false;
+static bool gLiteral = false;  // the host is an address: nothing to look up
+static IPAddress gIp;
+static uint32_t gFreshUntilMs = 0;
+static bool gStale = true;
+static IPAddress gPersistedIp;
+
+static udp_pcb* gPcb = nullptr;
+static bool gBusy = false;
+static uint16_t gTxId = 0;
+static uint32_t gStartMs = 0;
+static uint32_t gLastTxMs = 0;
+static uint32_t gRetryAfterMs = 0;
+
+static IPAddress gServers[MAX_SERVERS];
+static uint8_t gServerCount = 0;
+
+// Filled by the UDP callback.
+static bool gAnswered = false;
+static IPAddress gAnsIp;
+static IPAddress gAnsServer;
+static uint32_t gAnsTtlS = 0;
+
+static DnsResolverStats gStats = {};
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static uint32_t hostHash(const char* s) {
+  // FNV-1a
+  uint32_t h = 2166136261UL;
+  while (s && *s) {
+    h ^= (uint8_t)*s++;
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+// Precomputes the A/IN query for gHost; only the ID changes per lookup.
+static bool buildQuery() {
+  gQueryLen = 0;
+  if (!gHost || !gHost[0]) return false;
+
+  uint8_t* q = gQuery;
+  memset(q, 0, 12);
+  q[2] = 0x01;  // RD
+  q[5] = 0x01;  // QDCOUNT = 1
+  size_t pos = 12;
+
+  const char* label = gHost;
+  while (*label) {
+    const char* dot = strchr(label, '.');
+    const size_t len = dot ? (size_t)(dot - label) : strlen(label);
+    if (len == 0 || len > 63 || pos + 1 + len + 5 > sizeof(gQuery)) return false;
+    q[pos++] = (uint8_t)len;
+    memcpy(q + pos, label, len);
+    pos += len;
+    label += len;
+    if (*label == '.') label++;
+  }
+  q[pos++] = 0;
+  q[pos++] = 0x00; q[pos++] = 0x01;  // QTYPE A
+  q[pos++] = 0x00; q[pos++] = 0x01;  // QCLASS IN
+
+  gQueryLen = pos;
+  return true;
+}
+
+static bool skipName(const uint8_t* b, size_t n, size_t& pos) {
+  while (pos < n) {
+    const uint8_t len = b[pos];
+    if ((len & 0xC0) == 0xC0) {
+      pos += 2;
+      return pos <= n;
+    }
+    if (len == 0) {
+      pos += 1;
+      return true;
+    }
+    pos += 1 + len;
+  }
+  return false;
+}
+
+// Extracts the first A record; TTL is the minimum over the answer chain.
+static bool parseResponse(const uint8_t* b, size_t n, uint16_t id, IPAddress& ipOut, uint32_t& ttlOut) {
+  if (n < 12) return false;
+  if ((uint16_t)((b[0] << 8) | b[1]) != id) return false;
+  if (!(b[2] & 0x80)) return false;          // not a response
+  if ((b[3] & 0x0F) != 0) return false;      // RCODE != NOERROR
+
+  const uint16_t qd = (uint16_t)((b[4] << 8) | b[5]);
+  const uint16_t an = (uint16_t)((b[6] << 8) | b[7]);
+
+  size_t pos = 12;
+  for (uint16_t i = 0; i < qd; i++) {
+    if (!skipName(b, n, pos)) return false;
+    pos += 4;
+  }
+
+  bool found = false;
+  uint32_t ttlMin = TTL_MAX_S;
+  for (uint16_t i = 0; i < an; i++) {
+    if (!skipName(b, n, pos) || pos + 10 > n) return false;
+    const uint16_t type = (uint16_t)((b[pos] << 8) | b[pos + 1]);
+    const uint16_t cls = (uint16_t)((b[pos + 2] << 8) | b[pos + 3]);
+    const uint32_t ttl = ((uint32_t)b[pos + 4] << 24) | ((uint32_t)b[pos + 5] << 16) | ((uint32_t)b[pos + 6] << 8) | b[pos + 7];
+    const uint16_t rdlen = (uint16_t)((b[pos + 8] << 8) | b[pos + 9]);
+    pos += 10;
+    if (pos + rdlen > n) return false;
+
+    if (ttl < ttlMin) ttlMin = ttl;
+    if (!found && type == 1 && cls == 1 && rdlen == 4) {
+      ipOut = IPAddress(b[pos], b[pos + 1], b[pos + 2], b[pos + 3]);
+      found = true;
+    }
+    pos += rdlen;
+  }
+
+  ttlOut = ttlMin;
+  return found;
+}
+
+static void onUdpRecv(void* arg, udp_pcb* pcb, pbuf* p, const ip_addr_t* addr, uint16_t port) {
+  (void)arg;
+  (void)pcb;
+  if (!p) return;
+
+  static uint8_t buf[512];
+  const uint16_t n = pbuf_copy_partial(p, buf, sizeof(buf), 0);
+  pbuf_free(p);
+
+  if (!gBusy || gAnswered || port != DNS_PORT) return;
+
+  // Only accept answers from servers we actually asked.
+  const IPAddress from(addr);
+  bool known = false;
+  for (uint8_t i = 0; i < gServerCount; i++) {
+    if (gServers[i] == from) known = true;
+  }
+  if (!known) return;
+
+  IPAddress ip;
+  uint32_t ttl = 0;
+  if (!parseResponse(buf, n, gTxId, ip, ttl)) return;
+
+  gAnsIp = ip;
+  gAnsTtlS = ttl;
+  gAnsServer = from;
+  gAnswered = true;
+}
+
+static void addServer(const IPAddress& ip) {
+  if (!ip.isSet() || gServerCount >= MAX_SERVERS) return;
+  for (uint8_t i = 0; i < gServerCount; i++) {
+    if (gServers[i] == ip) return;
+  }
+  gServers[gServerCount++] = ip;
+}
+
+static void sendQueries() {
+  gQuery[0] = (uint8_t)(gTxId >> 8);
+  gQuery[1] = (uint8_t)(gTxId & 0xFF);
+
+  for (uint8_t i = 0; i < gServerCount; i++) {
+    pbuf* p = pbuf_alloc(PBUF_TRANSPORT, (uint16_t)gQueryLen, PBUF_RAM);
+    if (!p) return;
+    memcpy(p->payload, gQuery, gQueryLen);
+    const ip_addr_t dst = gServers[i];
+    (void)udp_sendto(gPcb, p, &dst, DNS_PORT);
+    pbuf_free(p);
+  }
+  gLastTxMs = millis();
+}
+
+static void persist() {
+  if (gPersistedIp == gIp) return;
+
+  // Runtime writes should never format flash. If mount fails, fail fast.
+  if (!LittleFS.begin()) return;
+
+  CacheFile cf;
+  cf.magic = CACHE_MAGIC;
+  cf.hostHash = gHostHash;
+  for (uint8_t i = 0; i < 4; i++) cf.ip[i] = gIp[i];
+
+  File f = LittleFS.open(CACHE_PATH, "w");
+  if (!f) return;
+  const size_t n = f.write((const uint8_t*)&cf, sizeof(cf));
+  f.close();
+  if (n == sizeof(cf)) gPersistedIp = gIp;
+}
+
+static void loadPersisted() {
+  if (!LittleFS.exists(CACHE_PATH)) return;
+
+  File f = LittleFS.open(CACHE_PATH, "r");
+  if (!f) return;
+  CacheFile cf;
+  const size_t n = f.read((uint8_t*)&cf, sizeof(cf));
+  f.close();
+
+  if (n != sizeof(cf) || cf.magic != CACHE_MAGIC || cf.hostHash != gHostHash) return;
+
+  const IPAddress ip(cf.ip[0], cf.ip[1], cf.ip[2], cf.ip[3]);
+  if (!ip.isSet()) return;
+
+  // Usable right away, but refreshed on first use.
+  gIp = ip;
+  gPersistedIp = ip;
+  gHaveIp = true;
+  gStale = true;
+}
+
+static void startLookup() {
+  if (gBusy || gQueryLen == 0) return;
+  if (WiFi.status() != WL_CONNECTED) return;
+  if (gRetryAfterMs && (int32_t)(millis() - gRetryAfterMs) < 0) return;
+
+  if (!gPcb) {
+    gPcb = udp_new();
+    if (!gPcb) return;
+    if (udp_bind(gPcb, IP_ADDR_ANY, 0) != ERR_OK) {
+      udp_remove(gPcb);
+      gPcb = nullptr;
+      return;
+    }
+    udp_recv(gPcb, onUdpRecv, nullptr);
+  }
+
+  gServerCount = 0;
+  addServer(WiFi.dnsIP(0));
+  addServer(WiFi.dnsIP(1));
+  for (const auto& fb : FALLBACK_DNS) addServer(IPAddress(fb[0], fb[1], fb[2], fb[3]));
+
+  gTxId = (uint16_t)ESP.random();
+  gAnswered = false;
+  gBusy = true;
+  gStartMs = millis();
+  gStats.lookups++;
+  sendQueries();
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+void dnsResolverSetup(const char* host) {
+  gHost = host;
+  gHostHash = hostHash(host);
+
+  // An IP literal (stand-in servers) is always fresh and never queried.
+  IPAddress literal;
+  if (host && literal.fromString(host)) {
+    gIp = literal;
+    gHaveIp = true;
+    gLiteral = true;
+    gStale = false;
+    return;
+  }
+
+  (void)buildQuery();
+  loadPersisted();
+}
+
+void dnsResolverLoop() {
+  if (!gBusy) return;
+
+  const uint32_t now = millis();
+
+  if (gAnswered) {
+    gBusy = false;
+    uint32_t ttl = gAnsTtlS;
+    if (ttl < TTL_MIN_S) ttl = TTL_MIN_S;
+    if (ttl > TTL_MAX_S) ttl = TTL_MAX_S;
+
+    gIp = gAnsIp;
+    gHaveIp = true;
+    gStale = false;
+    gFreshUntilMs = now + ttl * 1000UL;
+    gRetryAfterMs = 0;
+
+    gStats.server = gAnsServer;
+    gStats.lastLookupMs = now - gStartMs;
+    persist();
+    return;
+  }
+
+  if (now - gStartMs >= LOOKUP_TIMEOUT_MS) {
+    gBusy = false;
+    gStats.failures++;
+    gStats.lastLookupMs = now - gStartMs;
+    gRetryAfterMs = now + RETRY_AFTER_FAIL_MS;
+    return;
+  }
+
+  if (now - gLastTxMs >= RETRANSMIT_MS) sendQueries();
+}
+
+DnsCacheState dnsResolverGet(IPAddress& out) {
+  if (gLiteral) {
+    out = gIp;
+    return DnsCacheState::Fresh;
+  }
+  if (gHaveIp && !gStale && (int32_t)(millis() - gFreshUntilMs) >= 0) gStale = true;
+
+  if (!gHaveIp || gStale) startLookup();
+
+  if (!gHaveIp) return DnsCacheState::None;
+  out = gIp;
+  return gStale ? DnsCacheState::Stale : DnsCacheState::Fresh;
+}
+
+void dnsResolverInvalidate() {
+  if (gLiteral) return;
+  gStale = true;
+  gRetryAfterMs = 0;
+  startLookup();
+}
+
+bool dnsResolverBusy() { return gBusy; }
+
+void dnsResolverGetStats(DnsResolverStats& out) {
+  out = gStats;
+  out.ip = gHaveIp ? gIp : IPAddress();
+  out.stale = gStale;
+  const int32_t left = (int32_t)(gFreshUntilMs - millis());
+  out.ttlLeftS = (gHaveIp && !gStale && left > 0) ? (uint32_t)left / 1000 : 0;
+}
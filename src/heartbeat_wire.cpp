@@ -0,0 +1,81 @@
+//heartbeat_wire.cpp
+
+#include "heartbeat_wire.h"
+
+#include <string.h>
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static void put32(uint8_t* b, uint32_t v) {
+  b[0] = (uint8_t)(v >> 24);
+  b[1] = (uint8_t)(v >> 16);
+  b[2] = (uint8_t)(v >> 8);
+  b[3] = (uint8_t)v;
+}
+
+static uint32_t get32(const uint8_t* b) {
+  return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+}
+
+// Constant time: a forged ack learns nothing from how long we took.
+static bool macEqual(const uint8_t* a, const uint8_t* b) {
+  uint8_t diff = 0;
+  for (size_t i = 0; i < HB_MAC_LEN; i++) diff |= (uint8_t)(a[i] ^ b[i]);
+  return diff == 0;
+}
+
+// ============================================================
+// Packets
+// ============================================================
+
+void hbWireInit(uint8_t* pkt, const char* magic, uint8_t flags, uint32_t nonce,
+                const uint8_t* keyId) {
+  memset(pkt, 0, HB_LEN);
+  memcpy(pkt, magic, 4);
+  pkt[4] = flags;
+  put32(&pkt[6], nonce);
+  memcpy(&pkt[18], keyId, HB_KEY_ID_LEN);
+}
+
+void hbWireSeal(uint8_t* pkt, uint32_t seq, uint32_t uptimeS, HbMacFn mac) {
+  put32(&pkt[10], seq);
+  put32(&pkt[14], uptimeS);
+  mac(pkt, HB_MAC_AT, &pkt[HB_MAC_AT]);
+}
+
+bool hbWireParseAck(const uint8_t* buf, size_t len, uint32_t nonce, uint32_t seq, HbMacFn mac,
+                    HbAck& out) {
+  if (len != HB_ACK_LEN || memcmp(buf, "NHA1", 4) != 0) return false;
+  if (get32(&buf[6]) != nonce || get32(&buf[10]) != seq) return false;
+
+  uint8_t expect[HB_MAC_LEN];
+  mac(buf, HB_ACK_MAC_AT, expect);
+  if (!macEqual(&buf[HB_ACK_MAC_AT], expect)) return false;
+
+  out.status = buf[4];
+  out.intervalS = (uint16_t)((buf[14] << 8) | buf[15]);
+  out.retryAfterS = (uint16_t)((buf[16] << 8) | buf[17]);
+  return true;
+}
+
+// ============================================================
+// Retransmit schedule
+// ============================================================
+
+void hbRetxStart(HbRetransmit& r, uint32_t nowMs) {
+  r.sends = 1;
+  r.lastTxMs = nowMs;
+  r.waitMs = HB_ACK_TIMEOUT_MS;
+}
+
+HbRetxAction hbRetxPoll(HbRetransmit& r, uint32_t nowMs) {
+  if (nowMs - r.lastTxMs < r.waitMs) return HbRetxAction::Wait;
+  if (r.sends >= HB_MAX_SENDS) return HbRetxAction::GiveUp;
+
+  r.sends++;
+  r.lastTxMs = nowMs;
+  r.waitMs *= 2;
+  return HbRetxAction::Resend;
+}
@@ -0,0 +1,236 @@
+//http_parser.cpp
+
+#include "http_parser.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+// Matches "Name: value" (case-insensitive name) and returns the trimmed value.
+static bool headerValue(const char* line, const char* name, const char*& valueOut) {
+  const size_t n = strlen(name);
+  if (strncasecmp(line, name, n) != 0 || line[n] != ':') return false;
+  valueOut = line + n + 1;
+  while (*valueOut == ' ' || *valueOut == '\t') valueOut++;
+  return true;
+}
+
+// Case-insensitive search for a token in a comma-separated header value.
+static bool valueHasToken(const char* v, const char* token) {
+  const size_t n = strlen(token);
+  while (*v) {
+    while (*v == ' ' || *v == '\t' || *v == ',') v++;
+    if (strncasecmp(v, token, n) == 0 && (v[n] == 0 || v[n] == ',' || v[n] == ' ' || v[n] == ';')) return true;
+    while (*v && *v != ',') v++;
+  }
+  return false;
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// ============================================================
+// Line handling
+// ============================================================
+
+bool HttpResponseParser::lineByte(uint8_t c) {
+  if (c == '\r') return false;
+  if (c == '\n') {
+    _line[_lineLen] = 0;
+    return true;
+  }
+  // Over-long lines are truncated; nothing we parse is that long.
+  if (_lineLen + 1 < sizeof(_line)) _line[_lineLen++] = (char)c;
+  return false;
+}
+
+void HttpResponseParser::onStatusLine() {
+  // "HTTP/1.1 200 OK"
+  if (strncmp(_line, "HTTP/1.", 7) != 0) {
+    _state = State::Error;
+    return;
+  }
+  _http10 = (_line[7] == '0');
+
+  const char* sp = strchr(_line, ' ');
+  if (!sp) {
+    _state = State::Error;
+    return;
+  }
+  while (*sp == ' ') sp++;
+
+  if (!(sp[0] >= '0' && sp[0] <= '9') || !(sp[1] >= '0' && sp[1] <= '9') || !(sp[2] >= '0' && sp[2] <= '9')) {
+    _state = State::Error;
+    return;
+  }
+  _status = (sp[0] - '0') * 100 + (sp[1] - '0') * 10 + (sp[2] - '0');
+
+  // 1xx, 204 and 304 never carry a body.
+  _hasBody = !(_status < 200 || _status == 204 || _status == 304);
+  _state = State::Headers;
+}
+
+void HttpResponseParser::onHeaderLine() {
+  const char* v = nullptr;
+  if (headerValue(_line, "Content-Length", v)) {
+    char* end = nullptr;
+    const long n = strtol(v, &end, 10);
+    _contentLength = (end != v && n >= 0) ? (int32_t)n : -1;
+  } else if (headerValue(_line, "Transfer-Encoding", v)) {
+    _chunked = valueHasToken(v, "chunked");
+  } else if (headerValue(_line, "Connection", v)) {
+    if (valueHasToken(v, "close")) _close = true;
+    if (valueHasToken(v, "keep-alive")) _http10 = false;
+  } else if (headerValue(_line, "Retry-After", v)) {
+    // Only delta-seconds; an HTTP-date stays "unknown".
+    char* end = nullptr;
+    const long n = strtol(v, &end, 10);
+    if (end != v && n >= 0) _retryAfterS = (int32_t)n;
+  } else if (headerValue(_line, "X-Ping-Interval", v)) {
+    // Server-suggested ping interval in seconds.
+    char* end = nullptr;
+    const long n = strtol(v, &end, 10);
+    if (end != v && n > 0) _intervalHintS = (int32_t)n;
+  }
+}
+
+void HttpResponseParser::onHeadersEnd() {
+  // HTTP/1.0 without "Connection: keep-alive" closes after the response.
+  if (_http10) _close = true;
+
+  if (!_hasBody) {
+    _state = State::Done;
+  } else if (_chunked) {
+    _contentLength = -1;  // chunked wins over Content-Length
+    _state = State::ChunkSize;
+  } else if (_contentLength >= 0) {
+    _remaining = (uint32_t)_contentLength;
+    _state = (_remaining == 0) ? State::Done : State::Body;
+  } else {
+    // Unframed: body runs until the server closes.
+    _close = true;
+    _state = State::Body;
+  }
+}
+
+void HttpResponseParser::captureBody(const uint8_t* data, size_t n) {
+  _bodyBytes += (uint32_t)n;
+  if (!_bodyBuf || _bodyCap == 0) return;
+
+  const size_t room = _bodyCap - 1 - _bodyLen;
+  const size_t keep = (n < room) ? n : room;
+  memcpy(_bodyBuf + _bodyLen, data, keep);
+  _bodyLen += keep;
+  _bodyBuf[_bodyLen] = 0;
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+void HttpResponseParser::reset(char* bodyBuf, size_t bodyCap) {
+  _state = State::StatusLine;
+  _lineLen = 0;
+  _status = 0;
+  _contentLength = -1;
+  _retryAfterS = -1;
+  _intervalHintS = -1;
+  _chunked = false;
+  _close = false;
+  _http10 = false;
+  _hasBody = true;
+  _remaining = 0;
+  _bodyBytes = 0;
+  _bodyBuf = bodyBuf;
+  _bodyCap = bodyCap;
+  _bodyLen = 0;
+  if (_bodyBuf && _bodyCap) _bodyBuf[0] = 0;
+}
+
+size_t HttpResponseParser::feed(const uint8_t* data, size_t len) {
+  size_t i = 0;
+
+  while (i < len && _state != State::Done && _state != State::Error) {
+    switch (_state) {
+      case State::StatusLine:
+      case State::Headers:
+      case State::ChunkSize:
+      case State::ChunkEnd:
+      case State::Trailers: {
+        // Scan to the end of the line in one go.
+        const uint8_t* nl = (const uint8_t*)memchr(data + i, '\n', len - i);
+        const size_t stop = nl ? (size_t)(nl - data) + 1 : len;
+        bool complete = false;
+        for (; i < stop; i++) complete = lineByte(data[i]);
+        if (!complete) break;
+
+        if (_state == State::StatusLine) {
+          onStatusLine();
+        } else if (_state == State::Headers) {
+          if (_lineLen == 0) {
+            onHeadersEnd();
+          } else {
+            onHeaderLine();
+          }
+        } else if (_state == State::ChunkSize) {
+          // Hex size, optional ";ext".
+          uint32_t size = 0;
+          size_t k = 0;
+          int h;
+          for (; k < _lineLen && (h = hexValue(_line[k])) >= 0; k++) size = (size << 4) | (uint32_t)h;
+          if (k == 0 || k > 7) {
+            _state = State::Error;
+          } else if (size == 0) {
+            _state = State::Trailers;
+          } else {
+            _remaining = size;
+            _state = State::ChunkData;
+          }
+        } else if (_state == State::ChunkEnd) {
+          _state = (_lineLen == 0) ? State::ChunkSize : State::Error;
+        } else if (_lineLen == 0) {  // Trailers
+          _state = State::Done;
+        }
+        _lineLen = 0;
+        break;
+      }
+
+      case State::Body:
+      case State::ChunkData: {
+        size_t n = len - i;
+        const bool counted = (_state == State::ChunkData) || (_contentLength >= 0);
+        if (counted && n > _remaining) n = _remaining;
+
+        captureBody(data + i, n);
+        i += n;
+
+        if (counted) {
+          _remaining -= (uint32_t)n;
+          if (_remaining == 0) _state = (_state == State::ChunkData) ? State::ChunkEnd : State::Done;
+        }
+        break;
+      }
+
+      default:
+        break;
+    }
+  }
+
+  return i;
+}
+
+void HttpResponseParser::finishEof() {
+  if (_state == State::Body && _contentLength < 0) {
+    _state = State::Done;
+  } else if (_state != State::Done) {
+    _state = State::Error;
+  }
+}
@@ -19,6 +19,15 @@ static bool gLedEnabled = true;
 // Debounce
 static const uint32_t BOOT_DEBOUNCE_MS = 50;
 
+// Holding BOOT this long is a long press (short press fires on release).
+static const uint32_t BOOT_LONG_PRESS_MS = 3000;
+
+static bool gBootDown = false;
+static uint32_t gBootDownMs = 0;
+static bool gBootLongFired = false;
+static bool gBootShortPending = false;
+static bool gBootLongPending = false;
+
 // Blink rates
 static const uint32_t AP_BLINK_MS  = 120;  // fast blink for AP mode
 static const uint32_t STA_BLINK_MS = 700;  // slow blink for STA connecting
@@ -167,7 +176,7 @@ void ioSetHeartbeatEnabled(bool en) {
   }
 }
 
-bool ioBootPressedOnce() {
+static void bootPoll() {
   static bool last = HIGH;
   static uint32_t lastEdgeMs = 0;
 
@@ -177,9 +186,34 @@ bool ioBootPressedOnce() {
   if (cur != last && (now - lastEdgeMs) > BOOT_DEBOUNCE_MS) {
     lastEdgeMs = now;
     last = cur;
-    if (cur == LOW) return true;
+    if (cur == LOW) {
+      gBootDown = true;
+      gBootDownMs = now;
+      gBootLongFired = false;
+    } else if (gBootDown) {
+      gBootDown = false;
+      if (!gBootLongFired) gBootShortPending = true;
+    }
+  }
+
+  if (gBootDown && !gBootLongFired && (now - gBootDownMs) >= BOOT_LONG_PRESS_MS) {
+    gBootLongFired = true;
+    gBootLongPending = true;
   }
-  return false;
+}
+
+bool ioBootPressedOnce() {
+  bootPoll();
+  if (!gBootShortPending) return false;
+  gBootShortPending = false;
+  return true;
+}
+
+bool ioBootLongPressedOnce() {
+  bootPoll();
+  if (!gBootLongPending) return false;
+  gBootLongPending = false;
+  return true;
 }
 
 void ioSetApBlinkEnabled(bool en) {
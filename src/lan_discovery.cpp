@@ -0,0 +1,575 @@
+//lan_discovery.cpp
+
+#include "lan_discovery.h"
+
+#include <ESP8266WiFi.h>
+#include <ESP.h>
+#include <lwip/igmp.h>
+#include <lwip/pbuf.h>
+#include <lwip/udp.h>
+
+#include "noctua_portal.h"
+
+// ============================================================
+// Config
+// ============================================================
+
+#ifndef NOCTUA_LAN_DISCOVERY
+#define NOCTUA_LAN_DISCOVERY 1
+#endif
+
+#ifndef NOCTUA_DISCOVERY_PORT
+#define NOCTUA_DISCOVERY_PORT 7711
+#endif
+
+// Unsolicited "NDR1" broadcast period; 0 = answer queries only.
+#ifndef NOCTUA_DISCOVERY_BEACON_S
+#define NOCTUA_DISCOVERY_BEACON_S 300
+#endif
+
+// ============================================================
+// Tuning
+// ============================================================
+
+static const uint16_t MDNS_PORT = 5353;
+static const uint32_t MDNS_TTL_HOST_S = 120;    // records naming the host (RFC 6762 10)
+static const uint32_t MDNS_TTL_OTHER_S = 4500;
+static const uint32_t MDNS_MIN_GAP_MS = 1000;   // same answer at most once a second
+static const uint8_t ANNOUNCE_COUNT = 2;
+static const uint32_t ANNOUNCE_GAP_MS = 1000;
+
+static const uint32_t REPLY_JITTER_MS = 250;
+static const uint8_t PENDING_REPLIES = 4;
+
+static const uint32_t REFRESH_MS = 10000;       // rssi/uptime in the NDR1 JSON
+static const uint32_t REBUILD_MIN_MS = 1000;    // keeps in-flight buffers intact
+
+static const size_t PKT_SIZE = 320;
+static const size_t RX_SIZE = 512;
+
+static const uint16_t DNS_TYPE_A = 1;
+static const uint16_t DNS_TYPE_PTR = 12;
+static const uint16_t DNS_TYPE_TXT = 16;
+static const uint16_t DNS_TYPE_SRV = 33;
+static const uint16_t DNS_TYPE_ANY = 255;
+static const uint16_t DNS_CLASS_IN = 1;
+static const uint16_t DNS_CACHE_FLUSH = 0x8000;  // unique record (RFC 6762 10.2)
+
+// ============================================================
+// State
+// ============================================================
+
+struct Packet {
+  uint8_t data[PKT_SIZE];
+  uint16_t len;
+};
+
+// Double-buffered: a rebuild fills the idle copy and flips, so a datagram
+// still queued in the stack keeps pointing at unchanged bytes.
+struct PacketSlot {
+  Packet buf[2];
+  uint8_t cur;
+};
+
+static PacketSlot gHostPkt;     // mDNS: A
+static PacketSlot gServicePkt;  // mDNS: PTR/SRV/TXT (+A)
+static PacketSlot gBeaconPkt;   // "NDR1" + JSON
+
+struct PendingReply {
+  bool used;
+  ip_addr_t addr;
+  uint16_t port;
+  uint32_t dueMs;
+};
+
+static PendingReply gPending[PENDING_REPLIES];
+
+static udp_pcb* gMdnsPcb = nullptr;
+static udp_pcb* gDiscPcb = nullptr;
+
+static char gHost[16];            // noctua-abcdef
+static char gHostFqdn[24];        // noctua-abcdef.local
+static char gInstanceFqdn[40];    // noctua-abcdef._http._tcp.local
+static const char* SERVICE_FQDN = "_http._tcp.local";
+static const char* SERVICES_FQDN = "_services._dns-sd._udp.local";
+
+static bool gWifiUp = false;
+static IPAddress gIp;
+static IPAddress gBroadcast;
+
+// Filled by the mDNS callback, sent from the loop.
+static bool gWantHost = false;
+static bool gWantService = false;
+static uint32_t gHostSentMs = 0;
+static uint32_t gServiceSentMs = 0;
+static uint8_t gAnnounceLeft = 0;
+static uint32_t gAnnounceAtMs = 0;
+
+static uint32_t gBeaconAtMs = 0;
+
+// Status carried in TXT / JSON.
+static const char* gPing = "none";
+static const char* gInet = "unknown";
+static bool gDirty = true;
+static uint32_t gBuiltMs = 0;
+static uint32_t gUptimeS = 0;
+static uint32_t gUptimeMarkMs = 0;
+
+static uint8_t gRx[RX_SIZE];
+
+static LanDiscoveryStats gStats = {NOCTUA_LAN_DISCOVERY != 0, 0, 0, 0, 0, 0};
+
+// ============================================================
+// Packet writer (bounded; a packet that does not fit is not published)
+// ============================================================
+
+static Packet* gOut = nullptr;
+static bool gOutOk = false;
+
+static void outBegin(Packet& p) {
+  gOut = &p;
+  gOut->len = 0;
+  gOutOk = true;
+}
+
+static void out8(uint8_t v) {
+  if (gOut->len >= PKT_SIZE) {
+    gOutOk = false;
+    return;
+  }
+  gOut->data[gOut->len++] = v;
+}
+
+static void out16(uint16_t v) {
+  out8((uint8_t)(v >> 8));
+  out8((uint8_t)v);
+}
+
+static void out32(uint32_t v) {
+  out16((uint16_t)(v >> 16));
+  out16((uint16_t)v);
+}
+
+static void outBytes(const void* data, size_t len) {
+  const uint8_t* b = (const uint8_t*)data;
+  for (size_t i = 0; i < len; i++) out8(b[i]);
+}
+
+static uint16_t outMark() { return gOut->len; }
+
+static void outLabel(const char* s) {
+  const size_t len = strlen(s);
+  out8((uint8_t)len);
+  outBytes(s, len);
+}
+
+static void outPtr(uint16_t at) { out16((uint16_t)(0xC000 | at)); }
+
+static void outHeader(uint16_t answers, uint16_t additional) {
+  out16(0);       // id
+  out16(0x8400);  // response, authoritative
+  out16(0);
+  out16(answers);
+  out16(0);
+  out16(additional);
+}
+
+// Writes type/class/TTL and an rdlength placeholder; returns where the
+// rdata starts (for outRecordEnd()).
+static uint16_t outRecord(uint16_t type, uint16_t cls, uint32_t ttl) {
+  out16(type);
+  out16(cls);
+  out32(ttl);
+  out16(0);
+  return outMark();
+}
+
+static void outRecordEnd(uint16_t rdataAt) {
+  if (!gOutOk) return;
+  const uint16_t len = (uint16_t)(gOut->len - rdataAt);
+  gOut->data[rdataAt - 2] = (uint8_t)(len >> 8);
+  gOut->data[rdataAt - 1] = (uint8_t)len;
+}
+
+static void outIp() {
+  const uint32_t a = gIp.v4();  // network order
+  outBytes(&a, 4);
+}
+
+static void outTxt(const char* key, const char* value) {
+  char buf[64];
+  const int n = snprintf(buf, sizeof(buf), "%s=%s", key, value);
+  if (n <= 0 || (size_t)n >= sizeof(buf)) return;
+  out8((uint8_t)n);
+  outBytes(buf, (size_t)n);
+}
+
+// ============================================================
+// Precomputed packets
+// ============================================================
+
+static Packet& idle(PacketSlot& s) { return s.buf[s.cur ^ 1]; }
+
+static void publish(PacketSlot& s) {
+  if (!gOutOk) return;
+  s.cur ^= 1;
+}
+
+static void buildHost() {
+  outBegin(idle(gHostPkt));
+  outHeader(1, 0);
+  outLabel(gHost);
+  outLabel("local");
+  out8(0);
+  const uint16_t rd = outRecord(DNS_TYPE_A, DNS_CLASS_IN | DNS_CACHE_FLUSH, MDNS_TTL_HOST_S);
+  outIp();
+  outRecordEnd(rd);
+  publish(gHostPkt);
+}
+
+static void buildService() {
+  outBegin(idle(gServicePkt));
+  outHeader(4, 1);
+
+  // _http._tcp.local PTR noctua-abcdef._http._tcp.local
+  const uint16_t svcAt = outMark();
+  outLabel("_http");
+  outLabel("_tcp");
+  const uint16_t localAt = outMark();
+  outLabel("local");
+  out8(0);
+  uint16_t rd = outRecord(DNS_TYPE_PTR, DNS_CLASS_IN, MDNS_TTL_OTHER_S);
+  const uint16_t instanceAt = outMark();
+  outLabel(gHost);
+  outPtr(svcAt);
+  outRecordEnd(rd);
+
+  // SRV 0 0 80 noctua-abcdef.local
+  outPtr(instanceAt);
+  rd = outRecord(DNS_TYPE_SRV, DNS_CLASS_IN | DNS_CACHE_FLUSH, MDNS_TTL_HOST_S);
+  out16(0);
+  out16(0);
+  out16(80);
+  const uint16_t hostAt = outMark();
+  outLabel(gHost);
+  outPtr(localAt);
+  outRecordEnd(rd);
+
+  // TXT
+  char id[8];
+  snprintf(id, sizeof(id), "%06x", ESP.getChipId());
+  outPtr(instanceAt);
+  rd = outRecord(DNS_TYPE_TXT, DNS_CLASS_IN | DNS_CACHE_FLUSH, MDNS_TTL_OTHER_S);
+  outTxt("id", id);
+  outTxt("fw", portalFirmwareVersion());
+  outTxt("ping", gPing);
+  outTxt("inet", gInet);
+  outRecordEnd(rd);
+
+  // _services._dns-sd._udp.local PTR _http._tcp.local (service browsing)
+  outLabel("_services");
+  outLabel("_dns-sd");
+  outLabel("_udp");
+  outPtr(localAt);
+  rd = outRecord(DNS_TYPE_PTR, DNS_CLASS_IN, MDNS_TTL_OTHER_S);
+  outPtr(svcAt);
+  outRecordEnd(rd);
+
+  // Additional: A, so one answer is enough to connect.
+  outPtr(hostAt);
+  rd = outRecord(DNS_TYPE_A, DNS_CLASS_IN | DNS_CACHE_FLUSH, MDNS_TTL_HOST_S);
+  outIp();
+  outRecordEnd(rd);
+
+  publish(gServicePkt);
+}
+
+static void buildBeacon() {
+  const uint32_t ip = gIp.v4();
+  const uint8_t* b = (const uint8_t*)&ip;
+  const int rssi = gWifiUp ? (int)WiFi.RSSI() : 0;
+
+  char json[PKT_SIZE - 4];
+  const int n = snprintf(json, sizeof(json),
+                         "{\"id\":\"%06x\",\"host\":\"%s\",\"ip\":\"%u.%u.%u.%u\",\"fw\":\"%s\",\"ping\":\"%s\","
+                         "\"inet\":\"%s\",\"rssi\":%d,\"up_s\":%lu,\"channels\":%u}",
+                         ESP.getChipId(), gHost, b[0], b[1], b[2], b[3], portalFirmwareVersion(), gPing, gInet,
+                         rssi, (unsigned long)gUptimeS, (unsigned)apiChannelCount());
+  if (n <= 0 || (size_t)n >= sizeof(json)) return;
+
+  outBegin(idle(gBeaconPkt));
+  outBytes("NDR1", 4);
+  outBytes(json, (size_t)n);
+  publish(gBeaconPkt);
+}
+
+static void rebuild() {
+  buildHost();
+  buildService();
+  buildBeacon();
+  gDirty = false;
+  gBuiltMs = millis();
+  gStats.rebuilds++;
+}
+
+// Sends the current copy without copying it (the pbuf references it).
+static bool sendSlot(udp_pcb* pcb, const PacketSlot& s, const ip_addr_t* dst, uint16_t port) {
+  const Packet& p = s.buf[s.cur];
+  if (!pcb || p.len == 0) return false;
+
+  pbuf* pb = pbuf_alloc(PBUF_TRANSPORT, p.len, PBUF_REF);
+  if (!pb) return false;
+  pb->payload = (void*)p.data;
+  const err_t err = udp_sendto(pcb, pb, dst, port);
+  pbuf_free(pb);
+  return err == ERR_OK;
+}
+
+static bool sendMdns(const PacketSlot& s) {
+  const ip_addr_t group = IPAddress(224, 0, 0, 251);
+  return sendSlot(gMdnsPcb, s, &group, MDNS_PORT);
+}
+
+// ============================================================
+// Query handling (lwIP callbacks)
+// ============================================================
+
+static uint16_t get16(const uint8_t* b) { return (uint16_t)((b[0] << 8) | b[1]); }
+
+// Reads a (possibly compressed) name at *off as lower-case dotted text and
+// moves *off past it. False on malformed input or overflow.
+static bool readName(size_t len, size_t* off, char* out, size_t cap) {
+  size_t pos = *off;
+  size_t n = 0;
+  bool jumped = false;
+
+  for (uint8_t hops = 0; hops < 16; hops++) {
+    if (pos >= len) return false;
+    const uint8_t l = gRx[pos];
+
+    if ((l & 0xC0) == 0xC0) {
+      if (pos + 1 >= len) return false;
+      if (!jumped) *off = pos + 2;
+      jumped = true;
+      pos = ((l & 0x3F) << 8) | gRx[pos + 1];
+      continue;
+    }
+    if (l == 0) {
+      if (!jumped) *off = pos + 1;
+      out[n] = 0;
+      return true;
+    }
+    if (l > 63 || pos + 1 + l > len || n + l + 2 > cap) return false;
+
+    if (n) out[n++] = '.';
+    for (uint8_t i = 0; i < l; i++) out[n++] = (char)tolower(gRx[pos + 1 + i]);
+    pos += 1 + l;
+  }
+  return false;
+}
+
+static void onMdnsRecv(void* arg, udp_pcb* pcb, pbuf* p, const ip_addr_t* addr, uint16_t port) {
+  (void)arg;
+  (void)pcb;
+  (void)addr;
+  if (!p) return;
+  const size_t len = pbuf_copy_partial(p, gRx, sizeof(gRx), 0);
+  pbuf_free(p);
+
+  // Responses and legacy (non-5353) queries are not ours to answer.
+  if (len < 12 || port != MDNS_PORT || (gRx[2] & 0x80)) return;
+
+  const uint16_t questions = get16(&gRx[4]);
+  size_t off = 12;
+  char name[64];
+
+  for (uint16_t q = 0; q < questions && q < 16; q++) {
+    if (!readName(len, &off, name, sizeof(name)) || off + 4 > len) return;
+    const uint16_t type = get16(&gRx[off]);
+    off += 4;
+
+    const bool any = type == DNS_TYPE_ANY;
+    bool hit = false;
+    if (strcmp(name, gHostFqdn) == 0 && (any || type == DNS_TYPE_A)) {
+      gWantHost = hit = true;
+    } else if ((strcmp(name, SERVICE_FQDN) == 0 || strcmp(name, SERVICES_FQDN) == 0) &&
+               (any || type == DNS_TYPE_PTR)) {
+      gWantService = hit = true;
+    } else if (strcmp(name, gInstanceFqdn) == 0 && (any || type == DNS_TYPE_SRV || type == DNS_TYPE_TXT)) {
+      gWantService = hit = true;
+    }
+    if (hit) gStats.mdnsQueries++;
+  }
+}
+
+static void onDiscoveryRecv(void* arg, udp_pcb* pcb, pbuf* p, const ip_addr_t* addr, uint16_t port) {
+  (void)arg;
+  (void)pcb;
+  if (!p) return;
+  uint8_t magic[4];
+  const uint16_t n = pbuf_copy_partial(p, magic, sizeof(magic), 0);
+  pbuf_free(p);
+
+  if (n != sizeof(magic) || memcmp(magic, "NDQ1", 4) != 0) return;
+  gStats.queries++;
+
+  for (PendingReply& r : gPending) {
+    if (r.used) continue;
+    r.used = true;
+    r.addr = *addr;
+    r.port = port;
+    r.dueMs = millis() + ESP.random() % REPLY_JITTER_MS;
+    return;
+  }
+  // All slots busy: the tool repeats its query anyway.
+}
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static void updateUptime() {
+  const uint32_t ms = millis();
+  const uint32_t whole = (ms - gUptimeMarkMs) / 1000;
+  gUptimeS += whole;
+  gUptimeMarkMs += whole * 1000;
+}
+
+static void setStatus(const char*& field, const char* value) {
+  if (strcmp(field, value) == 0) return;
+  field = value;
+  gDirty = true;
+}
+
+static void mdnsGroup(bool join) {
+  ip4_addr_t any;
+  any.addr = 0;
+  const ip_addr_t group = IPAddress(224, 0, 0, 251);
+  if (join) {
+    (void)igmp_joingroup(&any, ip_2_ip4(&group));
+  } else {
+    (void)igmp_leavegroup(&any, ip_2_ip4(&group));
+  }
+}
+
+static void onWifiUp() {
+  gIp = WiFi.localIP();
+  gBroadcast = IPAddress(gIp.v4() | ~WiFi.subnetMask().v4());
+  mdnsGroup(true);
+
+  rebuild();
+  gAnnounceLeft = ANNOUNCE_COUNT;
+  gAnnounceAtMs = millis();
+  gBeaconAtMs = millis();
+}
+
+static void onWifiDown() {
+  mdnsGroup(false);
+  gWantHost = gWantService = false;
+  gAnnounceLeft = 0;
+  for (PendingReply& r : gPending) r.used = false;
+}
+
+static void sendPending(uint32_t now) {
+  for (PendingReply& r : gPending) {
+    if (!r.used || (int32_t)(now - r.dueMs) < 0) continue;
+    r.used = false;
+    if (sendSlot(gDiscPcb, gBeaconPkt, &r.addr, r.port)) gStats.replies++;
+  }
+}
+
+static void sendMdnsAnswers(uint32_t now) {
+  if (gAnnounceLeft && (int32_t)(now - gAnnounceAtMs) >= 0) {
+    gAnnounceLeft--;
+    gAnnounceAtMs = now + ANNOUNCE_GAP_MS;
+    gWantService = true;
+  }
+
+  if (gWantHost) {
+    gWantHost = false;
+    if (now - gHostSentMs >= MDNS_MIN_GAP_MS && sendMdns(gHostPkt)) {
+      gHostSentMs = now;
+      gStats.mdnsReplies++;
+    }
+  }
+  if (gWantService) {
+    gWantService = false;
+    if (now - gServiceSentMs >= MDNS_MIN_GAP_MS && sendMdns(gServicePkt)) {
+      gServiceSentMs = now;
+      gStats.mdnsReplies++;
+    }
+  }
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+void lanDiscoverySetup() {
+  if (!gStats.enabled) return;
+
+  const uint32_t id = ESP.getChipId();
+  snprintf(gHost, sizeof(gHost), "noctua-%06x", id);
+  snprintf(gHostFqdn, sizeof(gHostFqdn), "%s.local", gHost);
+  snprintf(gInstanceFqdn, sizeof(gInstanceFqdn), "%s.%s", gHost, SERVICE_FQDN);
+  // Same name in DHCP leases as on mDNS.
+  WiFi.hostname(gHost);
+
+  gUptimeMarkMs = millis();
+
+  gMdnsPcb = udp_new();
+  if (gMdnsPcb && udp_bind(gMdnsPcb, IP_ADDR_ANY, MDNS_PORT) == ERR_OK) {
+    udp_set_multicast_ttl(gMdnsPcb, 255);
+    udp_recv(gMdnsPcb, onMdnsRecv, nullptr);
+  } else if (gMdnsPcb) {
+    udp_remove(gMdnsPcb);
+    gMdnsPcb = nullptr;
+  }
+
+  gDiscPcb = udp_new();
+  if (gDiscPcb && udp_bind(gDiscPcb, IP_ADDR_ANY, NOCTUA_DISCOVERY_PORT) == ERR_OK) {
+    ip_set_option(gDiscPcb, SOF_BROADCAST);
+    udp_recv(gDiscPcb, onDiscoveryRecv, nullptr);
+  } else if (gDiscPcb) {
+    udp_remove(gDiscPcb);
+    gDiscPcb = nullptr;
+  }
+}
+
+void lanDiscoveryNotePing(const ApiPingResult& r) {
+  if (!gStats.enabled) return;
+  setStatus(gPing, r.ok ? "ok" : "fail");
+}
+
+void lanDiscoveryLoop(bool wifiUp, bool internetKnown, bool internetUp) {
+  if (!gStats.enabled) return;
+
+  if (wifiUp != gWifiUp) {
+    gWifiUp = wifiUp;
+    if (wifiUp) {
+      onWifiUp();
+    } else {
+      onWifiDown();
+    }
+  }
+  if (!wifiUp) return;
+
+  const uint32_t now = millis();
+  updateUptime();
+  setStatus(gInet, !internetKnown ? "unknown" : internetUp ? "up" : "down");
+  if (now - gBuiltMs >= REFRESH_MS) gDirty = true;
+  if (gDirty && now - gBuiltMs >= REBUILD_MIN_MS) rebuild();
+
+  sendMdnsAnswers(now);
+  sendPending(now);
+
+  if (NOCTUA_DISCOVERY_BEACON_S && (int32_t)(now - gBeaconAtMs) >= 0) {
+    gBeaconAtMs = now + NOCTUA_DISCOVERY_BEACON_S * 1000UL + ESP.random() % (NOCTUA_DISCOVERY_BEACON_S * 100UL + 1);
+    const ip_addr_t dst = gBroadcast;
+    if (sendSlot(gDiscPcb, gBeaconPkt, &dst, NOCTUA_DISCOVERY_PORT)) gStats.replies++;
+  }
+}
+
+const char* lanDiscoveryHostName() { return gHost; }
+
+void lanDiscoveryGetStats(LanDiscoveryStats& out) { out = gStats; }
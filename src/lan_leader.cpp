@@ -0,0 +1,200 @@
+//lan_leader.cpp
+
+#include "lan_leader.h"
+
+#include <ESP8266WiFi.h>
+#include <ESP.h>
+#include <bearssl/bearssl.h>
+#include <lwip/igmp.h>
+#include <lwip/pbuf.h>
+#include <lwip/udp.h>
+
+#include "noctua_portal.h"
+
+// ============================================================
+// Config
+// ============================================================
+
+#ifndef NOCTUA_LEADER_ELECTION
+#define NOCTUA_LEADER_ELECTION 1
+#endif
+
+// Administratively scoped; hellos never leave the subnet (TTL 1).
+#ifndef NOCTUA_LEADER_GROUP
+#define NOCTUA_LEADER_GROUP "239.255.78.76"
+#endif
+
+#ifndef NOCTUA_LEADER_PORT
+#define NOCTUA_LEADER_PORT 7712
+#endif
+
+// ============================================================
+// State
+// ============================================================
+
+static LeaderElection gElection;
+
+static udp_pcb* gPcb = nullptr;
+static IPAddress gGroup;
+
+static br_hmac_key_context gKey;
+static bool gKeyReady = false;
+static bool gWifiUp = false;
+
+static const bool ENABLED = NOCTUA_LEADER_ELECTION != 0;
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static void mac(const uint8_t* data, size_t len, uint8_t* out) {
+  br_hmac_context ctx;
+  uint8_t full[br_sha256_SIZE];
+  br_hmac_init(&ctx, &gKey, 0);
+  br_hmac_update(&ctx, data, len);
+  br_hmac_out(&ctx, full);
+  memcpy(out, full, LEADER_MAC_LEN);
+}
+
+static uint32_t random32() { return ESP.random(); }
+
+static bool sendPacket(const uint8_t* pkt, size_t len) {
+  pbuf* p = pbuf_alloc(PBUF_TRANSPORT, (uint16_t)len, PBUF_RAM);
+  if (!p) return false;
+  memcpy(p->payload, pkt, len);
+  const ip_addr_t dst = gGroup;
+  const bool ok = udp_sendto(gPcb, p, &dst, NOCTUA_LEADER_PORT) == ERR_OK;
+  pbuf_free(p);
+  return ok;
+}
+
+static void loadKey() {
+  const char* key = portalChannelKey(0);
+  const size_t len = strlen(key);
+  gKeyReady = len > 0;
+  if (!gKeyReady) return;
+
+  br_hmac_key_init(&gKey, &br_sha256_vtable, key, len);
+
+  // Units with different extra keys report different circuits: not a group.
+  br_sha256_context sha;
+  uint8_t digest[br_sha256_SIZE];
+  br_sha256_init(&sha);
+  for (uint8_t i = 0; i < portalChannelKeyCount(); i++) {
+    if (i) br_sha256_update(&sha, "\n", 1);
+    const char* k = portalChannelKey(i);
+    br_sha256_update(&sha, k, strlen(k));
+  }
+  br_sha256_out(&sha, digest);
+  memcpy(gElection.groupId, digest, LEADER_GROUP_ID_LEN);
+}
+
+static void onUdpRecv(void* arg, udp_pcb* pcb, pbuf* p, const ip_addr_t* addr, uint16_t port) {
+  (void)arg;
+  (void)pcb;
+  (void)addr;
+  (void)port;
+  if (!p) return;
+
+  uint8_t buf[LEADER_HELLO_LEN + 1];
+  const uint16_t n = pbuf_copy_partial(p, buf, sizeof(buf), 0);
+  pbuf_free(p);
+  if (gKeyReady) leaderRecv(gElection, buf, n, millis());
+}
+
+static void joinGroup(bool join) {
+  ip4_addr_t any;
+  any.addr = 0;
+  const ip_addr_t group = gGroup;
+  if (join) {
+    (void)igmp_joingroup(&any, ip_2_ip4(&group));
+  } else {
+    (void)igmp_leavegroup(&any, ip_2_ip4(&group));
+  }
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+void lanLeaderSetup() {
+  if (!ENABLED) return;
+
+  // A fresh nonce per boot: seq restarts at 1 without looking like a replay.
+  leaderInit(gElection, ESP.getChipId(), ESP.random(), mac, sendPacket, random32);
+  (void)gGroup.fromString(NOCTUA_LEADER_GROUP);
+  loadKey();
+
+  gPcb = udp_new();
+  if (!gPcb) return;
+  if (udp_bind(gPcb, IP_ADDR_ANY, NOCTUA_LEADER_PORT) != ERR_OK) {
+    udp_remove(gPcb);
+    gPcb = nullptr;
+    return;
+  }
+  udp_set_multicast_ttl(gPcb, 1);
+  udp_recv(gPcb, onUdpRecv, nullptr);
+}
+
+void lanLeaderConfigChanged() {
+  if (!ENABLED) return;
+  loadKey();
+  if (gWifiUp && gKeyReady) leaderStart(gElection, millis());
+}
+
+void lanLeaderNotePing(const ApiPingResult& r) {
+  if (!ENABLED) return;
+  leaderNotePing(gElection, r.ok);
+}
+
+void lanLeaderLoop(bool wifiUp, bool canLead) {
+  if (!ENABLED || !gPcb) return;
+
+  const uint32_t now = millis();
+  const LeaderRole was = gElection.role;
+  if (wifiUp != gWifiUp) {
+    gWifiUp = wifiUp;
+    joinGroup(wifiUp);
+    if (wifiUp && gKeyReady) {
+      leaderStart(gElection, now);
+    } else {
+      leaderStop(gElection);
+    }
+  }
+  if (!gKeyReady) leaderStop(gElection);
+
+  leaderLoop(gElection, now, canLead);
+  if (gElection.role != was) {
+    Serial.printf("leader: %s -> %s\n", lanLeaderRoleText(was), lanLeaderRoleText(gElection.role));
+  }
+}
+
+bool lanLeaderSkipPing() {
+  if (!ENABLED) return false;
+  return leaderSkipPing(gElection, millis());
+}
+
+bool lanLeaderTakeTakeover() { return ENABLED && leaderTakeTakeover(gElection); }
+
+const char* lanLeaderRoleText(LeaderRole role) {
+  switch (role) {
+    case LeaderRole::Listening: return "listening";
+    case LeaderRole::Leader: return "leader";
+    case LeaderRole::Follower: return "follower";
+    default: return "off";
+  }
+}
+
+void lanLeaderGetStats(LanLeaderStats& out) {
+  const LeaderElection& e = gElection;
+  out.enabled = ENABLED;
+  out.role = e.role;
+  out.leaderId = e.leaderId;
+  out.peers = e.livePeers;
+  out.elections = e.elections;
+  out.takeovers = e.takeovers;
+  out.skipped = e.skipped;
+  out.sent = e.sent;
+  out.received = e.received;
+  out.rejected = e.rejected;
+}
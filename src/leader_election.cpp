@@ -0,0 +1,351 @@
+//leader_election.cpp
+
+#include "leader_election.h"
+
+#include <string.h>
+
+// ============================================================
+// Tuning
+// ============================================================
+
+static const uint8_t FAILS_UNHEALTHY = 2;
+
+static const size_t ID_AT = 14;
+static const size_t NONCE_AT = 18;
+static const size_t SEQ_AT = 22;
+static const size_t CHALLENGE_AT = 26;
+static const size_t ECHO_AT = 30;
+
+static const uint8_t FLAG_LEADER = 0x01;
+static const uint8_t FLAG_HEALTHY = 0x02;
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static void put32(uint8_t* b, uint32_t v) {
+  b[0] = (uint8_t)(v >> 24);
+  b[1] = (uint8_t)(v >> 16);
+  b[2] = (uint8_t)(v >> 8);
+  b[3] = (uint8_t)v;
+}
+
+static uint32_t get32(const uint8_t* b) {
+  return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+}
+
+// Constant time: a forged hello learns nothing from how long we took.
+static bool macEqual(const uint8_t* a, const uint8_t* b) {
+  uint8_t diff = 0;
+  for (size_t i = 0; i < LEADER_MAC_LEN; i++) diff |= (uint8_t)(a[i] ^ b[i]);
+  return diff == 0;
+}
+
+static void resetPeers(LeaderElection& e) {
+  for (LeaderPeer& p : e.peers) p.used = false;
+}
+
+// A new challenge per scheduled hello; replies repeat the current one.
+static void newChallenge(LeaderElection& e, uint32_t now) {
+  LeaderChallenge& c = e.challenges[e.nextChallenge];
+  c.used = true;
+  c.value = e.random();
+  c.issuedMs = now;
+  e.nextChallenge = (uint8_t)((e.nextChallenge + 1) % LEADER_CHALLENGES);
+}
+
+static const LeaderChallenge* currentChallenge(const LeaderElection& e) {
+  const LeaderChallenge& c =
+      e.challenges[(e.nextChallenge + LEADER_CHALLENGES - 1) % LEADER_CHALLENGES];
+  return c.used ? &c : nullptr;
+}
+
+// The newest of our live challenges echoed in a hello: the hello was made
+// after we issued it, so a recorded one goes stale like the original.
+static bool echoedChallenge(const LeaderElection& e, const uint8_t* echo, uint8_t count,
+                            uint32_t now, uint32_t& issuedMs) {
+  bool found = false;
+  for (uint8_t i = 0; i < count; i++) {
+    const uint32_t v = get32(&echo[4 * i]);
+    for (const LeaderChallenge& c : e.challenges) {
+      if (!c.used || c.value != v || now - c.issuedMs >= LEADER_LIVE_MS) continue;
+      if (!found || (int32_t)(c.issuedMs - issuedMs) > 0) issuedMs = c.issuedMs;
+      found = true;
+    }
+  }
+  return found;
+}
+
+// A unit that cannot ping (supply failing) must not win an election.
+static bool healthy(const LeaderElection& e) {
+  return e.canLead && e.failStreak < FAILS_UNHEALTHY;
+}
+
+static bool peerLive(const LeaderPeer& p, uint32_t now) {
+  return p.used && p.fresh && now - p.heardMs < LEADER_LIVE_MS;
+}
+
+// Healthy beats unhealthy, then the lower chip id wins.
+static bool better(bool aHealthy, uint32_t aId, bool bHealthy, uint32_t bId) {
+  if (aHealthy != bHealthy) return aHealthy;
+  return aId < bId;
+}
+
+static bool peerBeatsUs(const LeaderElection& e, const LeaderPeer& p) {
+  return better(p.flags & FLAG_HEALTHY, p.id, healthy(e), e.id);
+}
+
+// The best live peer claiming leadership (two only right after a partition).
+static const LeaderPeer* liveLeader(const LeaderElection& e, uint32_t now) {
+  const LeaderPeer* best = nullptr;
+  for (const LeaderPeer& p : e.peers) {
+    if (!peerLive(p, now) || !(p.flags & FLAG_LEADER)) continue;
+    if (!best || better(p.flags & FLAG_HEALTHY, p.id, best->flags & FLAG_HEALTHY, best->id)) {
+      best = &p;
+    }
+  }
+  return best;
+}
+
+static bool bestCandidate(const LeaderElection& e, uint32_t now) {
+  for (const LeaderPeer& p : e.peers) {
+    if (peerLive(p, now) && peerBeatsUs(e, p)) return false;
+  }
+  return true;
+}
+
+static bool anyHealthyPeer(const LeaderElection& e, uint32_t now) {
+  for (const LeaderPeer& p : e.peers) {
+    if (peerLive(p, now) && (p.flags & FLAG_HEALTHY)) return true;
+  }
+  return false;
+}
+
+static void setRole(LeaderElection& e, LeaderRole role, uint32_t now) {
+  if (role == e.role) return;
+  const LeaderRole was = e.role;
+  e.role = role;
+  e.helloNow = true;
+
+  if (role == LeaderRole::Leader) {
+    e.elections++;
+    if (was == LeaderRole::Follower) {
+      e.takeovers++;
+      e.takeover = true;
+    }
+  } else {
+    e.takeover = false;
+  }
+  if (role == LeaderRole::Follower) e.noLeaderSinceMs = now;
+}
+
+static void elect(LeaderElection& e, uint32_t now) {
+  const LeaderPeer* leader = liveLeader(e, now);
+
+  switch (e.role) {
+    case LeaderRole::Listening:
+      if (leader) {
+        setRole(e, LeaderRole::Follower, now);
+      } else if ((int32_t)(now - e.listenUntilMs) >= 0) {
+        const bool lead = e.canLead && bestCandidate(e, now);
+        setRole(e, lead ? LeaderRole::Leader : LeaderRole::Follower, now);
+      }
+      break;
+
+    case LeaderRole::Follower:
+      if (leader) {
+        e.noLeaderSinceMs = now;
+      } else if (e.canLead &&
+                 (bestCandidate(e, now) || now - e.noLeaderSinceMs >= LEADER_LIVE_MS)) {
+        setRole(e, LeaderRole::Leader, now);
+      }
+      break;
+
+    case LeaderRole::Leader:
+      if (!e.canLead || (leader && peerBeatsUs(e, *leader)) ||
+          (!healthy(e) && anyHealthyPeer(e, now))) {
+        setRole(e, LeaderRole::Follower, now);
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  if (e.role == LeaderRole::Leader) {
+    e.leaderId = e.id;
+  } else {
+    e.leaderId = leader ? leader->id : 0;
+  }
+}
+
+static void sendHello(LeaderElection& e, uint32_t now) {
+  e.helloNow = false;
+  e.replyPending = false;
+  e.replyMs = now;
+
+  uint8_t pkt[LEADER_HELLO_LEN];
+  memset(pkt, 0, sizeof(pkt));
+  memcpy(pkt, "NLE2", 4);
+  if (e.role == LeaderRole::Leader) pkt[4] |= FLAG_LEADER;
+  if (healthy(e)) pkt[4] |= FLAG_HEALTHY;
+  memcpy(&pkt[6], e.groupId, LEADER_GROUP_ID_LEN);
+  put32(&pkt[ID_AT], e.id);
+  put32(&pkt[NONCE_AT], e.nonce);
+  put32(&pkt[SEQ_AT], ++e.seq);
+  const LeaderChallenge* c = currentChallenge(e);
+  put32(&pkt[CHALLENGE_AT], c ? c->value : 0);
+
+  uint8_t count = 0;
+  for (const LeaderPeer& p : e.peers) {
+    if (p.used) put32(&pkt[ECHO_AT + 4 * count++], p.challenge);
+  }
+  pkt[5] = count;
+  e.mac(pkt, LEADER_MAC_AT, &pkt[LEADER_MAC_AT]);
+
+  if (e.send(pkt, sizeof(pkt))) e.sent++;
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+void leaderInit(LeaderElection& e, uint32_t id, uint32_t nonce, LeaderMacFn mac,
+                LeaderSendFn send, LeaderRandomFn random) {
+  memset(&e, 0, sizeof(e));
+  e.id = id;
+  e.nonce = nonce;
+  e.mac = mac;
+  e.send = send;
+  e.random = random;
+  e.canLead = true;
+}
+
+void leaderStart(LeaderElection& e, uint32_t nowMs) {
+  resetPeers(e);
+  for (LeaderChallenge& c : e.challenges) c.used = false;
+  e.role = LeaderRole::Listening;
+  e.leaderId = 0;
+  e.listenUntilMs = nowMs + LEADER_LISTEN_MS;
+  e.takeover = false;
+  e.helloAtMs = nowMs;  // announce ourselves; the leader answers at once
+}
+
+void leaderStop(LeaderElection& e) {
+  resetPeers(e);
+  e.role = LeaderRole::Off;
+  e.leaderId = 0;
+  e.livePeers = 0;
+  e.takeover = false;
+}
+
+void leaderNotePing(LeaderElection& e, bool ok) {
+  const bool wasHealthy = healthy(e);
+  if (ok) {
+    e.failStreak = 0;
+  } else if (e.failStreak < 255) {
+    e.failStreak++;
+  }
+  if (healthy(e) != wasHealthy) e.helloNow = true;
+}
+
+void leaderRecv(LeaderElection& e, const uint8_t* buf, size_t len, uint32_t nowMs) {
+  // Other groups share the multicast address; they are not an error.
+  if (e.role == LeaderRole::Off || len != LEADER_HELLO_LEN || memcmp(buf, "NLE2", 4) != 0 ||
+      memcmp(&buf[6], e.groupId, LEADER_GROUP_ID_LEN) != 0) {
+    return;
+  }
+  const uint32_t id = get32(&buf[ID_AT]);
+  const uint8_t count = buf[5];
+  if (id == e.id || count > LEADER_MAX_PEERS) return;
+
+  uint8_t expect[LEADER_MAC_LEN];
+  e.mac(buf, LEADER_MAC_AT, expect);
+  if (!macEqual(&buf[LEADER_MAC_AT], expect)) {
+    e.rejected++;
+    return;
+  }
+
+  LeaderPeer* slot = nullptr;
+  LeaderPeer* oldest = &e.peers[0];
+  for (LeaderPeer& peer : e.peers) {
+    if (peer.used && peer.id == id) {
+      slot = &peer;
+      break;
+    }
+    if (!peer.used) {
+      oldest = &peer;
+    } else if (oldest->used && (!peer.fresh || (oldest->fresh &&
+                                                (int32_t)(peer.heardMs - oldest->heardMs) < 0))) {
+      oldest = &peer;
+    }
+  }
+  if (!slot) {
+    slot = oldest;
+    memset(slot, 0, sizeof(*slot));
+    slot->used = true;
+    slot->id = id;
+  }
+  // Echoed back to it even if this hello is stale: it may be a newcomer.
+  slot->challenge = get32(&buf[CHALLENGE_AT]);
+
+  uint32_t issuedMs = 0;
+  if (!echoedChallenge(e, &buf[ECHO_AT], count, nowMs, issuedMs)) {
+    // It has not heard us lately (joined, rebooted) or this is a replay:
+    // answer once the gap allows; its state waits for a fresh hello.
+    e.replyPending = true;
+    return;
+  }
+
+  const uint32_t nonce = get32(&buf[NONCE_AT]);
+  const uint32_t seq = get32(&buf[SEQ_AT]);
+  if (slot->fresh && slot->nonce == nonce && seq <= slot->seq) {
+    e.rejected++;  // replayed within its challenge's lifetime
+    return;
+  }
+
+  if (!slot->fresh || (int32_t)(issuedMs - slot->heardMs) > 0) slot->heardMs = issuedMs;
+  slot->fresh = true;
+  slot->nonce = nonce;
+  slot->seq = seq;
+  slot->flags = buf[4];
+  e.received++;
+}
+
+void leaderLoop(LeaderElection& e, uint32_t nowMs, bool canLead) {
+  if (e.role == LeaderRole::Off) return;
+
+  if (canLead != e.canLead) {
+    e.canLead = canLead;
+    e.helloNow = true;
+  }
+  elect(e, nowMs);
+
+  uint8_t live = 0;
+  for (const LeaderPeer& p : e.peers) {
+    if (peerLive(p, nowMs)) live++;
+  }
+  e.livePeers = live;
+
+  const bool due = (int32_t)(nowMs - e.helloAtMs) >= 0;
+  if (due) {
+    newChallenge(e, nowMs);
+    e.helloAtMs = nowMs + LEADER_HELLO_MS - LEADER_HELLO_JITTER_MS / 2 +
+                  e.random() % (LEADER_HELLO_JITTER_MS + 1);
+  }
+  if (due || e.helloNow || (e.replyPending && nowMs - e.replyMs >= LEADER_REPLY_GAP_MS)) {
+    sendHello(e, nowMs);
+  }
+}
+
+bool leaderSkipPing(LeaderElection& e, uint32_t nowMs) {
+  if (e.role != LeaderRole::Follower || !liveLeader(e, nowMs)) return false;
+  e.skipped++;
+  return true;
+}
+
+bool leaderTakeTakeover(LeaderElection& e) {
+  if (!e.takeover) return false;
+  e.takeover = false;
+  return true;
+}
@@ -3,11 +3,23 @@
 #include <ESP8266WiFi.h>
 #include <ESP.h>
 #include <LittleFS.h>
-#include <WiFiClient.h>
 
 #include "api_client.h"
 #include "io_ui.h"
+#include "lan_discovery.h"
+#include "lan_leader.h"
+#include "mains_sense.h"
+#include "mqtt_publisher.h"
+#include "net_diag.h"
+#include "net_probe.h"
 #include "noctua_portal.h"
+#include "outage_journal.h"
+#include "ping_scheduler.h"
+#include "power.h"
+#include "provision.h"
+#include "rtc_mem.h"
+#include "supply_monitor.h"
+#include "wifi_journal.h"
 #include "wifi_manager.h"
 
 // ============================================================
@@ -20,7 +32,6 @@ static const char* SETUP_AP_PASS = "";
 static const uint32_t WIFI_BOOT_GRACE_MS = 60000;
 static const uint32_t PING_INTERVAL_MS = 90000;
 static const uint32_t FIRST_PING_DELAY_MS = 30000;
-static const uint32_t INTERNET_CHECK_INTERVAL_MS = 30000;
 
 #ifndef NOCTUA_LED_PIN
 static const int LED_PIN = 16;
@@ -44,34 +55,35 @@ static const int BOOT_PIN = NOCTUA_BOOT_PIN;
 // Runtime
 // ============================================================
 
-static uint32_t gLastPingMs = 0;
 static bool gWasStaConnected = false;
 
-static uint32_t gLastInternetCheckMs = 0;
-static bool gInternetOk = false;
+// Worst-case loop() pass (excluding the idle delay at the end).
+static uint32_t gLoopMaxUs = 0;
+static uint32_t gLoopMaxPingUs = 0;
+
+// Power-on fast path ("power is back" as soon as IP is up).
+static bool gColdBoot = false;
+static bool gColdPingPending = false;  // first ping not started yet
+static uint32_t gBootToIpMs = 0;
+static uint32_t gBootToPingMs = 0;
+
+// Mains-sense circuits that just got power: bit = extra key slot to report now.
+static uint8_t gCircuitReportMask = 0;
 
 static bool gReconfigInProgress = false;
 static uint32_t gLastReconfigMs = 0;
 static const uint32_t RECONFIG_COOLDOWN_MS = 1500;
 
-static void startPingScheduleWithDelay(uint32_t delayMs) {
-  // Ping happens when (now - gLastPingMs) >= PING_INTERVAL_MS.
-  // By backdating gLastPingMs, we can make the *next* ping happen in delayMs.
-  const uint32_t now = millis();
-  const uint32_t backdate = (PING_INTERVAL_MS > delayMs) ? (PING_INTERVAL_MS - delayMs) : 0;
-  gLastPingMs = now - backdate;
-}
-
 static const uint32_t RTC_RESET_CFG_MAGIC = 0x4E435452;  // 'NCTR'
 
 static void clearConfigIfRequestedOnBoot() {
   uint32_t magic = 0;
-  if (!ESP.rtcUserMemoryRead(0, (uint32_t*)&magic, sizeof(magic))) return;
+  if (!ESP.rtcUserMemoryRead(RTC_BLOCK_RESET_CFG, (uint32_t*)&magic, sizeof(magic))) return;
   if (magic != RTC_RESET_CFG_MAGIC) return;
 
   // Clear the flag first to avoid reboot loops if FS ops fail.
   magic = 0;
-  (void)ESP.rtcUserMemoryWrite(0, (uint32_t*)&magic, sizeof(magic));
+  (void)ESP.rtcUserMemoryWrite(RTC_BLOCK_RESET_CFG, (uint32_t*)&magic, sizeof(magic));
 
   Serial.println("Clearing config (requested)");
 
@@ -100,24 +112,32 @@ static void clearConfigIfRequestedOnBoot() {
   }
 }
 
-static bool checkInternetConnection() {
-  // Lightweight outbound connectivity probe.
-  // Important: avoid hostname DNS here. DNS resolution can occasionally block
-  // long enough to look like a device hang on ESP8266.
-  // Cloudflare DNS IP (should be reachable on most networks).
-  const IPAddress probeIp(1, 1, 1, 1);
+// Genuine power-on (mains restored). Crash / watchdog / soft reboots keep
+// the burst-avoiding first-ping delay. Some boards report an external reset
+// at power-up (RC on RST), so that counts as power-on as well.
+static bool isColdBoot() {
+  const rst_info* ri = ESP.getResetInfoPtr();
+  if (!ri) return false;
+  return ri->reason == REASON_DEFAULT_RST || ri->reason == REASON_EXT_SYS_RST;
+}
 
-  WiFiClient client;
-  client.setTimeout(1500);
-  yield();
-  const bool ok = client.connect(probeIp, 53);
-  yield();
-  if (ok) {
-    client.stop();
-    return true;
+static void printBootDiag() {
+  Serial.printf("reset_reason: %s\n", ESP.getResetReason().c_str());
+  Serial.printf("reset_info: %s\n", ESP.getResetInfo().c_str());
+  Serial.printf("sdk: %s boot_ver=%u\n", ESP.getSdkVersion(), (unsigned)ESP.getBootVersion());
+  Serial.printf("chip_id: %06X flash_id: %08X\n", ESP.getChipId(), ESP.getFlashChipId());
+  Serial.printf("heap: %u\n", (unsigned)ESP.getFreeHeap());
+}
+
+// Keys may have moved to other ping indexes: re-apply the circuit states.
+static void applyCircuitStates() {
+  for (uint8_t idx = 1; idx < MAX_CHANNEL_KEYS; idx++) apiChannelSetEnabled(idx, true);
+  for (uint8_t i = 0; i < mainsSenseInputs(); i++) {
+    MainsInputStatus ms;
+    if (!mainsSenseGet(i, ms) || !ms.known) continue;
+    const int8_t idx = portalExtraChannelIndex(ms.slot);
+    if (idx > 0) apiChannelSetEnabled((uint8_t)idx, ms.powered);
   }
-  client.stop();
-  return false;
 }
 
 // Apply current portalConfig() to Wi-Fi without reboot.
@@ -127,6 +147,9 @@ static void applyConfigNoReboot() {
   gReconfigInProgress = true;
   gLastReconfigMs = millis();
   portalClearConfigDirty();
+  apiConfigChanged();
+  applyCircuitStates();
+  lanLeaderConfigChanged();
 
   // Apply LED setting immediately.
   ioSetLedEnabled(!portalConfig().ledDisabled);
@@ -158,15 +181,18 @@ void setup() {
   Serial.begin(115200);
   // Keep SDK debug output off (it's very noisy).
   Serial.setDebugOutput(false);
-  delay(500);
 
-  Serial.println("\n=== Noctua ===");
+  // Power-on: nobody is watching the serial port, and every ms here delays
+  // the "power is back" ping. Diagnostics are printed once we're connected.
+  gColdBoot = isColdBoot();
+  if (!gColdBoot) delay(500);
 
-  Serial.printf("reset_reason: %s\n", ESP.getResetReason().c_str());
-  Serial.printf("reset_info: %s\n", ESP.getResetInfo().c_str());
-  Serial.printf("sdk: %s boot_ver=%u\n", ESP.getSdkVersion(), (unsigned)ESP.getBootVersion());
-  Serial.printf("chip_id: %06X flash_id: %08X\n", ESP.getChipId(), ESP.getFlashChipId());
-  Serial.printf("heap: %u\n", (unsigned)ESP.getFreeHeap());
+  Serial.println("\n=== Noctua ===");
+  if (gColdBoot) {
+    Serial.println("⚡ power-on -> fast path");
+  } else {
+    printBootDiag();
+  }
 
   clearConfigIfRequestedOnBoot();
 
@@ -175,20 +201,33 @@ void setup() {
   // Portal/web server is always available (STA or AP)
   portalSetup(SETUP_AP_SSID, SETUP_AP_PASS);
 
-  // Load config into in-memory struct
-  memset(&portalConfig(), 0, sizeof(NoctuaConfig));
-  const bool loaded = portalLoadConfig(portalConfig());
+  // Config was already loaded into portalConfig() by portalSetup().
+  const bool loaded = portalConfigLoaded();
 
   // Apply LED config (default: enabled)
   ioSetLedEnabled(!portalConfig().ledDisabled);
 
-  Serial.printf("loaded=%u ssid='%s' pass_len=%u ckey_len=%u apass_len=%u\n",
+  Serial.printf("loaded=%u ssid='%s' pass_len=%u ckey_len=%u apass_len=%u power=%u\n",
                 (unsigned)loaded,
                 portalConfig().wifiSsid,
                 (unsigned)strlen(portalConfig().wifiPass),
                 (unsigned)strlen(portalConfig().channelKey),
-                (unsigned)strlen(portalConfig().adminPass));
-
+                (unsigned)strlen(portalConfig().adminPass),
+                (unsigned)portalConfig().powerProfile);
+
+  // Power profile must be known before Wi-Fi defaults are applied.
+  powerSetup(portalConfig().powerProfile);
+
+  // Wi-Fi event journal needs the filesystem (mounted by portalSetup()).
+  wifiJournalSetup();
+  outageJournalSetup();
+
+  apiSetup();
+  mainsSenseSetup();
+  mqttSetup();
+  lanDiscoverySetup();
+  lanLeaderSetup();
+  supplyMonitorSetup();
   wifiManagerSetup();
 
   // Boot decision:
@@ -199,31 +238,45 @@ void setup() {
     portalStartAP();
   } else {
     Serial.println("✅ SSID found -> connecting...");
-    const bool ok = wifiConnectOnce(WIFI_BOOT_GRACE_MS);
+    const bool ok = wifiConnectOnce(WIFI_BOOT_GRACE_MS, gColdBoot);
     if (!ok) portalStartAP();
   }
 
+  if (wifiIsConnected()) gBootToIpMs = millis();
+  if (gColdBoot) printBootDiag();
+
   // Ping schedule starts only after Wi-Fi is connected.
-  // Avoid immediate ping on boot to prevent bursts on frequent power cycles.
+  // Power-on: ping right away (that's the event we report). Other resets
+  // avoid an immediate ping to prevent bursts on crash/reboot loops; the
+  // per-device phase spreads units that were powered on together.
   gWasStaConnected = wifiIsConnected();
-  startPingScheduleWithDelay(FIRST_PING_DELAY_MS);
+  pingSchedSetup(PING_INTERVAL_MS);
+  gColdPingPending = gColdBoot && wifiIsConnected() && portalHasAppConfig();
+  if (gColdPingPending) {
+    pingSchedStartNow();
+  } else {
+    pingSchedRestart(FIRST_PING_DELAY_MS);
+  }
 
   // Start countdown from the first delay once we're connected.
   if (wifiIsConnected() && portalHasAppConfig()) {
-    portalSetNextPingInSeconds((int)(FIRST_PING_DELAY_MS / 1000));
+    portalSetNextPingInSeconds((int)((pingSchedMsUntilDue() + 999) / 1000));
   } else {
     portalSetNextPingInSeconds(-1);
   }
 
-  // Internet status is checked lazily from loop; start unknown/false.
-  gInternetOk = false;
-  portalClearInternetStatus();
-  gLastInternetCheckMs = 0;
+  // Internet status is checked lazily from loop; start unknown.
+  netProbeReset();
 }
 
 void loop() {
+  const uint32_t loopStartUs = micros();
+  const bool pingBusyAtStart = apiPingBusy();
   yield();
 
+  // First: a failing supply leaves only a few hundred ms for the last gasp.
+  supplyMonitorLoop();
+
   // Keep portal responsive in all modes
   portalLoop();
 
@@ -245,9 +298,16 @@ void loop() {
   ioSetHeartbeatEnabled(!gReconfigInProgress && !portalConfig().ledDisabled && wifiIsConnected() && !portalIsAPRunning());
   ioLoop();
 
-  // BOOT button: toggle AP
-  if (ioBootPressedOnce()) {
-    if (portalIsAPRunning()) {
+  // BOOT button: long press -> ESP-Touch provisioning, short press -> toggle AP
+  if (ioBootLongPressedOnce()) {
+    Serial.println("✅ BOOT (long) -> ESP-Touch provisioning");
+    provisionStart();
+  } else if (ioBootPressedOnce()) {
+    if (provisionIsActive()) {
+      Serial.println("✅ BOOT -> provisioning off, AP mode");
+      provisionCancel();
+      portalStartAP();
+    } else if (portalIsAPRunning()) {
       Serial.println("✅ BOOT -> AP off");
       portalStopAP();
     } else {
@@ -256,61 +316,146 @@ void loop() {
     }
   }
 
-  // Background reconnect (disabled during apply)
+  provisionLoop();
+
+  // Background reconnect (disabled during apply / suspended while provisioning)
   if (!gReconfigInProgress) {
     wifiManagerLoop();
   }
 
+  wifiJournalLoop();
+
   // Track Wi-Fi connection transitions to delay pings after reconnect.
   const bool staConnectedNow = wifiIsConnected();
   if (staConnectedNow && !gWasStaConnected) {
     gWasStaConnected = true;
-    // After reconnect, use the regular cadence (first ping after 90s).
-    startPingScheduleWithDelay(PING_INTERVAL_MS);
+    if (gBootToIpMs == 0) gBootToIpMs = millis();
+    // After reconnect, wait for things to settle, then rejoin this device's phase.
+    pingSchedRestart(FIRST_PING_DELAY_MS);
 
     // Force an Internet re-check after reconnect.
-    portalClearInternetStatus();
-    gLastInternetCheckMs = 0;
+    netProbeReset();
   } else if (!staConnectedNow && gWasStaConnected) {
     gWasStaConnected = false;
-    gInternetOk = false;
-    portalClearInternetStatus();
-    gLastInternetCheckMs = 0;
+    netProbeReset();
   }
 
-  const uint32_t now = millis();
+  // Advance the ping in flight (never blocks).
+  apiLoop();
+
+  // Feed the outcome (retry, 429/503, Retry-After, interval hint) back to the schedule.
+  ApiPingResult pingResult;
+  if (apiPingTakeResult(pingResult)) {
+    pingSchedOnResult(pingResult);
+    netDiagNotePing(pingResult);
+    mqttNotePing(pingResult);
+    lanDiscoveryNotePing(pingResult);
+    lanLeaderNotePing(pingResult);
+    // Any HTTP reply proves the Internet path; a network-level failure
+    // triggers an early re-check. Config/link errors say nothing.
+    if (pingResult.httpCode != 0) {
+      netProbeNoteTraffic(true);
+    } else if (pingResult.retryable) {
+      netProbeNoteTraffic(false);
+    }
+    if (pingResult.ok && gBootToPingMs == 0) {
+      gBootToPingMs = millis();
+      Serial.printf("⏱ boot -> first ping: %lu ms (ip at %lu ms, %s)\n",
+                    (unsigned long)gBootToPingMs,
+                    (unsigned long)gBootToIpMs,
+                    gColdBoot ? "power-on" : "reset");
+    }
+  }
+  portalSetBootTiming(gColdBoot, gBootToIpMs, gBootToPingMs);
+
+  // Internet status (every 30s, only when Wi-Fi connected). Never blocks; a
+  // ping in flight (incl. the power-on one) brings evidence, so no probe then.
+  netProbeLoop(!gReconfigInProgress && wifiIsConnected(), gColdPingPending || apiPingBusy());
+
+  // Power/Wi-Fi/Internet outage intervals.
+  outageJournalLoop(wifiIsConnected(), netProbeKnown(), netProbeUp());
+
+  // State push to the MQTT broker (if configured); never blocks.
+  mqttLoop(!gReconfigInProgress && wifiIsConnected(), netProbeKnown(), netProbeUp());
 
-  // Cached Internet status (every 30s, only when Wi-Fi connected)
-  if (!gReconfigInProgress && wifiIsConnected()) {
-    if (gLastInternetCheckMs == 0 || (now - gLastInternetCheckMs >= INTERNET_CHECK_INTERVAL_MS)) {
-      gLastInternetCheckMs = now;
-      gInternetOk = checkInternetConnection();
-      portalSetInternetStatus(gInternetOk);
+  // mDNS answers and discovery replies/beacons (precomputed packets).
+  lanDiscoveryLoop(!gReconfigInProgress && wifiIsConnected(), netProbeKnown(), netProbeUp());
+
+  // Units sharing the channel keys: one leader pings. A failing supply cannot
+  // lead (it hands over right away); taking over from a lost leader pings now.
+  lanLeaderLoop(!gReconfigInProgress && wifiIsConnected(), !supplyMonitorFailing());
+  if (lanLeaderTakeTakeover() && wifiIsConnected() && portalHasAppConfig()) {
+    Serial.println("leader: took over -> ping now");
+    pingSchedStartNow();
+  }
+
+  // Mains-sense circuits: each input reports to its extra key slot. No
+  // power -> the key leaves the ping cycles; power back -> it is pinged right
+  // away. An empty slot has nothing to report to.
+  mainsSenseLoop();
+  MainsEvent mains;
+  while (mainsSenseTakeEvent(mains)) {
+    const int8_t idx = portalExtraChannelIndex(mains.slot);
+    const uint8_t bit = (uint8_t)(1u << mains.slot);
+    if (idx > 0) apiChannelSetEnabled((uint8_t)idx, mains.powered);
+    if (mains.powered && idx > 0) {
+      gCircuitReportMask |= bit;
+    } else {
+      gCircuitReportMask &= (uint8_t)~bit;
+    }
+    Serial.printf("⚡ circuit %u: %s (%lu ms ago)%s\n", (unsigned)(mains.slot + 1),
+                  mains.powered ? "power" : "no power", (unsigned long)(millis() - mains.atMs),
+                  idx > 0 ? "" : ", no channel key");
+  }
+  if (gCircuitReportMask && !gReconfigInProgress && wifiIsConnected() && !apiPingBusy()) {
+    for (uint8_t slot = 0; slot < 8; slot++) {
+      const uint8_t bit = (uint8_t)(1u << slot);
+      if (!(gCircuitReportMask & bit)) continue;
+      const int8_t idx = portalExtraChannelIndex(slot);
+      // Slot emptied meanwhile: drop. Held (429) or refused for now: retry later.
+      if (idx <= 0) {
+        gCircuitReportMask &= (uint8_t)~bit;
+        continue;
+      }
+      if (apiPingStartChannel((uint8_t)idx)) {
+        gCircuitReportMask &= (uint8_t)~bit;
+        break;
+      }
     }
   }
 
   // Publish countdown to next ping for UI.
   int nextPingInS = -1;
   if (!gReconfigInProgress && wifiIsConnected() && portalHasAppConfig()) {
-    const uint32_t elapsed = now - gLastPingMs;
-    if (elapsed >= PING_INTERVAL_MS) {
-      nextPingInS = 0;
-    } else {
-      const uint32_t remainingMs = PING_INTERVAL_MS - elapsed;
-      nextPingInS = (int)((remainingMs + 999) / 1000);
-    }
+    nextPingInS = (int)((pingSchedMsUntilDue() + 999) / 1000);
   }
   portalSetNextPingInSeconds(nextPingInS);
 
-  // Backend ping (every 90s)
-  if (!gReconfigInProgress && wifiIsConnected() && (now - gLastPingMs >= PING_INTERVAL_MS)) {
-    if (portalHasAppConfig()) {
-      (void)apiPing();
-    } else {
+  // CPU clock / Wi-Fi sleep: boost while the portal is in use or a ping is due.
+  // A failing supply (running on the capacitor/UPS) must not look like power.
+  const bool pingDue = !gReconfigInProgress && wifiIsConnected() && !apiPingBusy() && !supplyMonitorFailing() &&
+                       pingSchedDue();
+  powerLoop(pingDue || apiPingBusy() || portalHasActiveClient());
+
+  // Backend ping (every 90s + device phase); the request itself runs in apiLoop().
+  if (pingDue) {
+    gColdPingPending = false;
+    if (!portalHasAppConfig()) {
       Serial.println("ℹ️ skip ping: no channelKey");
+    } else if (lanLeaderSkipPing()) {
+      // The leader pings for the shared keys; the slot still advances.
+    } else {
+      gLoopMaxPingUs = 0;
+      (void)apiPingStart();
     }
-    gLastPingMs = now;
+    pingSchedOnStarted();
   }
 
-  delay(10);
+  const uint32_t loopUs = micros() - loopStartUs;
+  if (loopUs > gLoopMaxUs) gLoopMaxUs = loopUs;
+  if ((pingBusyAtStart || apiPingBusy()) && loopUs > gLoopMaxPingUs) gLoopMaxPingUs = loopUs;
+  portalSetLoopTiming(gLoopMaxUs, gLoopMaxPingUs);
+
+  // With Wi-Fi sleep enabled, idle time here is where the SDK powers down.
+  delay(powerIdleDelayMs());
 }
@@ -0,0 +1,241 @@
+//mains_sense.cpp
+
+#include "mains_sense.h"
+
+#include "noctua_portal.h"
+
+// ============================================================
+// Config
+// ============================================================
+
+// Comma-separated GPIO numbers; -1 = no inputs (feature off).
+#ifndef NOCTUA_MAINS_SENSE_PINS
+#define NOCTUA_MAINS_SENSE_PINS -1
+#endif
+
+// 1: zero-cross detector (pulses while powered), 0: level optocoupler.
+#ifndef NOCTUA_MAINS_SENSE_ZERO_CROSS
+#define NOCTUA_MAINS_SENSE_ZERO_CROSS 0
+#endif
+
+// Level mode: the optocoupler pulls the pin low while the circuit has power.
+#ifndef NOCTUA_MAINS_SENSE_ACTIVE_LOW
+#define NOCTUA_MAINS_SENSE_ACTIVE_LOW 1
+#endif
+
+#ifndef NOCTUA_MAINS_SENSE_DEBOUNCE_MS
+#define NOCTUA_MAINS_SENSE_DEBOUNCE_MS 100
+#endif
+
+// ============================================================
+// Tuning
+// ============================================================
+
+static const int8_t CONFIG_PINS[] = {NOCTUA_MAINS_SENSE_PINS};
+static const uint8_t MAX_INPUTS = 4;
+static const uint8_t MAX_IRQ_PIN = 15;  // GPIO16 has no interrupt
+
+static const uint32_t DEBOUNCE_MS = NOCTUA_MAINS_SENSE_DEBOUNCE_MS;
+static const uint32_t ZC_ABSENT_MS = 60;  // 3 half-cycles at 50 Hz + margin
+
+static const uint8_t QUEUE_SIZE = 32;  // power of two
+static const uint8_t QUEUE_MASK = QUEUE_SIZE - 1;
+
+// ============================================================
+// State
+// ============================================================
+
+struct Edge {
+  uint32_t ms;
+  uint8_t input;
+  uint8_t powered;
+};
+
+// ISR -> loop queue: only the ISR writes gHead, only the loop writes gTail.
+static Edge gQueue[QUEUE_SIZE];
+static volatile uint8_t gHead = 0;
+static volatile uint8_t gTail = 0;
+static volatile uint32_t gDropped = 0;
+
+// Zero-cross: time of the latest pulse per input (written by the ISR).
+static volatile uint32_t gLastEdgeMs[MAX_INPUTS];
+
+struct Input {
+  uint8_t pin;
+  uint8_t slot;         // position in CONFIG_PINS = extra channel key slot
+  bool raw;             // undebounced "powered"
+  uint32_t rawSinceMs;
+  bool known;
+  bool powered;
+  bool pending;         // state change not taken yet
+  uint32_t changedMs;
+  uint32_t changes;
+};
+
+static Input gInputs[MAX_INPUTS];
+static uint8_t gCount = 0;
+
+// ============================================================
+// Interrupt side
+// ============================================================
+
+// Keeps the compiler from reordering the slot write past the index update
+// (single core: no hardware barrier needed).
+static inline void compilerBarrier() { __asm__ __volatile__("" ::: "memory"); }
+
+#if !NOCTUA_MAINS_SENSE_ZERO_CROSS
+static bool IRAM_ATTR levelPowered(uint8_t pin) {
+  return (digitalRead(pin) == LOW) == (NOCTUA_MAINS_SENSE_ACTIVE_LOW != 0);
+}
+#endif
+
+static void IRAM_ATTR onEdge(void* arg) {
+  const uint8_t input = (uint8_t)(uintptr_t)arg;
+  const uint32_t now = millis();
+
+#if NOCTUA_MAINS_SENSE_ZERO_CROSS
+  // 100 pulses/s while powered: only the first one after a quiet gap is
+  // queued; the loop times out the rest from gLastEdgeMs.
+  const uint32_t last = gLastEdgeMs[input];
+  gLastEdgeMs[input] = now;
+  if (now - last < ZC_ABSENT_MS) return;
+  const uint8_t powered = 1;
+#else
+  const uint8_t powered = levelPowered(gInputs[input].pin) ? 1 : 0;
+#endif
+
+  const uint8_t head = gHead;
+  const uint8_t next = (uint8_t)((head + 1) & QUEUE_MASK);
+  if (next == gTail) {
+    gDropped++;
+    return;
+  }
+  gQueue[head].ms = now;
+  gQueue[head].input = input;
+  gQueue[head].powered = powered;
+  compilerBarrier();
+  gHead = next;
+}
+
+// ============================================================
+// Loop side
+// ============================================================
+
+static void noteRaw(uint8_t i, bool powered, uint32_t atMs) {
+  Input& in = gInputs[i];
+  if (in.raw == powered) return;
+  in.raw = powered;
+  in.rawSinceMs = atMs;
+}
+
+static void drainQueue() {
+  uint8_t tail = gTail;
+  while (tail != gHead) {
+    compilerBarrier();
+    const Edge e = gQueue[tail];
+    tail = (uint8_t)((tail + 1) & QUEUE_MASK);
+    gTail = tail;
+    if (e.input < gCount) noteRaw(e.input, e.powered != 0, e.ms);
+  }
+}
+
+static void debounce(uint8_t i, uint32_t now) {
+  Input& in = gInputs[i];
+
+#if NOCTUA_MAINS_SENSE_ZERO_CROSS
+  // Pulses stopped: the power went away right after the last one.
+  const uint32_t last = gLastEdgeMs[i];
+  if (in.raw && (int32_t)(now - last) >= (int32_t)ZC_ABSENT_MS) noteRaw(i, false, last);
+#else
+  // An edge lost to a full queue would leave raw stale: trust the pin.
+  const bool level = levelPowered(in.pin);
+  if (level != in.raw) noteRaw(i, level, now);
+#endif
+
+  if (in.known && in.raw == in.powered) return;
+  // Signed: an edge may have been stamped after `now` was read.
+  if ((int32_t)(now - in.rawSinceMs) < (int32_t)DEBOUNCE_MS) return;
+
+  if (in.known) in.changes++;
+  in.known = true;
+  in.powered = in.raw;
+  in.changedMs = in.rawSinceMs;
+  in.pending = true;
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+void mainsSenseSetup() {
+  gCount = 0;
+  const uint32_t now = millis();
+
+  for (uint8_t slot = 0; slot < sizeof(CONFIG_PINS) / sizeof(CONFIG_PINS[0]); slot++) {
+    const int8_t pin = CONFIG_PINS[slot];
+    if (pin < 0 || pin > MAX_IRQ_PIN) continue;
+    // No extra key slot to report to: refuse instead of borrowing another's.
+    if (slot >= NOCTUA_EXTRA_CHANNEL_KEYS || gCount >= MAX_INPUTS) {
+      Serial.printf("mains-sense: GPIO%d ignored (no channel key slot %u)\n", pin,
+                    (unsigned)(slot + 1));
+      continue;
+    }
+
+    Input& in = gInputs[gCount];
+    in = Input();
+    in.pin = (uint8_t)pin;
+    in.slot = slot;
+    pinMode(pin, NOCTUA_MAINS_SENSE_ACTIVE_LOW ? INPUT_PULLUP : INPUT);
+
+#if NOCTUA_MAINS_SENSE_ZERO_CROSS
+    gLastEdgeMs[gCount] = now - ZC_ABSENT_MS;
+    in.raw = false;
+    attachInterruptArg(digitalPinToInterrupt(pin), onEdge, (void*)(uintptr_t)gCount, RISING);
+#else
+    in.raw = levelPowered(in.pin);
+    attachInterruptArg(digitalPinToInterrupt(pin), onEdge, (void*)(uintptr_t)gCount, CHANGE);
+#endif
+    in.rawSinceMs = now;
+    gCount++;
+  }
+
+  if (gCount) Serial.printf("mains-sense: %u input(s)\n", (unsigned)gCount);
+}
+
+void mainsSenseLoop() {
+  if (!gCount) return;
+
+  drainQueue();
+  const uint32_t now = millis();
+  for (uint8_t i = 0; i < gCount; i++) debounce(i, now);
+}
+
+uint8_t mainsSenseInputs() { return gCount; }
+
+bool mainsSenseGet(uint8_t input, MainsInputStatus& out) {
+  if (input >= gCount) return false;
+  const Input& in = gInputs[input];
+  out.pin = in.pin;
+  out.slot = in.slot;
+  out.known = in.known;
+  out.powered = in.powered;
+  out.changedMs = in.changedMs;
+  out.changes = in.changes;
+  return true;
+}
+
+bool mainsSenseTakeEvent(MainsEvent& out) {
+  for (uint8_t i = 0; i < gCount; i++) {
+    Input& in = gInputs[i];
+    if (!in.pending) continue;
+    in.pending = false;
+    out.input = i;
+    out.slot = in.slot;
+    out.powered = in.powered;
+    out.atMs = in.changedMs;
+    return true;
+  }
+  return false;
+}
+
+uint32_t mainsSenseDropped() { return gDropped; }
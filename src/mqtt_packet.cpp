@@ -0,0 +1,134 @@
+//mqtt_packet.cpp
+
+#include "mqtt_packet.h"
+
+#include <string.h>
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static size_t putString(uint8_t* p, const char* s, size_t len) {
+  p[0] = (uint8_t)(len >> 8);
+  p[1] = (uint8_t)len;
+  memcpy(p + 2, s, len);
+  return len + 2;
+}
+
+// ============================================================
+// Builders
+// ============================================================
+
+size_t mqttPutLength(uint8_t* p, size_t len) {
+  size_t n = 0;
+  do {
+    uint8_t b = (uint8_t)(len & 0x7F);
+    len >>= 7;
+    if (len) b |= 0x80;
+    p[n++] = b;
+  } while (len);
+  return n;
+}
+
+size_t mqttFrame(uint8_t* buf, uint8_t type, size_t bodyLen) {
+  uint8_t hdr[MQTT_HEADER_MAX];
+  hdr[0] = type;
+  const size_t hdrLen = 1 + mqttPutLength(&hdr[1], bodyLen);
+  memmove(buf + hdrLen, buf + MQTT_HEADER_MAX, bodyLen);
+  memcpy(buf, hdr, hdrLen);
+  return hdrLen + bodyLen;
+}
+
+size_t mqttBuildConnect(uint8_t* buf, size_t cap, const MqttConnectOptions& o) {
+  const size_t idLen = strlen(o.clientId);
+  const size_t topicLen = strlen(o.willTopic);
+  const size_t willLen = strlen(o.willMessage);
+  const size_t userLen = strlen(o.user);
+  const size_t passLen = userLen ? strlen(o.pass) : 0;
+  const size_t need = 10 + 2 + idLen + 2 + topicLen + 2 + willLen +
+                      (userLen ? 2 + userLen : 0) + (passLen ? 2 + passLen : 0);
+  if (MQTT_HEADER_MAX + need > cap) return 0;
+
+  uint8_t flags = 0x02 | 0x04 | 0x20;  // clean session, will, will retain (QoS 0)
+  if (userLen) flags |= 0x80;
+  if (passLen) flags |= 0x40;
+
+  uint8_t* p = buf + MQTT_HEADER_MAX;
+  size_t n = putString(p, "MQTT", 4);
+  p[n++] = 4;  // protocol level 3.1.1
+  p[n++] = flags;
+  p[n++] = (uint8_t)(o.keepAliveS >> 8);
+  p[n++] = (uint8_t)o.keepAliveS;
+  n += putString(p + n, o.clientId, idLen);
+  n += putString(p + n, o.willTopic, topicLen);
+  n += putString(p + n, o.willMessage, willLen);
+  if (userLen) n += putString(p + n, o.user, userLen);
+  if (passLen) n += putString(p + n, o.pass, passLen);
+
+  return mqttFrame(buf, MQTT_CONNECT, n);
+}
+
+size_t mqttBuildPublish(uint8_t* buf, size_t cap, const char* topic, const char* payload) {
+  const size_t topicLen = strlen(topic);
+  const size_t payloadLen = strlen(payload);
+  if (MQTT_HEADER_MAX + 2 + topicLen + payloadLen > cap) return 0;
+
+  uint8_t* p = buf + MQTT_HEADER_MAX;
+  size_t n = putString(p, topic, topicLen);
+  memcpy(p + n, payload, payloadLen);
+  n += payloadLen;
+
+  return mqttFrame(buf, MQTT_PUBLISH_RETAIN, n);
+}
+
+size_t mqttBuildPingReq(uint8_t* buf, size_t cap) {
+  if (cap < 2) return 0;
+  buf[0] = MQTT_PINGREQ;
+  buf[1] = 0;
+  return 2;
+}
+
+// ============================================================
+// MqttPacketReader
+// ============================================================
+
+void MqttPacketReader::reset() {
+  _stage = Stage::Type;
+  _len = 0;
+  _got = 0;
+}
+
+bool MqttPacketReader::push(uint8_t c) {
+  switch (_stage) {
+    case Stage::Type:
+      _type = c;
+      _len = 0;
+      _shift = 0;
+      _got = 0;
+      _stage = Stage::Length;
+      return false;
+
+    case Stage::Length:
+      _len |= (uint32_t)(c & 0x7F) << _shift;
+      _shift += 7;
+      if (c & 0x80) {
+        if (_shift >= 28) _stage = Stage::Error;
+        return false;
+      }
+      if (_len == 0) {
+        _stage = Stage::Type;
+        return true;
+      }
+      _stage = Stage::Body;
+      return false;
+
+    case Stage::Body:
+      if (_got < sizeof(_body)) _body[_got] = c;
+      if (++_got < _len) return false;
+      _stage = Stage::Type;
+      return true;
+
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,428 @@
+//mqtt_publisher.cpp
+
+#include "mqtt_publisher.h"
+
+#include <ESP8266WiFi.h>
+#include <ESP.h>
+
+#include "mqtt_packet.h"
+#include "tcp_conn.h"
+
+// ============================================================
+// Config
+// ============================================================
+
+// Broker address (IP literal); empty = publisher disabled.
+#ifndef NOCTUA_MQTT_HOST
+#define NOCTUA_MQTT_HOST ""
+#endif
+
+#ifndef NOCTUA_MQTT_PORT
+#define NOCTUA_MQTT_PORT 1883
+#endif
+
+// Empty user = anonymous (the password is only sent with a user).
+#ifndef NOCTUA_MQTT_USER
+#define NOCTUA_MQTT_USER ""
+#endif
+
+#ifndef NOCTUA_MQTT_PASS
+#define NOCTUA_MQTT_PASS ""
+#endif
+
+#ifndef NOCTUA_MQTT_PREFIX
+#define NOCTUA_MQTT_PREFIX "noctua"
+#endif
+
+#ifndef NOCTUA_MQTT_KEEPALIVE_S
+#define NOCTUA_MQTT_KEEPALIVE_S 60
+#endif
+
+// ============================================================
+// Tuning
+// ============================================================
+
+static const uint32_t STEP_TIMEOUT_MS = 5000;      // connect / CONNACK
+static const uint32_t PINGRESP_TIMEOUT_MS = 10000;
+static const uint32_t KEEPALIVE_MS = NOCTUA_MQTT_KEEPALIVE_S * 1000UL;
+
+static const uint32_t BACKOFF_MIN_MS = 2000;
+static const uint32_t BACKOFF_MAX_MS = 5UL * 60UL * 1000UL;
+static const uint32_t STABLE_MS = 60000;           // up this long = backoff resets
+
+static const uint32_t SAMPLE_EVERY_MS = 1000;      // Wi-Fi/Internet state
+static const int8_t RSSI_STEP_DB = 5;
+static const uint32_t RSSI_EVERY_MS = 60000;
+static const uint32_t UPTIME_EVERY_S = 300;
+
+static const size_t TX_SIZE = 256;
+static const size_t VALUE_SIZE = 24;
+
+// ============================================================
+// State
+// ============================================================
+
+enum Topic : uint8_t {
+  TOPIC_STATUS = 0,
+  TOPIC_WIFI,
+  TOPIC_RSSI,
+  TOPIC_INTERNET,
+  TOPIC_PING,
+  TOPIC_PING_ERROR,
+  TOPIC_UPTIME,
+  TOPIC_COUNT,
+};
+
+static const char* const TOPIC_NAMES[TOPIC_COUNT] = {
+  "status", "wifi", "rssi", "internet", "ping", "ping_error", "uptime",
+};
+
+static char gValues[TOPIC_COUNT][VALUE_SIZE];
+
+// Pending publishes, oldest first; gQueued keeps each topic in it at most once.
+static uint8_t gQueue[TOPIC_COUNT];
+static uint8_t gQueueHead = 0;
+static uint8_t gQueueLen = 0;
+static bool gQueued[TOPIC_COUNT];
+
+enum class Phase : uint8_t { Idle = 0, Connect, ConnAck, Up };
+
+static bool gEnabled = false;
+static IPAddress gBroker;
+static char gBase[48];
+static char gClientId[16];
+
+static Phase gPhase = Phase::Idle;
+static TcpConn gConn;
+static uint32_t gDeadlineMs = 0;
+static uint32_t gRetryAtMs = 0;
+static uint32_t gBackoffMs = BACKOFF_MIN_MS;
+static uint32_t gUpSinceMs = 0;
+
+// One outbound packet at a time (partial writes resume here).
+static uint8_t gTx[TX_SIZE];
+static size_t gTxLen = 0;
+static size_t gTxSent = 0;
+static uint32_t gLastTxMs = 0;
+
+static bool gPingOutstanding = false;
+static uint32_t gPingSentMs = 0;
+
+// Incoming packets (only CONNACK/PINGRESP matter; the rest is skipped).
+static MqttPacketReader gRx;
+
+static uint32_t gSampleAtMs = 0;
+static int8_t gRssiSent = 0;
+static bool gRssiKnown = false;
+static uint32_t gRssiAtMs = 0;
+static uint32_t gUptimeS = 0;
+static uint32_t gUptimeMarkMs = 0;
+static uint32_t gUptimeSentS = 0;
+
+static MqttStats gStats = {false, false, 0, 0, 0, BACKOFF_MIN_MS, {0}};
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static void enqueue(uint8_t topic) {
+  if (gQueued[topic]) return;  // already pending: it will carry the new value
+  gQueue[(gQueueHead + gQueueLen) % TOPIC_COUNT] = topic;
+  gQueueLen++;
+  gQueued[topic] = true;
+}
+
+static int dequeue() {
+  if (!gQueueLen) return -1;
+  const uint8_t topic = gQueue[gQueueHead];
+  gQueueHead = (uint8_t)((gQueueHead + 1) % TOPIC_COUNT);
+  gQueueLen--;
+  gQueued[topic] = false;
+  return topic;
+}
+
+static void setValue(uint8_t topic, const char* value) {
+  if (strncmp(gValues[topic], value, VALUE_SIZE) == 0) return;
+  strlcpy(gValues[topic], value, VALUE_SIZE);
+  enqueue(topic);
+}
+
+static void setNumber(uint8_t topic, long value) {
+  char buf[12];
+  snprintf(buf, sizeof(buf), "%ld", value);
+  setValue(topic, buf);
+}
+
+static void setError(const char* err) { strlcpy(gStats.error, err, sizeof(gStats.error)); }
+
+// ---- packet building (codec in mqtt_packet) ----
+
+static bool buildConnect() {
+  char willTopic[sizeof(gBase) + 8];
+  snprintf(willTopic, sizeof(willTopic), "%s/%s", gBase, TOPIC_NAMES[TOPIC_STATUS]);
+
+  MqttConnectOptions o;
+  o.clientId = gClientId;
+  o.willTopic = willTopic;
+  o.willMessage = "offline";
+  o.user = NOCTUA_MQTT_USER;
+  o.pass = NOCTUA_MQTT_PASS;
+  o.keepAliveS = NOCTUA_MQTT_KEEPALIVE_S;
+
+  gTxLen = mqttBuildConnect(gTx, TX_SIZE, o);
+  gTxSent = 0;
+  return gTxLen != 0;
+}
+
+static void buildPublish(uint8_t topic) {
+  char name[sizeof(gBase) + 12];
+  snprintf(name, sizeof(name), "%s/%s", gBase, TOPIC_NAMES[topic]);
+  // Always fits: topic names and values are bounded well below TX_SIZE.
+  gTxLen = mqttBuildPublish(gTx, TX_SIZE, name, gValues[topic]);
+  gTxSent = 0;
+}
+
+static void buildPingReq() {
+  gTxLen = mqttBuildPingReq(gTx, TX_SIZE);
+  gTxSent = 0;
+}
+
+// True once the pending packet is fully handed to TCP.
+static bool flushTx() {
+  if (gTxSent < gTxLen) {
+    gTxSent += gConn.write(gTx + gTxSent, gTxLen - gTxSent);
+    if (gTxSent < gTxLen) return false;
+    gLastTxMs = millis();
+  }
+  gTxLen = gTxSent = 0;
+  return true;
+}
+
+// Reads one incoming packet; true when a complete one was parsed.
+static bool readPacket(uint8_t& type) {
+  uint8_t c;
+  while (!gRx.failed() && gConn.read(&c, 1) == 1) {
+    if (gRx.push(c)) {
+      type = gRx.type();
+      return true;
+    }
+  }
+  return false;
+}
+
+static void drop(const char* err) {
+  gConn.abort();
+  const uint32_t now = millis();
+
+  if (gPhase == Phase::Up) {
+    gStats.disconnects++;
+    // A connection that held for a while was fine: start over quickly.
+    if (now - gUpSinceMs >= STABLE_MS) gBackoffMs = BACKOFF_MIN_MS;
+  }
+  gPhase = Phase::Idle;
+  gStats.connected = false;
+  gTxLen = gTxSent = 0;
+  gRx.reset();
+  gPingOutstanding = false;
+  setError(err);
+
+  // Jitter keeps a fleet from reconnecting in lockstep after a broker restart.
+  gRetryAtMs = now + gBackoffMs + ESP.random() % (gBackoffMs / 4 + 1);
+  gStats.backoffMs = gBackoffMs;
+  gBackoffMs = gBackoffMs * 2 > BACKOFF_MAX_MS ? BACKOFF_MAX_MS : gBackoffMs * 2;
+  Serial.printf("MQTT: %s (retry in %lu ms)\n", err, (unsigned long)(gRetryAtMs - now));
+}
+
+// ---- state tracking ----
+
+static void updateUptime() {
+  const uint32_t ms = millis();
+  const uint32_t whole = (ms - gUptimeMarkMs) / 1000;
+  gUptimeS += whole;
+  gUptimeMarkMs += whole * 1000;
+}
+
+static void sampleUptime() {
+  gUptimeSentS = gUptimeS;
+  setNumber(TOPIC_UPTIME, (long)gUptimeS);
+}
+
+static void sampleRssi() {
+  gRssiKnown = true;
+  gRssiSent = (int8_t)WiFi.RSSI();
+  gRssiAtMs = millis();
+  setNumber(TOPIC_RSSI, gRssiSent);
+}
+
+static void onConnected() {
+  gPhase = Phase::Up;
+  gStats.connected = true;
+  gStats.connects++;
+  gStats.error[0] = 0;
+  gUpSinceMs = millis();
+
+  // Retained copies on the broker may predate the outage: resend everything,
+  // "online" first, with the rate-limited values taken fresh.
+  setValue(TOPIC_STATUS, "online");
+  sampleUptime();
+  sampleRssi();
+  gQueueLen = 0;
+  memset(gQueued, 0, sizeof(gQueued));
+  for (uint8_t t = 0; t < TOPIC_COUNT; t++) enqueue(t);
+}
+
+static void trackState(bool wifiUp, bool internetKnown, bool internetUp) {
+  updateUptime();
+  if (gUptimeS - gUptimeSentS >= UPTIME_EVERY_S || gValues[TOPIC_UPTIME][0] == 0) sampleUptime();
+
+  const uint32_t now = millis();
+  if (!wifiUp || now - gSampleAtMs < SAMPLE_EVERY_MS) return;
+  gSampleAtMs = now;
+
+  setValue(TOPIC_WIFI, WiFi.BSSIDstr().c_str());
+  setValue(TOPIC_INTERNET, !internetKnown ? "unknown" : internetUp ? "up" : "down");
+
+  const int8_t rssi = (int8_t)WiFi.RSSI();
+  const int8_t delta = (int8_t)(rssi > gRssiSent ? rssi - gRssiSent : gRssiSent - rssi);
+  if (!gRssiKnown || (delta >= RSSI_STEP_DB && now - gRssiAtMs >= RSSI_EVERY_MS)) sampleRssi();
+}
+
+// ---- connection ----
+
+static void step() {
+  const uint32_t now = millis();
+  const bool expired = (int32_t)(now - gDeadlineMs) >= 0;
+  uint8_t type;
+
+  switch (gPhase) {
+    case Phase::Idle:
+      if ((int32_t)(now - gRetryAtMs) < 0) return;
+      if (!gConn.connect(gBroker, NOCTUA_MQTT_PORT)) {
+        drop("connect failed");
+        return;
+      }
+      gPhase = Phase::Connect;
+      gDeadlineMs = now + STEP_TIMEOUT_MS;
+      break;
+
+    case Phase::Connect:
+      if (gConn.connected()) {
+        if (!buildConnect()) {
+          drop("config too long");
+          return;
+        }
+        gPhase = Phase::ConnAck;
+        gDeadlineMs = now + STEP_TIMEOUT_MS;
+      } else if (expired || gConn.state() != TcpConn::State::Connecting) {
+        drop("connect failed");
+      }
+      break;
+
+    case Phase::ConnAck:
+      if (!gConn.connected()) {
+        drop("closed by broker");
+        return;
+      }
+      (void)flushTx();
+      if (readPacket(type)) {
+        if ((type & 0xF0) != MQTT_CONNACK || gRx.bodyKept() < 2) {
+          drop("bad connack");
+        } else if (gRx.body()[1] != 0) {
+          char err[24];
+          snprintf(err, sizeof(err), "refused (%u)", (unsigned)gRx.body()[1]);
+          drop(err);
+        } else {
+          onConnected();
+        }
+      } else if (gRx.failed()) {
+        drop("bad packet");
+      } else if (expired) {
+        drop("no connack");
+      }
+      break;
+
+    case Phase::Up: {
+      if (!gConn.connected() || (gConn.peerClosed() && !gConn.available())) {
+        drop("closed by broker");
+        return;
+      }
+      while (readPacket(type)) {
+        if ((type & 0xF0) == MQTT_PINGRESP) gPingOutstanding = false;
+      }
+      if (gRx.failed()) {
+        drop("bad packet");
+        return;
+      }
+      if (gPingOutstanding && now - gPingSentMs >= PINGRESP_TIMEOUT_MS) {
+        drop("ping timeout");
+        return;
+      }
+
+      // Bounded work per pass: at most one packet completes here.
+      if (!flushTx()) return;
+      const int topic = dequeue();
+      if (topic >= 0) {
+        buildPublish((uint8_t)topic);
+        gStats.publishes++;
+      } else if (!gPingOutstanding && now - gLastTxMs >= KEEPALIVE_MS / 2) {
+        buildPingReq();
+        gPingOutstanding = true;
+        gPingSentMs = now;
+      }
+      (void)flushTx();
+      break;
+    }
+  }
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+void mqttSetup() {
+  gEnabled = gBroker.fromString(NOCTUA_MQTT_HOST);
+  gStats.enabled = gEnabled;
+  if (!gEnabled) return;
+
+  snprintf(gBase, sizeof(gBase), "%s/%06X", NOCTUA_MQTT_PREFIX, ESP.getChipId());
+  snprintf(gClientId, sizeof(gClientId), "noctua-%06X", ESP.getChipId());
+
+  gUptimeMarkMs = millis();
+  setValue(TOPIC_STATUS, "online");
+  setValue(TOPIC_PING, "none");
+  setValue(TOPIC_INTERNET, "unknown");
+}
+
+void mqttNotePing(const ApiPingResult& r) {
+  if (!gEnabled) return;
+
+  setValue(TOPIC_PING, r.ok ? "ok" : "fail");
+  if (r.ok) {
+    setValue(TOPIC_PING_ERROR, "");
+  } else if (r.httpCode != 0) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "HTTP %d", r.httpCode);
+    setValue(TOPIC_PING_ERROR, buf);
+  } else {
+    setValue(TOPIC_PING_ERROR, apiLastErrorText());
+  }
+}
+
+void mqttLoop(bool wifiUp, bool internetKnown, bool internetUp) {
+  if (!gEnabled) return;
+
+  trackState(wifiUp, internetKnown, internetUp);
+
+  if (!wifiUp) {
+    if (gPhase != Phase::Idle) drop("wifi down");
+    return;
+  }
+  step();
+}
+
+bool mqttConfigured() {
+  IPAddress ip;
+  return ip.fromString(NOCTUA_MQTT_HOST);
+}
+
+void mqttGetStats(MqttStats& out) { out = gStats; }
@@ -0,0 +1,240 @@
+//net_diag.cpp
+
+#include "net_diag.h"
+
+#include <ESP8266WiFi.h>
+#include <ESP.h>
+#include <lwip/inet_chksum.h>
+#include <lwip/pbuf.h>
+#include <lwip/raw.h>
+#include <lwip/udp.h>
+
+// ============================================================
+// Tuning
+// ============================================================
+
+static const uint32_t DIAG_TIMEOUT_MS = 2000;
+static const uint16_t DNS_PORT = 53;
+
+// ============================================================
+// State
+// ============================================================
+
+static raw_pcb* gIcmp = nullptr;
+static udp_pcb* gUdp = nullptr;
+
+static bool gRunning = false;
+static uint32_t gStartMs = 0;
+static uint16_t gEchoId = 0;
+static uint16_t gEchoSeq = 0;
+static uint16_t gDnsTxId = 0;
+
+// Hop results of the last round (gXxxDone = measured at least once).
+static bool gGwDone = false;
+static bool gGwUp = false;
+static bool gDnsDone = false;
+static bool gDnsUp = false;
+
+static bool gWanKnown = false;
+static bool gWanUp = false;
+
+static bool gPingKnown = false;
+static bool gPingOk = false;
+static ApiError gPingErr = ApiError::None;
+
+static NetDiagStats gStats = {IPAddress(), IPAddress(), -1, -1, -1, 0};
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static uint8_t onIcmpRecv(void* arg, raw_pcb* pcb, pbuf* p, const ip_addr_t* addr) {
+  (void)arg;
+  (void)pcb;
+  if (!gRunning || !p || IPAddress(addr) != gStats.gateway) return 0;
+
+  uint8_t ipHdr[20];
+  if (pbuf_copy_partial(p, ipHdr, sizeof(ipHdr), 0) != sizeof(ipHdr)) return 0;
+  const uint16_t ihl = (uint16_t)((ipHdr[0] & 0x0F) * 4);
+
+  uint8_t icmp[8];
+  if (pbuf_copy_partial(p, icmp, sizeof(icmp), ihl) != sizeof(icmp)) return 0;
+
+  // Echo reply (type 0) to our own request only; everything else goes on to lwIP.
+  const uint16_t id = (uint16_t)((icmp[4] << 8) | icmp[5]);
+  const uint16_t seq = (uint16_t)((icmp[6] << 8) | icmp[7]);
+  if (icmp[0] != 0 || id != gEchoId || seq != gEchoSeq) return 0;
+
+  if (gStats.gwRttMs < 0) gStats.gwRttMs = (int32_t)(millis() - gStartMs);
+  pbuf_free(p);
+  return 1;
+}
+
+static void onDnsRecv(void* arg, udp_pcb* pcb, pbuf* p, const ip_addr_t* addr, uint16_t port) {
+  (void)arg;
+  (void)pcb;
+  if (!p) return;
+
+  uint8_t hdr[4];
+  const uint16_t n = pbuf_copy_partial(p, hdr, sizeof(hdr), 0);
+  pbuf_free(p);
+
+  if (!gRunning || n != sizeof(hdr) || port != DNS_PORT || IPAddress(addr) != gStats.dns) return;
+  if (((hdr[0] << 8) | hdr[1]) != gDnsTxId || !(hdr[2] & 0x80)) return;
+
+  // SERVFAIL/REFUSED: the resolver is up but can't resolve -> still broken.
+  if ((hdr[3] & 0x0F) == 0 && gStats.dnsRttMs < 0) gStats.dnsRttMs = (int32_t)(millis() - gStartMs);
+}
+
+static bool ensurePcbs() {
+  if (!gIcmp) {
+    gIcmp = raw_new(IP_PROTO_ICMP);
+    if (gIcmp) raw_recv(gIcmp, onIcmpRecv, nullptr);
+  }
+  if (!gUdp) {
+    gUdp = udp_new();
+    if (gUdp) {
+      if (udp_bind(gUdp, IP_ADDR_ANY, 0) == ERR_OK) {
+        udp_recv(gUdp, onDnsRecv, nullptr);
+      } else {
+        udp_remove(gUdp);
+        gUdp = nullptr;
+      }
+    }
+  }
+  return gIcmp || gUdp;
+}
+
+static void sendEcho() {
+  uint8_t pkt[16] = {8, 0, 0, 0, 0, 0, 0, 0, 'n', 'o', 'c', 't', 'u', 'a', 0, 0};
+  pkt[4] = (uint8_t)(gEchoId >> 8);
+  pkt[5] = (uint8_t)(gEchoId & 0xFF);
+  pkt[6] = (uint8_t)(gEchoSeq >> 8);
+  pkt[7] = (uint8_t)(gEchoSeq & 0xFF);
+  const uint16_t sum = inet_chksum(pkt, sizeof(pkt));
+  memcpy(&pkt[2], &sum, sizeof(sum));  // already in network order
+
+  pbuf* p = pbuf_alloc(PBUF_IP, sizeof(pkt), PBUF_RAM);
+  if (!p) return;
+  memcpy(p->payload, pkt, sizeof(pkt));
+  const ip_addr_t dst = gStats.gateway;
+  (void)raw_sendto(gIcmp, p, &dst);
+  pbuf_free(p);
+}
+
+// Root NS query: tiny, and any NOERROR reply proves the resolver works.
+static void sendDnsQuery() {
+  const uint8_t q[17] = {
+    (uint8_t)(gDnsTxId >> 8), (uint8_t)(gDnsTxId & 0xFF),
+    0x01, 0x00,  // RD
+    0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00,        // root
+    0x00, 0x02,  // NS
+    0x00, 0x01,  // IN
+  };
+
+  pbuf* p = pbuf_alloc(PBUF_TRANSPORT, sizeof(q), PBUF_RAM);
+  if (!p) return;
+  memcpy(p->payload, q, sizeof(q));
+  const ip_addr_t dst = gStats.dns;
+  (void)udp_sendto(gUdp, p, &dst, DNS_PORT);
+  pbuf_free(p);
+}
+
+static void finish() {
+  gRunning = false;
+
+  // Only this round's echo reply counts: a cached ARP entry outlives the router.
+  gGwDone = true;
+  gGwUp = gStats.gwRttMs >= 0;
+
+  if (gStats.dns.isSet()) {
+    gDnsDone = true;
+    gDnsUp = gStats.dnsRttMs >= 0;
+  }
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+void netDiagStart() {
+  if (gRunning || WiFi.status() != WL_CONNECTED) return;
+
+  gStats.gateway = WiFi.gatewayIP();
+  gStats.dns = WiFi.dnsIP(0);
+  gStats.gwRttMs = -1;
+  gStats.dnsRttMs = -1;
+  if (!gStats.gateway.isSet() || !ensurePcbs()) return;
+
+  gRunning = true;
+  gStartMs = millis();
+  gStats.runs++;
+
+  if (gIcmp) {
+    gEchoId = (uint16_t)ESP.random();
+    gEchoSeq++;
+    sendEcho();
+  }
+  if (gUdp && gStats.dns.isSet()) {
+    gDnsTxId = (uint16_t)ESP.random();
+    sendDnsQuery();
+  }
+}
+
+void netDiagLoop() {
+  if (!gRunning) return;
+
+  const bool gwIn = gStats.gwRttMs >= 0;
+  const bool dnsIn = gStats.dnsRttMs >= 0 || !gStats.dns.isSet();
+  if ((gwIn && dnsIn) || millis() - gStartMs >= DIAG_TIMEOUT_MS) finish();
+}
+
+void netDiagReset() {
+  gRunning = false;
+  gGwDone = false;
+  gDnsDone = false;
+  gWanKnown = false;
+  gPingKnown = false;
+}
+
+void netDiagNoteWan(bool up, int32_t wanMs) {
+  gWanKnown = true;
+  gWanUp = up;
+  if (wanMs >= 0 || !up) gStats.wanMs = up ? wanMs : -1;
+}
+
+void netDiagNotePing(const ApiPingResult& r) {
+  gPingKnown = true;
+  gPingOk = r.ok;
+  gPingErr = r.error;
+}
+
+NetFault netDiagFault() {
+  if (!gPingKnown) return NetFault::Unknown;
+  if (gPingOk) return NetFault::None;
+
+  // The server answered with an error: the whole path works.
+  if (gPingErr == ApiError::Non200) return NetFault::Api;
+  if (gPingErr == ApiError::NoWiFi) return NetFault::Lan;
+
+  // Some routers drop ICMP: an Internet answer through them proves them up.
+  if (gGwDone && !gGwUp && !(gWanKnown && gWanUp)) return NetFault::Lan;
+  if (gWanKnown && !gWanUp) return gGwDone ? NetFault::Wan : NetFault::Unknown;
+  if (gPingErr == ApiError::DnsFailed && gDnsDone && !gDnsUp) return NetFault::Dns;
+  if (gWanKnown && gWanUp) return NetFault::Api;
+  return NetFault::Unknown;
+}
+
+void netDiagGetStats(NetDiagStats& out) { out = gStats; }
+
+const char* netDiagFaultText(NetFault f) {
+  switch (f) {
+    case NetFault::None: return "none";
+    case NetFault::Lan: return "lan";
+    case NetFault::Wan: return "wan";
+    case NetFault::Dns: return "dns";
+    case NetFault::Api: return "api";
+    default: return "unknown";
+  }
+}
@@ -0,0 +1,233 @@
+//net_probe.cpp
+
+#include "net_probe.h"
+
+#include "net_diag.h"
+#include "noctua_portal.h"
+#include "tcp_conn.h"
+
+// ============================================================
+// Tuning
+// ============================================================
+
+static const uint32_t CHECK_INTERVAL_MS = 30000;   // verdict refresh
+static const uint32_t EVIDENCE_FRESH_MS = 30000;   // passive evidence counts this long
+static const uint32_t PROBE_TIMEOUT_MS = 3000;
+// After the first answer: time for the other targets' SYN-ACKs to arrive.
+static const uint32_t PROBE_GRACE_MS = 300;
+
+// Different providers, so one blocked network doesn't decide the verdict.
+struct ProbeTarget {
+  uint8_t ip[4];
+  uint16_t port;
+};
+
+static const ProbeTarget PROBE_TARGETS[] = {
+  {{1, 1, 1, 1}, 53},          // Cloudflare
+  {{8, 8, 8, 8}, 53},          // Google
+  {{9, 9, 9, 9}, 53},          // Quad9
+  {{208, 67, 222, 222}, 443},  // OpenDNS
+};
+static const uint8_t PROBE_TARGET_COUNT = sizeof(PROBE_TARGETS) / sizeof(PROBE_TARGETS[0]);
+
+// ============================================================
+// State
+// ============================================================
+
+static TcpConn gConns[PROBE_TARGET_COUNT];
+static bool gRunning = false;
+static uint32_t gProbeStartMs = 0;
+static uint32_t gFirstAnswerMs = 0;  // 0 = no target connected yet
+static uint8_t gFirstTarget = 0;
+static uint8_t gAnswered = 0;        // bit per target that connected this round
+
+static bool gKnown = false;
+static bool gUp = false;
+static NetConfidence gConfidence = NetConfidence::None;
+static NetEvidence gEvidence = NetEvidence::None;
+static uint32_t gVerdictMs = 0;    // 0 = re-check as soon as possible
+
+static uint32_t gTrafficOkMs = 0;    // last answered traffic (0 = none)
+static uint32_t gTrafficFailMs = 0;  // last unanswered traffic (0 = none)
+
+static NetProbeStats gStats = {};
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static bool recent(uint32_t ms, uint32_t now) { return ms != 0 && now - ms < EVIDENCE_FRESH_MS; }
+
+static void abortAll() {
+  for (uint8_t i = 0; i < PROBE_TARGET_COUNT; i++) gConns[i].abort();
+  gRunning = false;
+}
+
+static void publish(bool up, NetConfidence conf, NetEvidence ev) {
+  const uint32_t now = millis();
+  gKnown = true;
+  gUp = up;
+  gConfidence = conf;
+  gEvidence = ev;
+  gVerdictMs = now ? now : 1;
+  portalSetInternetStatus(up, (uint8_t)conf);
+}
+
+static void probeStart() {
+  gRunning = true;
+  gProbeStartMs = millis();
+  gFirstAnswerMs = 0;
+  gAnswered = 0;
+  gStats.probes++;
+
+  // Same cadence: check the first hops too, for the fault classification.
+  netDiagStart();
+
+  uint8_t started = 0;
+  for (uint8_t i = 0; i < PROBE_TARGET_COUNT; i++) {
+    const ProbeTarget& t = PROBE_TARGETS[i];
+    if (gConns[i].connect(IPAddress(t.ip[0], t.ip[1], t.ip[2], t.ip[3]), t.port)) started++;
+  }
+
+  // Out of pcbs/memory: nothing to wait for, try again next interval.
+  if (started == 0) {
+    gRunning = false;
+    gVerdictMs = gProbeStartMs ? gProbeStartMs : 1;
+  }
+}
+
+static void probeStep() {
+  const uint32_t now = millis();
+
+  uint8_t connected = 0;
+  uint8_t pending = 0;
+  for (uint8_t i = 0; i < PROBE_TARGET_COUNT; i++) {
+    const TcpConn::State s = gConns[i].state();
+    if (s == TcpConn::State::Connected && !(gAnswered & (1 << i))) {
+      gAnswered |= (uint8_t)(1 << i);
+      if (gFirstAnswerMs == 0) {
+        gFirstAnswerMs = now ? now : 1;
+        gFirstTarget = i;
+        gStats.lastProbeMs = now - gProbeStartMs;
+      }
+    }
+    if (gAnswered & (1 << i)) {
+      connected++;
+    } else if (s == TcpConn::State::Connecting) {
+      pending++;
+    }
+  }
+
+  // The first answer decides "up"; a second one within the grace makes it "high".
+  const bool timedOut = now - gProbeStartMs >= PROBE_TIMEOUT_MS;
+  const bool graceOver = gFirstAnswerMs != 0 && now - gFirstAnswerMs >= PROBE_GRACE_MS;
+  if (pending > 0 && connected < 2 && !graceOver && !timedOut) return;
+
+  if (connected == 0) gStats.lastProbeMs = now - gProbeStartMs;
+  abortAll();
+
+  if (connected > 0) {
+    const ProbeTarget& t = PROBE_TARGETS[gFirstTarget];
+    gStats.lastTarget = IPAddress(t.ip[0], t.ip[1], t.ip[2], t.ip[3]);
+    netDiagNoteWan(true, (int32_t)gStats.lastProbeMs);
+    publish(true, connected >= 2 ? NetConfidence::High : NetConfidence::Low, NetEvidence::Probe);
+    return;
+  }
+
+  // Nobody answered. An unanswered ping on top of that is a second signal.
+  gStats.failedRounds++;
+  gStats.lastTarget = IPAddress(0, 0, 0, 0);
+  netDiagNoteWan(false, -1);
+  publish(false, recent(gTrafficFailMs, now) ? NetConfidence::High : NetConfidence::Low, NetEvidence::Probe);
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+void netProbeReset() {
+  abortAll();
+  netDiagReset();
+  gKnown = false;
+  gUp = false;
+  gConfidence = NetConfidence::None;
+  gEvidence = NetEvidence::None;
+  gVerdictMs = 0;
+  gTrafficOkMs = 0;
+  gTrafficFailMs = 0;
+  portalClearInternetStatus();
+}
+
+void netProbeNoteTraffic(bool answered) {
+  const uint32_t now = millis();
+  if (answered) {
+    gTrafficOkMs = now ? now : 1;
+    // Flip a "down" verdict right away; the next check confirms "up" for free.
+    netDiagNoteWan(true, -1);
+    if (!gKnown || !gUp) {
+      abortAll();
+      gStats.passiveSkips++;
+      publish(true, NetConfidence::High, NetEvidence::Passive);
+    }
+  } else {
+    gTrafficFailMs = now ? now : 1;
+    // Don't wait up to 30 s to notice a loss.
+    if (gKnown && gUp) gVerdictMs = 0;
+  }
+}
+
+void netProbeLoop(bool linkUp, bool holdOff) {
+  if (!linkUp) {
+    if (gRunning) abortAll();
+    return;
+  }
+
+  netDiagLoop();
+
+  if (gRunning) {
+    probeStep();
+    return;
+  }
+
+  const uint32_t now = millis();
+  if (gVerdictMs != 0 && now - gVerdictMs < CHECK_INTERVAL_MS) return;
+
+  // Recent answered traffic is enough; an unanswered one since then isn't.
+  if (recent(gTrafficOkMs, now) && !(gTrafficFailMs != 0 && (int32_t)(gTrafficFailMs - gTrafficOkMs) > 0)) {
+    gStats.passiveSkips++;
+    netDiagNoteWan(true, -1);
+    publish(true, NetConfidence::High, NetEvidence::Passive);
+    return;
+  }
+
+  if (holdOff) return;
+  probeStart();
+}
+
+bool netProbeKnown() { return gKnown; }
+
+bool netProbeUp() { return gUp; }
+
+NetConfidence netProbeConfidence() { return gConfidence; }
+
+NetEvidence netProbeEvidence() { return gEvidence; }
+
+bool netProbeBusy() { return gRunning; }
+
+void netProbeGetStats(NetProbeStats& out) { out = gStats; }
+
+const char* netProbeConfidenceText(NetConfidence c) {
+  switch (c) {
+    case NetConfidence::Low: return "low";
+    case NetConfidence::High: return "high";
+    default: return "none";
+  }
+}
+
+const char* netProbeEvidenceText(NetEvidence e) {
+  switch (e) {
+    case NetEvidence::Passive: return "passive";
+    case NetEvidence::Probe: return "probe";
+    default: return "none";
+  }
+}
@@ -9,7 +9,26 @@
 #include <ESP.h>
 #include <Updater.h>
 
+#include "api_client.h"
+#include "api_tls.h"
+#include "dns_resolver.h"
+#include "mains_sense.h"
+#include "net_diag.h"
+#include "net_probe.h"
 #include "noctua_i18n.h"
+#include "outage_journal.h"
+#include "ping_latency.h"
+#include "ping_scheduler.h"
+#include "power.h"
+#include "provision.h"
+#include "rtc_mem.h"
+#include "lan_discovery.h"
+#include "lan_leader.h"
+#include "mqtt_publisher.h"
+#include "supply_monitor.h"
+#include "udp_heartbeat.h"
+#include "wifi_journal.h"
+#include "wifi_manager.h"
 
 // ============================================================
 // Globals / constants
@@ -23,6 +42,8 @@ static NoctuaConfig gCfg;
 static bool gApRunning = false;
 static bool gConfigDirty = false;
 
+static uint8_t gApChannel = 1;
+
 static char gApSsid[33] = "";
 static char gApPass[65] = "";
 
@@ -32,6 +53,9 @@ static const uint16_t DNS_PORT = 53;
 
 static const char* CFG_PATH = "/noctua.cfg";
 
+static uint32_t gLastRequestMs = 0;
+static const uint32_t CLIENT_ACTIVE_MS = 30000;
+
 static uint32_t gLoginExpireMs = 0;
 static const uint32_t LOGIN_TIMEOUT_MS = 10 * 60 * 1000; // 10 minutes
 
@@ -44,6 +68,15 @@ static int gNextPingInS = -1;
 static bool gHostReachable = false;
 static bool gInternetOk = false;
 static bool gInternetKnown = false;
+static uint8_t gInternetConfidence = 0;
+
+static uint32_t gLoopMaxUs = 0;
+static uint32_t gLoopMaxPingUs = 0;
+
+static bool gCfgLoaded = false;
+static bool gBootCold = false;
+static uint32_t gBootToIpMs = 0;
+static uint32_t gBootToPingMs = 0;
 
 static bool gResetConfigPending = false;
 static uint32_t gResetConfigDueMs = 0;
@@ -83,7 +116,7 @@ static void safeRestart() {
 
 static void markResetConfigOnNextBoot() {
   uint32_t magic = RTC_RESET_CFG_MAGIC;
-  (void)ESP.rtcUserMemoryWrite(0, (uint32_t*)&magic, sizeof(magic));
+  (void)ESP.rtcUserMemoryWrite(RTC_BLOCK_RESET_CFG, (uint32_t*)&magic, sizeof(magic));
 }
 
 // ============================================================
@@ -112,6 +145,8 @@ static void sendRedirect(const char* location);
 
 static void handleRoot();
 static void handleStatusJson();
+static void handleWifiJournalJson();
+static void handleLatencyJson();
 static void handleLoginGet();
 static void handleLoginPost();
 static void handleAdmin();
@@ -134,6 +169,44 @@ NoctuaConfig& portalConfig() { return gCfg; }
 bool portalHasStaConfig() { return strlen(gCfg.wifiSsid) > 0; }
 bool portalHasAppConfig() { return strlen(gCfg.channelKey) > 0; }
 
+static uint8_t collectChannelKeys(const char* out[MAX_CHANNEL_KEYS]) {
+  if (!gCfg.channelKey[0]) return 0;
+  uint8_t n = 0;
+  out[n++] = gCfg.channelKey;
+  for (uint8_t i = 0; i < NOCTUA_EXTRA_CHANNEL_KEYS; i++) {
+    const char* k = gCfg.extraChannelKeys[i];
+    if (!k[0]) continue;
+    bool dup = false;
+    for (uint8_t j = 0; j < n; j++) {
+      if (strcmp(out[j], k) == 0) dup = true;
+    }
+    if (!dup) out[n++] = k;
+  }
+  return n;
+}
+
+uint8_t portalChannelKeyCount() {
+  const char* keys[MAX_CHANNEL_KEYS];
+  return collectChannelKeys(keys);
+}
+
+const char* portalChannelKey(uint8_t idx) {
+  const char* keys[MAX_CHANNEL_KEYS];
+  return idx < collectChannelKeys(keys) ? keys[idx] : "";
+}
+
+int8_t portalExtraChannelIndex(uint8_t slot) {
+  if (slot >= NOCTUA_EXTRA_CHANNEL_KEYS) return -1;
+  const char* keys[MAX_CHANNEL_KEYS];
+  const uint8_t n = collectChannelKeys(keys);
+  // A duplicate slot was skipped: its pointer is not in the list.
+  for (uint8_t i = 1; i < n; i++) {
+    if (keys[i] == gCfg.extraChannelKeys[slot]) return (int8_t)i;
+  }
+  return -1;
+}
+bool portalConfigLoaded() { return gCfgLoaded; }
+
 void portalMarkConfigDirty() { gConfigDirty = true; }
 bool portalIsConfigDirty() { return gConfigDirty; }
 void portalClearConfigDirty() { gConfigDirty = false; }
@@ -159,14 +232,27 @@ void portalSetNextPingInSeconds(int seconds) {
 
 void portalSetHostReachable(bool ok) { gHostReachable = ok; }
 
-void portalSetInternetStatus(bool ok) {
+void portalSetInternetStatus(bool ok, uint8_t confidence) {
   gInternetOk = ok;
   gInternetKnown = true;
+  gInternetConfidence = confidence;
+}
+
+void portalSetLoopTiming(uint32_t maxUs, uint32_t maxDuringPingUs) {
+  gLoopMaxUs = maxUs;
+  gLoopMaxPingUs = maxDuringPingUs;
+}
+
+void portalSetBootTiming(bool cold, uint32_t toIpMs, uint32_t toPingMs) {
+  gBootCold = cold;
+  gBootToIpMs = toIpMs;
+  gBootToPingMs = toPingMs;
 }
 
 void portalClearInternetStatus() {
   gInternetOk = false;
   gInternetKnown = false;
+  gInternetConfidence = 0;
 }
 
 // ============================================================
@@ -258,7 +344,7 @@ static String css() {
     ".row{display:flex;gap:10px;flex-wrap:wrap;}"
     ".field{flex:1 1 220px;min-width:0;}"
     "label{display:block;font-size:12px;color:#666;margin:8px 0 4px;min-width:0;}"
-    "input{width:100%;box-sizing:border-box;border-radius:12px;border:1px solid rgba(0,0,0,.12);"
+    "input,select{width:100%;box-sizing:border-box;border-radius:12px;border:1px solid rgba(0,0,0,.12);"
     "padding:10px 10px;font-size:14px;outline:none;background:#fff;}"
     "input[type=checkbox]{width:auto;padding:0;border:0;border-radius:0;}"
     "input:focus{border-color:rgba(0,0,0,.25);}"
@@ -331,6 +417,8 @@ static const __FlashStringHelper* fwVersionText() {
   return F(__DATE__ " " __TIME__);
 }
 
+const char* portalFirmwareVersion() { return __DATE__ " " __TIME__; }
+
 static String wifiStatusText() {
   // If no STA credentials are configured, do not show misleading "Connecting".
   if (!portalHasStaConfig()) return String(NOCTUA_I18N_WIFI_STATUS_NEED_CFG);
@@ -486,6 +574,11 @@ static void handleRoot() {
   body += NOCTUA_I18N_API_WAITING;
   body += F("</span></code></p>");
 
+  // Per-channel results, shown only with extra channel keys.
+  body += F("<p id='channels_wrap' class='muted' style='display:none'>");
+  body += NOCTUA_I18N_HOME_CHANNELS_PREFIX_HTML;
+  body += F("<code id='val_channels'>—</code></p>");
+
   body += statusLine();
 
   body += F("<div class='sep'></div>");
@@ -507,6 +600,8 @@ static void handleRoot() {
   body += NOCTUA_I18N_API_OK;
   body += F("',api_fail:'");
   body += NOCTUA_I18N_API_FAIL;
+  body += F("',api_busy:'");
+  body += NOCTUA_I18N_API_BUSY;
   body += F("',");
   body += F("wifi_connecting:'");
   body += NOCTUA_I18N_WIFI_STATUS_CONNECTING;
@@ -543,7 +638,8 @@ static void handleRoot() {
     "}"
     "function fmtUptime(sec){sec=Math.max(0, sec|0);var h=(sec/3600)|0;var m=((sec%3600)/60)|0;var s=(sec%60)|0;return h+':' + (m<10?'0':'')+m + ':' + (s<10?'0':'')+s;}"
     "function fmtPingEta(sec){sec=(sec===undefined||sec===null)?-1:(sec|0);if(sec<0) return null;if(sec<=0) return I18N.now;return sec+I18N.sec;}"
-    "function fmtApi(has, ok, err){if(!has) return {t:I18N.api_wait, c:'stWarn'};if(ok) return {t:I18N.api_ok, c:'stOk'};err=(err===undefined||err===null)?'':String(err);err=err.replace(/\\s+/g,' ').trim();if(err.length) return {t:err, c:'stBad'};return {t:I18N.api_fail, c:'stBad'};}"
+    "function fmtApi(has, ok, err, phase){if(phase&&phase!=='idle') return {t:I18N.api_busy+' ('+phase+')', c:'stWarn'};if(!has) return {t:I18N.api_wait, c:'stWarn'};if(ok) return {t:I18N.api_ok, c:'stOk'};err=(err===undefined||err===null)?'':String(err);err=err.replace(/\\s+/g,' ').trim();if(err.length) return {t:err, c:'stBad'};return {t:I18N.api_fail, c:'stBad'};}"
+    "function fmtChannels(ch){var t=[],bad=false;for(var i=0;i<ch.length;i++){var c=ch[i];var s=(c.enabled===false)?'⏻':(!c.known?'…':(c.ok?'✓':(c.code?String(c.code):'✗')));if(c.enabled!==false&&c.known&&!c.ok) bad=true;t.push(c.key+'… '+s);}return {t:t.join(' · '), c:bad?'stBad':'stOk'};}"
     "function setClass(id, cls){var el=document.getElementById(id);if(!el) return;el.classList.remove('stOk','stBad','stWarn');if(cls) el.classList.add(cls);}"
     "function fmtInternet(wifi, known, ok){if(!wifi) return {t:'—', c:''};if(!known) return {t:I18N.internet_unknown, c:'stWarn'};return ok ? {t:I18N.internet_reach, c:'stOk'} : {t:I18N.internet_noroute, c:'stBad'};}"
     "async function poll(){"
@@ -578,9 +674,12 @@ static void handleRoot() {
         "var eta=fmtPingEta(j.next_ping_in_s);"
         "setDisplay('ping_eta_wrap', !!eta);"
         "setText('val_ping_eta', eta ? eta : '—');"
-        "var a=fmtApi(!!j.has_ping, !!j.last_ping_ok, j.ping_error);"
+        "var a=fmtApi(!!j.has_ping, !!j.last_ping_ok, j.ping_error, j.ping_phase);"
         "setText('val_api', a.t);"
         "setClass('val_api', a.c);"
+        "var ch=j.channels||[];"
+        "setDisplay('channels_wrap', ch.length>1);"
+        "if(ch.length>1){var f=fmtChannels(ch);setText('val_channels', f.t);setClass('val_channels', f.c);}"
         "setClass('subtitle','');"
         "var s=fmtInternet(staConnected, !!j.internet_known, !!j.internet_ok);"
         "setText('val_internet', s.t);"
@@ -614,8 +713,10 @@ static void handleStatusJson() {
 
   const uint32_t uptimeSec = millis() / 1000;
 
+  // About 3.1 KB of fixed fields plus the per-channel and per-input blocks:
+  // one allocation instead of a realloc per append.
   String json;
-  json.reserve(320);
+  json.reserve(3400 + (size_t)apiChannelCount() * 176 + (size_t)mainsSenseInputs() * 144);
 
   json += '{';
 
@@ -659,6 +760,262 @@ static void handleStatusJson() {
   json += jsonEscape(gLastPingError);
   json += F("\",");
 
+  json += F("\"ping_phase\":\"");
+  json += apiPingPhaseText();
+  json += F("\",");
+
+  json += F("\"ping_transport\":\"");
+  json += apiPingTransportName();
+  json += F("\",");
+
+  // Per channel key; keys are shown by their first 4 characters only.
+  json += F("\"channels\":[");
+  for (uint8_t i = 0; i < apiChannelCount(); i++) {
+    ApiChannelStatus cs;
+    if (!apiChannelStatus(i, cs)) break;
+    if (i) json += ',';
+    json += F("{\"key\":\"");
+    char prefix[5];
+    strlcpy(prefix, portalChannelKey(i), sizeof(prefix));
+    json += jsonEscape(prefix);
+    json += F("\",\"known\":");
+    json += (cs.known ? F("true") : F("false"));
+    json += F(",\"ok\":");
+    json += (cs.ok ? F("true") : F("false"));
+    json += F(",\"code\":");
+    json += String(cs.httpCode);
+    json += F(",\"last_ok_s\":");
+    json += String(cs.lastOkMs ? (long)((millis() - cs.lastOkMs) / 1000) : -1L);
+    json += F(",\"pings\":");
+    json += String((unsigned long)cs.pings);
+    json += F(",\"failures\":");
+    json += String((unsigned long)cs.failures);
+    json += F(",\"hold_s\":");
+    json += String((unsigned long)cs.holdS);
+    json += F(",\"enabled\":");
+    json += (cs.enabled ? F("true") : F("false"));
+    json += '}';
+  }
+  json += F("],");
+
+  if (mainsSenseInputs()) {
+    json += F("\"mains\":{\"dropped\":");
+    json += String((unsigned long)mainsSenseDropped());
+    json += F(",\"inputs\":[");
+    for (uint8_t i = 0; i < mainsSenseInputs(); i++) {
+      MainsInputStatus ms;
+      if (!mainsSenseGet(i, ms)) break;
+      if (i) json += ',';
+      json += F("{\"pin\":");
+      json += String((unsigned)ms.pin);
+      json += F(",\"slot\":");
+      json += String((unsigned)(ms.slot + 1));
+      const int8_t ch = portalExtraChannelIndex(ms.slot);
+      json += F(",\"channel\":");
+      json += (ch >= 0 ? String((unsigned)(ch + 1)) : String(F("null")));
+      json += F(",\"known\":");
+      json += (ms.known ? F("true") : F("false"));
+      json += F(",\"powered\":");
+      json += (ms.powered ? F("true") : F("false"));
+      json += F(",\"changed_s\":");
+      json += String(ms.known ? (long)((millis() - ms.changedMs) / 1000) : -1L);
+      json += F(",\"changes\":");
+      json += String((unsigned long)ms.changes);
+      json += '}';
+    }
+    json += F("]},");
+  }
+
+  {
+    ApiPingStats ps;
+    apiGetPingStats(ps);
+    json += F("\"ping_conn\":{\"connect_ms\":");
+    json += String((unsigned long)ps.lastConnectMs);
+    json += F(",\"request_ms\":");
+    json += String((unsigned long)ps.lastRequestMs);
+    json += F(",\"reused\":");
+    json += (ps.lastReused ? F("true") : F("false"));
+    json += F(",\"keep_alive\":");
+    json += (ps.keepAlive ? F("true") : F("false"));
+    json += F(",\"new_conns\":");
+    json += String((unsigned long)ps.newConnections);
+    json += F(",\"reused_conns\":");
+    json += String((unsigned long)ps.reusedConnections);
+    json += F(",\"half_open\":");
+    json += String((unsigned long)ps.halfOpen);
+    json += F(",\"server_closes\":");
+    json += String((unsigned long)ps.serverCloses);
+    json += F(",\"transport_fallbacks\":");
+    json += String((unsigned long)ps.transportFallbacks);
+    json += F("},");
+  }
+
+  {
+    LanDiscoveryStats ds;
+    lanDiscoveryGetStats(ds);
+    if (ds.enabled) {
+      json += F("\"discovery\":{\"host\":\"");
+      json += lanDiscoveryHostName();
+      json += F(".local\",\"mdns_queries\":");
+      json += String((unsigned long)ds.mdnsQueries);
+      json += F(",\"mdns_replies\":");
+      json += String((unsigned long)ds.mdnsReplies);
+      json += F(",\"queries\":");
+      json += String((unsigned long)ds.queries);
+      json += F(",\"replies\":");
+      json += String((unsigned long)ds.replies);
+      json += F(",\"rebuilds\":");
+      json += String((unsigned long)ds.rebuilds);
+      json += F("},");
+    }
+  }
+
+  {
+    LanLeaderStats ls;
+    lanLeaderGetStats(ls);
+    if (ls.enabled) {
+      char leaderId[8];
+      snprintf(leaderId, sizeof(leaderId), "%06x", (unsigned)ls.leaderId);
+      json += F("\"leader\":{\"role\":\"");
+      json += lanLeaderRoleText(ls.role);
+      json += F("\",\"leader_id\":\"");
+      json += (ls.leaderId ? leaderId : "");
+      json += F("\",\"peers\":");
+      json += String((unsigned)ls.peers);
+      json += F(",\"elections\":");
+      json += String((unsigned long)ls.elections);
+      json += F(",\"takeovers\":");
+      json += String((unsigned long)ls.takeovers);
+      json += F(",\"skipped_pings\":");
+      json += String((unsigned long)ls.skipped);
+      json += F(",\"hellos_sent\":");
+      json += String((unsigned long)ls.sent);
+      json += F(",\"hellos_received\":");
+      json += String((unsigned long)ls.received);
+      json += F(",\"rejected\":");
+      json += String((unsigned long)ls.rejected);
+      json += F("},");
+    }
+  }
+
+  if (mqttConfigured()) {
+    MqttStats ms;
+    mqttGetStats(ms);
+    json += F("\"mqtt\":{\"connected\":");
+    json += (ms.connected ? F("true") : F("false"));
+    json += F(",\"connects\":");
+    json += String((unsigned long)ms.connects);
+    json += F(",\"disconnects\":");
+    json += String((unsigned long)ms.disconnects);
+    json += F(",\"publishes\":");
+    json += String((unsigned long)ms.publishes);
+    json += F(",\"backoff_ms\":");
+    json += String((unsigned long)ms.backoffMs);
+    json += F(",\"error\":\"");
+    json += jsonEscape(ms.error);
+    json += F("\"},");
+  }
+
+  if (udpHeartbeatConfigured()) {
+    UdpHeartbeatStats us;
+    udpHeartbeatGetStats(us);
+    json += F("\"udp_heartbeat\":{\"sent\":");
+    json += String((unsigned long)us.sent);
+    json += F(",\"retransmits\":");
+    json += String((unsigned long)us.retransmits);
+    json += F(",\"acks\":");
+    json += String((unsigned long)us.acks);
+    json += F(",\"bad_acks\":");
+    json += String((unsigned long)us.badAcks);
+    json += F(",\"last_rtt_ms\":");
+    json += String((long)us.lastRttMs);
+    json += F(",\"last_gasps\":");
+    json += String((unsigned long)us.lastGasps);
+    json += F("},");
+  }
+
+  {
+    ApiTlsStats ts;
+    apiTlsGetStats(ts);
+    if (ts.enabled) {
+      json += F("\"tls\":{\"mfln\":");
+      json += (ts.mfln ? F("true") : F("false"));
+      json += F(",\"last_handshake_ms\":");
+      json += String((unsigned long)ts.lastHandshakeMs);
+      json += F(",\"last_resumed\":");
+      json += (ts.lastResumed ? F("true") : F("false"));
+      json += F(",\"full\":");
+      json += String((unsigned long)ts.fullHandshakes);
+      json += F(",\"full_avg_ms\":");
+      json += String((unsigned long)ts.fullAvgMs);
+      json += F(",\"resumed\":");
+      json += String((unsigned long)ts.resumedHandshakes);
+      json += F(",\"resumed_avg_ms\":");
+      json += String((unsigned long)ts.resumedAvgMs);
+      json += F(",\"last_error\":");
+      json += String(ts.lastError);
+      json += F("},");
+    }
+  }
+
+  {
+    DnsResolverStats ds;
+    dnsResolverGetStats(ds);
+    json += F("\"dns\":{\"ip\":\"");
+    json += ds.ip.toString();
+    json += F("\",\"stale\":");
+    json += (ds.stale ? F("true") : F("false"));
+    json += F(",\"ttl_left_s\":");
+    json += String((unsigned long)ds.ttlLeftS);
+    json += F(",\"server\":\"");
+    json += ds.server.toString();
+    json += F("\",\"last_ms\":");
+    json += String((unsigned long)ds.lastLookupMs);
+    json += F(",\"lookups\":");
+    json += String((unsigned long)ds.lookups);
+    json += F(",\"failures\":");
+    json += String((unsigned long)ds.failures);
+    json += F("},");
+  }
+
+  json += F("\"sched\":{\"interval_s\":");
+  json += String((unsigned long)(pingSchedIntervalMs() / 1000));
+  json += F(",\"phase_s\":");
+  json += String((unsigned long)(pingSchedPhaseMs() / 1000));
+  json += F(",\"backoff_level\":");
+  json += String((unsigned)pingSchedBackoffLevel());
+  {
+    PingRetryStats rs;
+    pingSchedGetRetryStats(rs);
+    json += F(",\"retries\":");
+    json += String((unsigned long)rs.scheduled);
+    json += F(",\"retry_recovered\":");
+    json += String((unsigned long)rs.recovered);
+    json += F(",\"retry_exhausted\":");
+    json += String((unsigned long)rs.exhausted);
+    json += F(",\"not_retryable\":");
+    json += String((unsigned long)rs.notRetryable);
+  }
+  json += F("},");
+
+  json += F("\"boot\":{\"cold\":");
+  json += (gBootCold ? F("true") : F("false"));
+  json += F(",\"reason\":\"");
+  json += ESP.getResetReason();
+  json += F("\",\"to_ip_ms\":");
+  json += String((unsigned long)gBootToIpMs);
+  json += F(",\"to_ping_ms\":");
+  json += String((unsigned long)gBootToPingMs);
+  json += F("},");
+
+  json += F("\"loop_max_us\":");
+  json += String((unsigned long)gLoopMaxUs);
+  json += ',';
+
+  json += F("\"loop_max_ping_us\":");
+  json += String((unsigned long)gLoopMaxPingUs);
+  json += ',';
+
   json += F("\"internet_ok\":");
   json += (gInternetOk ? F("true") : F("false"));
   json += ',';
@@ -667,12 +1024,57 @@ static void handleStatusJson() {
   json += (gInternetKnown ? F("true") : F("false"));
   json += ',';
 
+  json += F("\"internet_confidence\":\"");
+  json += netProbeConfidenceText((NetConfidence)gInternetConfidence);
+  json += F("\",");
+
+  {
+    NetProbeStats ps;
+    netProbeGetStats(ps);
+    json += F("\"probe\":{\"evidence\":\"");
+    json += netProbeEvidenceText(netProbeEvidence());
+    json += F("\",\"rounds\":");
+    json += String((unsigned long)ps.probes);
+    json += F(",\"passive\":");
+    json += String((unsigned long)ps.passiveSkips);
+    json += F(",\"failed\":");
+    json += String((unsigned long)ps.failedRounds);
+    json += F(",\"last_ms\":");
+    json += String((unsigned long)ps.lastProbeMs);
+    json += F(",\"target\":\"");
+    json += ps.lastTarget.toString();
+    json += F("\"},");
+  }
+
+  {
+    NetDiagStats ds;
+    netDiagGetStats(ds);
+    json += F("\"fault\":{\"class\":\"");
+    json += netDiagFaultText(netDiagFault());
+    json += F("\",\"gateway\":\"");
+    json += ds.gateway.toString();
+    json += F("\",\"gw_ms\":");
+    json += String((long)ds.gwRttMs);
+    json += F(",\"dns\":\"");
+    json += ds.dns.toString();
+    json += F("\",\"dns_ms\":");
+    json += String((long)ds.dnsRttMs);
+    json += F(",\"wan_ms\":");
+    json += String((long)ds.wanMs);
+    json += F(",\"runs\":");
+    json += String((unsigned long)ds.runs);
+    json += F("},");
+  }
+
   json += F("\"host_reachable\":");
   json += (gHostReachable ? F("true") : F("false"));
 
   json += F(",\"ap_running\":");
   json += (gApRunning ? F("true") : F("false"));
 
+  json += F(",\"provisioning\":");
+  json += (provisionIsActive() ? F("true") : F("false"));
+
   json += F(",\"ap_clients\":");
   json += String((int)WiFi.softAPgetStationNum());
 
@@ -681,11 +1083,241 @@ static void handleStatusJson() {
     json += String(rssi);
   }
 
+  if (gApRunning) {
+    WifiCoexStats coex;
+    wifiCoexGetStats(coex);
+    json += F(",\"ap_channel\":");
+    json += String((unsigned)portalApChannel());
+    json += F(",\"coex\":{\"reconnects\":");
+    json += String((unsigned long)coex.reconnects);
+    json += F(",\"last_reconnect_ms\":");
+    json += String((unsigned long)coex.lastReconnectMs);
+    json += F(",\"max_reconnect_ms\":");
+    json += String((unsigned long)coex.maxReconnectMs);
+    json += F(",\"ap_moves\":");
+    json += String((unsigned long)coex.apMoves);
+    json += F(",\"ap_client_drops\":");
+    json += String((unsigned long)coex.apClientDrops);
+    json += F(",\"paused_retries\":");
+    json += String((unsigned long)coex.pausedRetries);
+    json += F(",\"channel_scans\":");
+    json += String((unsigned long)coex.channelScans);
+    json += F(",\"full_scans\":");
+    json += String((unsigned long)coex.fullScans);
+    json += F(",\"targeted_attempts\":");
+    json += String((unsigned long)coex.targetedAttempts);
+    json += '}';
+  }
+
+  {
+    WifiRadioStats radio;
+    wifiRadioGetStats(radio);
+    json += F(",\"radio\":{\"phy\":\"11");
+    json += radio.phyMode;
+    json += F("\",\"tx_dbm\":");
+    json += String(radio.txDbmX10 / 10.0f, 1);
+    json += F(",\"avg_tx_dbm\":");
+    json += String(radio.avgTxDbmX10 / 10.0f, 1);
+    json += F(",\"rssi_ema\":");
+    json += String((int)radio.rssiEma);
+    json += F(",\"fallback\":");
+    json += (radio.fallback ? F("true") : F("false"));
+    json += F(",\"fallbacks\":");
+    json += String((unsigned long)radio.fallbacks);
+    json += F(",\"connected_s\":[");
+    for (uint8_t i = 0; i < 3; i++) {
+      if (i) json += ',';
+      json += String((unsigned long)(radio.connectedMs[i] / 1000));
+    }
+    json += F("],\"drops\":[");
+    for (uint8_t i = 0; i < 3; i++) {
+      if (i) json += ',';
+      json += String((unsigned long)radio.drops[i]);
+    }
+    json += F("]}");
+  }
+
+  json += F(",\"outages\":{\"count\":");
+  json += String((unsigned)outageJournalCount());
+  json += F(",\"unsent\":");
+  json += String((unsigned)outageJournalUnsent());
+  json += F(",\"uploads\":");
+  json += String((unsigned long)outageJournalUploads());
+  json += F(",\"ntp\":");
+  json += (outageJournalTimeAnchored() ? F("true") : F("false"));
+  json += F(",\"upload_error\":\"");
+  json += jsonEscape(outageJournalUploadError());
+  json += '"';
+  {
+    uint32_t gaspAt = 0;
+    bool gaspUnix = false;
+    if (outageJournalPreviousLastGasp(gaspAt, gaspUnix)) {
+      json += F(",\"prev_last_gasp\":{\"at\":");
+      json += String((unsigned long)gaspAt);
+      json += F(",\"clock\":\"");
+      json += gaspUnix ? F("unix") : F("uptime");
+      json += F("\"}");
+    }
+  }
+  json += '}';
+
+  {
+    SupplyStatus ss;
+    supplyMonitorGet(ss);
+    if (ss.enabled) {
+      json += F(",\"supply\":{\"mv\":");
+      json += String((unsigned)ss.mv);
+      json += F(",\"min_mv\":");
+      json += String((unsigned)ss.minMv);
+      json += F(",\"failing\":");
+      json += (ss.failing ? F("true") : F("false"));
+      json += F(",\"gasps\":");
+      json += String((unsigned long)ss.gasps);
+      json += F(",\"gasp_us\":");
+      json += String((unsigned long)ss.gaspUs);
+      json += F(",\"gasp_sent\":");
+      json += (ss.gaspSent ? F("true") : F("false"));
+      json += '}';
+    }
+  }
+
+  json += F(",\"power_profile\":\"");
+  json += powerProfileText();
+  json += F("\",\"cpu_mhz\":");
+  json += String((unsigned)powerCpuMHz());
+  json += F(",\"cpu_busy_pct\":");
+  json += String((unsigned)powerBusyPercent());
+
   json += '}';
 
   gServer.send(200, "application/json; charset=utf-8", json);
 }
 
+static void handleWifiJournalJson() {
+  gServer.sendHeader("Cache-Control", "no-store");
+
+  const uint8_t count = wifiJournalCount();
+
+  String json;
+  json.reserve(96 + (size_t)count * 96);
+
+  json += F("{\"boot\":");
+  json += String((unsigned)wifiJournalBootSeq());
+  json += F(",\"uptime_ms\":");
+  json += String((unsigned long)millis());
+  json += F(",\"events\":[");
+
+  for (uint8_t i = 0; i < count; i++) {
+    WifiJournalEntry e;
+    if (!wifiJournalGet(i, e)) break;
+    if (i) json += ',';
+
+    json += F("{\"boot\":");
+    json += String((unsigned)e.boot);
+    json += F(",\"ms\":");
+    json += String((unsigned long)e.ms);
+    json += F(",\"type\":\"");
+    json += wifiJournalEventText(e.type);
+    json += F("\",\"arg\":");
+    json += String((unsigned)e.arg);
+    if (e.type == (uint8_t)WifiJournalEvent::Disconnect) {
+      json += F(",\"reason\":\"");
+      json += wifiDisconnectReasonText(e.arg);
+      json += '"';
+    }
+    json += F(",\"value\":");
+    json += String((unsigned)e.value);
+    json += F(",\"rssi\":");
+    json += String((int)e.rssi);
+    json += '}';
+  }
+
+  json += F("]}");
+
+  gServer.send(200, "application/json; charset=utf-8", json);
+}
+
+static void appendLatencyUs(String& json, uint32_t us) {
+  if (us == LATENCY_NONE) {
+    json += F("null");
+  } else {
+    json += String((unsigned long)us);
+  }
+}
+
+static void handleLatencyJson() {
+  gServer.sendHeader("Cache-Control", "no-store");
+
+  const uint8_t count = latencySampleCount();
+
+  String json;
+  json.reserve(768 + (size_t)count * 128);
+
+  json += F("{\"uptime_s\":");
+  json += String((unsigned long)(millis() / 1000));
+
+  // Bucket upper bounds (ms); the last bucket is open-ended.
+  json += F(",\"bucket_ms\":[");
+  for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) {
+    if (b) json += ',';
+    const uint32_t upper = latencyBucketUpperMs(b);
+    if (upper) {
+      json += String((unsigned long)upper);
+    } else {
+      json += F("null");
+    }
+  }
+  json += F("],\"phases\":{");
+
+  for (uint8_t i = 0; i < LATENCY_PHASES; i++) {
+    LatencyPhaseStats ps;
+    latencyGetPhase((LatencyPhase)i, ps);
+    if (i) json += ',';
+    json += '"';
+    json += latencyPhaseText((LatencyPhase)i);
+    json += F("\":{\"n\":");
+    json += String((unsigned long)ps.count);
+    json += F(",\"avg_us\":");
+    json += String((unsigned long)ps.avgUs);
+    json += F(",\"max_us\":");
+    json += String((unsigned long)ps.maxUs);
+    json += F(",\"hist\":[");
+    for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) {
+      if (b) json += ',';
+      json += String((unsigned long)ps.buckets[b]);
+    }
+    json += F("]}");
+  }
+
+  json += F("},\"recent\":[");
+  for (uint8_t i = 0; i < count; i++) {
+    LatencySample s;
+    if (!latencySampleGet(i, s)) break;
+    if (i) json += ',';
+
+    json += F("{\"t\":");
+    json += String((unsigned long)s.uptimeS);
+    json += F(",\"epoch\":");
+    json += String((unsigned long)s.epoch);
+    json += F(",\"rssi\":");
+    json += String((int)s.rssi);
+    json += F(",\"code\":");
+    json += String((unsigned)s.httpCode);
+    json += F(",\"reused\":");
+    json += (s.reused ? F("true") : F("false"));
+    for (uint8_t p = 0; p < LATENCY_PHASES; p++) {
+      json += F(",\"");
+      json += latencyPhaseText((LatencyPhase)p);
+      json += F("_us\":");
+      appendLatencyUs(json, s.us[p]);
+    }
+    json += '}';
+  }
+  json += F("]}");
+
+  gServer.send(200, "application/json; charset=utf-8", json);
+}
+
 static void sendRebootingPage() {
   gServer.sendHeader("Connection", "close");
 
@@ -925,6 +1557,21 @@ static void handleAdmin() {
   body += F("'>");
   body += F("</div>");
 
+  body += F("<div class='field'>");
+  body += F("<label>");
+  body += NOCTUA_I18N_LABEL_EXTRA_CHANNEL_KEYS;
+  body += F("</label>");
+  for (uint8_t i = 0; i < NOCTUA_EXTRA_CHANNEL_KEYS; i++) {
+    body += F("<input name='channel");
+    body += String(i + 2);
+    body += F("' placeholder='");
+    body += htmlEscape(String(NOCTUA_I18N_PLACEHOLDER_OPTIONAL));
+    body += F("' value='");
+    body += htmlEscape(String(gCfg.extraChannelKeys[i]));
+    body += F("'>");
+  }
+  body += F("</div>");
+
   body += F("<div class='field'>");
   body += F("<label>");
   body += NOCTUA_I18N_LABEL_LED;
@@ -939,6 +1586,28 @@ static void handleAdmin() {
   body += F("</label>");
   body += F("</div>");
 
+  body += F("<div class='field'>");
+  body += F("<label>");
+  body += NOCTUA_I18N_LABEL_POWER_PROFILE;
+  body += F("</label>");
+  body += F("<select name='power'>");
+  const __FlashStringHelper* powerNames[] = {
+    NOCTUA_I18N_POWER_PERFORMANCE,
+    NOCTUA_I18N_POWER_BALANCED,
+    NOCTUA_I18N_POWER_LOW,
+  };
+  for (uint8_t i = 0; i < 3; i++) {
+    body += F("<option value='");
+    body += String((unsigned)i);
+    body += '\'';
+    if (gCfg.powerProfile == i) body += F(" selected");
+    body += '>';
+    body += powerNames[i];
+    body += F("</option>");
+  }
+  body += F("</select>");
+  body += F("</div>");
+
   body += F("</div>");
   body += F("</form>");
 
@@ -1176,6 +1845,7 @@ static void handleSave() {
   const String admin = gServer.arg("admin");
   const String admin2 = gServer.arg("admin2");
   const bool ledOn = gServer.hasArg("led_on");
+  const int power = gServer.arg("power").toInt();
 
   // Admin password must be entered twice to avoid accidental lockout.
   if (admin != admin2) {
@@ -1199,8 +1869,13 @@ static void handleSave() {
   copyToBuf(gCfg.wifiSsid, sizeof(gCfg.wifiSsid), ssid);
   copyToBuf(gCfg.wifiPass, sizeof(gCfg.wifiPass), pass);
   copyToBuf(gCfg.channelKey, sizeof(gCfg.channelKey), channel);
+  for (uint8_t i = 0; i < NOCTUA_EXTRA_CHANNEL_KEYS; i++) {
+    const String extra = gServer.arg(String(F("channel")) + String(i + 2));
+    copyToBuf(gCfg.extraChannelKeys[i], sizeof(gCfg.extraChannelKeys[i]), extra);
+  }
   copyToBuf(gCfg.adminPass, sizeof(gCfg.adminPass), admin);
   gCfg.ledDisabled = !ledOn;
+  gCfg.powerProfile = (power >= 0 && power <= (int)PowerProfile::LowPower) ? (uint8_t)power : 0;
 
   // Forget login immediately after saving
   gLoginExpireMs = 0;
@@ -1267,12 +1942,23 @@ bool portalLoadConfig(NoctuaConfig& cfg) {
     } else if (k == F("channel")) {
       copyToBuf(cfg.channelKey, sizeof(cfg.channelKey), v);
       applied = true;
+    } else if (k.startsWith(F("channel"))) {
+      // channel2, channel3, ...: extra channel keys
+      const int idx = k.substring(7).toInt() - 2;
+      if (idx >= 0 && idx < NOCTUA_EXTRA_CHANNEL_KEYS) {
+        copyToBuf(cfg.extraChannelKeys[idx], sizeof(cfg.extraChannelKeys[idx]), v);
+        applied = true;
+      }
     } else if (k == F("admin")) {
       copyToBuf(cfg.adminPass, sizeof(cfg.adminPass), v);
       applied = true;
     } else if (k == F("led_off")) {
       cfg.ledDisabled = (v == F("1") || v == F("true") || v == F("on"));
       applied = true;
+    } else if (k == F("power")) {
+      const int p = v.toInt();
+      cfg.powerProfile = (p >= 0 && p <= (int)PowerProfile::LowPower) ? (uint8_t)p : 0;
+      applied = true;
     }
   }
 
@@ -1293,12 +1979,22 @@ bool portalSaveConfig(const NoctuaConfig& cfg) {
   f.println(cfg.wifiPass);
   f.print(F("channel="));
   f.println(cfg.channelKey);
+  for (uint8_t i = 0; i < NOCTUA_EXTRA_CHANNEL_KEYS; i++) {
+    if (!cfg.extraChannelKeys[i][0]) continue;
+    f.print(F("channel"));
+    f.print((unsigned)(i + 2));
+    f.print('=');
+    f.println(cfg.extraChannelKeys[i]);
+  }
   f.print(F("admin="));
   f.println(cfg.adminPass);
 
   f.print(F("led_off="));
   f.println(cfg.ledDisabled ? F("1") : F("0"));
 
+  f.print(F("power="));
+  f.println((unsigned)cfg.powerProfile);
+
   f.close();
   LittleFS.end();
   return true;
@@ -1313,10 +2009,12 @@ void portalSetup(const char* apName, const char* apPass) {
   if (apPass && apPass[0]) strlcpy(gApPass, apPass, sizeof(gApPass));
 
   fsBeginWithFormatFallback();
-  portalLoadConfig(gCfg);
+  gCfgLoaded = portalLoadConfig(gCfg);
 
   gServer.on("/", handleRoot);
   gServer.on("/status.json", handleStatusJson);
+  gServer.on("/wifi-journal.json", handleWifiJournalJson);
+  gServer.on("/latency.json", handleLatencyJson);
 
   gServer.on("/login", HTTP_GET, handleLoginGet);
   gServer.on("/login", HTTP_POST, handleLoginPost);
@@ -1328,6 +2026,12 @@ void portalSetup(const char* apName, const char* apPass) {
   gServer.on("/update", HTTP_POST, handleUpdatePost, handleUpdateUpload);
   gServer.onNotFound(handleNotFound);
 
+  // Track portal activity (used to keep the CPU boosted while someone browses).
+  gServer.addHook([](const String&, const String&, WiFiClient*, ESP8266WebServer::ContentTypeFunction) {
+    gLastRequestMs = millis();
+    return ESP8266WebServer::CLIENT_REQUEST_CAN_CONTINUE;
+  });
+
   gServer.begin();
 }
 
@@ -1364,7 +2068,7 @@ void portalStartAP() {
   WiFi.mode(WIFI_AP_STA);
 
   WiFi.softAPConfig(AP_IP, AP_IP, AP_MASK);
-  WiFi.softAP(gApSsid, gApPass);
+  WiFi.softAP(gApSsid, gApPass, gApChannel);
 
   gDns.start(DNS_PORT, "*", AP_IP);
   gApRunning = true;
@@ -1378,3 +2082,24 @@ void portalStopAP() {
 }
 
 bool portalIsAPRunning() { return gApRunning; }
+
+bool portalSetApChannel(uint8_t ch) {
+  if (ch < 1 || ch > 13) return false;
+
+  // Single radio: once the STA associates, the SDK moves the AP by itself.
+  const uint8_t cur = portalApChannel();
+  gApChannel = ch;
+  if (!gApRunning || ch == cur) return false;
+
+  WiFi.softAP(gApSsid, gApPass, gApChannel);
+  return true;
+}
+
+uint8_t portalApChannel() {
+  return gApRunning ? (uint8_t)WiFi.channel() : gApChannel;
+}
+
+bool portalHasActiveClient() {
+  if (gApRunning && WiFi.softAPgetStationNum() > 0) return true;
+  return gLastRequestMs != 0 && (millis() - gLastRequestMs) < CLIENT_ACTIVE_MS;
+}
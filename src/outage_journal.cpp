@@ -0,0 +1,623 @@
+//outage_journal.cpp
+
+#include "outage_journal.h"
+
+#include <ESP8266WiFi.h>
+#include <ESP.h>
+#include <LittleFS.h>
+#include <time.h>
+
+#include "rtc_mem.h"
+#include "tcp_conn.h"
+
+// Upload target (stand-in collector). Disabled unless a host IP is given, e.g.
+//   -DNOCTUA_OUTAGE_UPLOAD_HOST=\"192.168.1.10\" -DNOCTUA_OUTAGE_UPLOAD_PORT=8080
+#ifndef NOCTUA_OUTAGE_UPLOAD_HOST
+#define NOCTUA_OUTAGE_UPLOAD_HOST ""
+#endif
+
+#ifndef NOCTUA_OUTAGE_UPLOAD_PORT
+#define NOCTUA_OUTAGE_UPLOAD_PORT 80
+#endif
+
+#ifndef NOCTUA_OUTAGE_UPLOAD_PATH
+#define NOCTUA_OUTAGE_UPLOAD_PATH "/outages"
+#endif
+
+// SNTP anchors journal times to Unix time. It is started only when the
+// journal is uploaded, or always with -DNOCTUA_OUTAGE_NTP=1 (wall-clock
+// times in status.json too); otherwise times stay relative to each boot and
+// SNTP settings made elsewhere are left alone. An empty SERVER1 = never.
+#ifndef NOCTUA_OUTAGE_NTP
+#define NOCTUA_OUTAGE_NTP 0
+#endif
+
+#ifndef NOCTUA_OUTAGE_NTP_SERVER1
+#define NOCTUA_OUTAGE_NTP_SERVER1 "pool.ntp.org"
+#endif
+
+#ifndef NOCTUA_OUTAGE_NTP_SERVER2
+#define NOCTUA_OUTAGE_NTP_SERVER2 "time.google.com"
+#endif
+
+// ============================================================
+// Tuning
+// ============================================================
+
+static const uint8_t JOURNAL_ENTRIES = 15;
+static const uint32_t ALIVE_EVERY_MS = 60000;                      // RTC "last alive" refresh
+static const uint32_t FLASH_EVERY_MS = 15UL * 60UL * 1000UL;       // periodic checkpoint
+static const uint32_t FLASH_AFTER_CHANGE_MS = 2UL * 60UL * 1000UL; // sooner after a transition
+static const uint32_t LOSS_MIN_S = 20;                             // shorter blips are not recorded
+
+static const uint8_t UPLOAD_BATCH = 8;
+static const uint32_t UPLOAD_RETRY_MS = 60000;
+static const uint32_t UPLOAD_STEP_TIMEOUT_MS = 5000;
+
+static const time_t EPOCH_VALID = 1600000000;  // NTP answered (clock is past 2020)
+
+static const char* JOURNAL_PATH = "/outage_journal.bin";
+static const char* JOURNAL_TMP_PATH = "/outage_journal.tmp";
+
+static const uint32_t JOURNAL_MAGIC = 0x4E4F4A31;  // 'NOJ1'
+
+static const uint8_t NO_SLOT = 0xFF;
+
+enum : uint8_t {
+  FLAG_ANCHORED = 0x01,   // start/end are Unix seconds (else seconds since boot)
+  FLAG_OPEN = 0x02,       // interval still running
+  FLAG_SENT = 0x04,
+  FLAG_IN_FLIGHT = 0x08,  // part of the upload in progress
+  FLAG_LAST_GASP = 0x10,  // PowerOn end stamped by the supply monitor (exact)
+};
+
+// ============================================================
+// Storage image (same layout in RTC memory and on flash)
+// ============================================================
+
+struct OutageEntry {
+  uint32_t start;
+  uint32_t end;
+  uint16_t boot;
+  uint8_t kind;   // OutageKind
+  uint8_t flags;
+};
+
+struct JournalImage {
+  uint32_t magic;
+  uint16_t boot;
+  uint8_t head;   // index of the next slot to write
+  uint8_t count;
+  // This boot's PowerOn interval lives here until the next boot closes it,
+  // so ring wrap-around can never evict it.
+  uint32_t powerStart;
+  uint32_t powerAlive;  // last time seen alive
+  uint8_t powerFlags;
+  uint8_t reserved[3];
+  OutageEntry entries[JOURNAL_ENTRIES];
+};
+
+static_assert(sizeof(OutageEntry) == 12, "outage entry layout changed");
+static_assert(sizeof(JournalImage) <= RTC_OUTAGE_JOURNAL_BLOCKS * 4, "outage journal does not fit its RTC slot");
+
+static JournalImage gImg;
+static bool gReady = false;
+
+static bool gFlashDirty = false;
+static bool gChanged = false;  // transition since last flash write
+static uint32_t gLastFlashMs = 0;
+static uint32_t gLastAliveMs = 0;
+
+// Seconds since boot (millis() wraps after 49 days).
+static uint32_t gUptimeS = 0;
+static uint32_t gUptimeMarkMs = 0;
+
+static bool gAnchored = false;
+static uint32_t gEpochOffset = 0;  // Unix time = uptime + offset
+
+// Supply failing: "last alive" stays at the moment it was detected.
+static bool gPowerFailing = false;
+
+// Previous boot ended with a last gasp (its PowerOn end, this boot's clock
+// base unless gPrevGaspUnix).
+static bool gPrevGasp = false;
+static bool gPrevGaspUnix = false;
+static uint32_t gPrevGaspAt = 0;
+
+static uint8_t gWifiSlot = NO_SLOT;
+static uint8_t gInetSlot = NO_SLOT;
+static bool gWifiDown = false;
+static bool gInetDown = false;
+static uint32_t gWifiDownSinceS = 0;
+static uint32_t gInetDownSinceS = 0;
+
+// Upload
+enum class UploadPhase : uint8_t { Idle = 0, Connect, Send, Status };
+
+static UploadPhase gUpPhase = UploadPhase::Idle;
+static TcpConn gUpConn;
+static String gUpReq;
+static size_t gUpSent = 0;
+static uint32_t gUpDeadlineMs = 0;
+static uint32_t gUpLastTryMs = 0;
+static bool gUpTried = false;
+static char gUpLine[48];
+static size_t gUpLineLen = 0;
+static uint32_t gUploads = 0;
+static char gUpError[32] = {0};
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static bool imageValid(const JournalImage& img) {
+  return img.magic == JOURNAL_MAGIC && img.head < JOURNAL_ENTRIES && img.count <= JOURNAL_ENTRIES;
+}
+
+static void imageReset(JournalImage& img) {
+  memset(&img, 0, sizeof(img));
+  img.magic = JOURNAL_MAGIC;
+}
+
+static void rtcStore() {
+  (void)ESP.rtcUserMemoryWrite(RTC_BLOCK_OUTAGE_JOURNAL, (uint32_t*)&gImg, sizeof(gImg));
+}
+
+static bool rtcLoad(JournalImage& img) {
+  if (!ESP.rtcUserMemoryRead(RTC_BLOCK_OUTAGE_JOURNAL, (uint32_t*)&img, sizeof(img))) return false;
+  return imageValid(img);
+}
+
+static bool flashLoad(JournalImage& img) {
+  if (!LittleFS.exists(JOURNAL_PATH)) return false;
+
+  File f = LittleFS.open(JOURNAL_PATH, "r");
+  if (!f) return false;
+
+  const size_t n = f.read((uint8_t*)&img, sizeof(img));
+  f.close();
+  return n == sizeof(img) && imageValid(img);
+}
+
+static bool flashStore() {
+  // Runtime writes should never format flash. If mount fails, fail fast.
+  if (!LittleFS.begin()) return false;
+
+  // Write to a temp file and rename, so a power cut mid-write keeps the old copy.
+  File f = LittleFS.open(JOURNAL_TMP_PATH, "w");
+  if (!f) return false;
+  const size_t n = f.write((const uint8_t*)&gImg, sizeof(gImg));
+  f.close();
+
+  if (n != sizeof(gImg)) {
+    (void)LittleFS.remove(JOURNAL_TMP_PATH);
+    return false;
+  }
+
+  (void)LittleFS.remove(JOURNAL_PATH);
+  return LittleFS.rename(JOURNAL_TMP_PATH, JOURNAL_PATH);
+}
+
+static void markChanged() {
+  rtcStore();
+  gFlashDirty = true;
+  gChanged = true;
+}
+
+// Current time in this boot's base (Unix seconds once anchored).
+static uint32_t stampOf(uint32_t uptimeS) { return gAnchored ? uptimeS + gEpochOffset : uptimeS; }
+
+static uint8_t appendEntry(OutageKind kind, uint16_t boot, uint32_t start, uint32_t end, uint8_t flags) {
+  const uint8_t slot = gImg.head;
+
+  // Never leave a dangling reference to an overwritten open interval.
+  if (slot == gWifiSlot) gWifiSlot = NO_SLOT;
+  if (slot == gInetSlot) gInetSlot = NO_SLOT;
+
+  OutageEntry& e = gImg.entries[slot];
+  e.start = start;
+  e.end = end;
+  e.boot = boot;
+  e.kind = (uint8_t)kind;
+  e.flags = flags;
+
+  gImg.head = (uint8_t)((gImg.head + 1) % JOURNAL_ENTRIES);
+  if (gImg.count < JOURNAL_ENTRIES) gImg.count++;
+  return slot;
+}
+
+static uint8_t openInterval(OutageKind kind, uint32_t sinceS) {
+  const uint8_t flags = FLAG_OPEN | (gAnchored ? FLAG_ANCHORED : 0);
+  const uint8_t slot = appendEntry(kind, gImg.boot, stampOf(sinceS), stampOf(gUptimeS), flags);
+  markChanged();
+  return slot;
+}
+
+static void closeInterval(uint8_t& slot) {
+  if (slot == NO_SLOT) return;
+  OutageEntry& e = gImg.entries[slot];
+  e.end = stampOf(gUptimeS);
+  e.flags &= (uint8_t)~FLAG_OPEN;
+  slot = NO_SLOT;
+  markChanged();
+}
+
+// Previous boot: its PowerOn interval ends at the last "alive" mark, and so
+// does every interval that was still open when power went away.
+static void closePreviousBoot() {
+  const uint8_t flags = gImg.powerFlags & (FLAG_ANCHORED | FLAG_LAST_GASP);
+  gPrevGasp = (flags & FLAG_LAST_GASP) != 0;
+  gPrevGaspUnix = (flags & FLAG_ANCHORED) != 0;
+  gPrevGaspAt = gImg.powerAlive;
+  (void)appendEntry(OutageKind::PowerOn, gImg.boot, gImg.powerStart, gImg.powerAlive, flags);
+
+  for (uint8_t i = 0; i < JOURNAL_ENTRIES; i++) {
+    OutageEntry& e = gImg.entries[i];
+    if (!(e.flags & FLAG_OPEN)) continue;
+    if (e.boot == gImg.boot && e.end < gImg.powerAlive) e.end = gImg.powerAlive;
+    e.flags &= (uint8_t)~FLAG_OPEN;
+  }
+  for (uint8_t i = 0; i < JOURNAL_ENTRIES; i++) {
+    gImg.entries[i].flags &= (uint8_t)~FLAG_IN_FLIGHT;
+  }
+}
+
+static void updateUptime() {
+  const uint32_t ms = millis();
+  const uint32_t whole = (ms - gUptimeMarkMs) / 1000;
+  gUptimeS += whole;
+  gUptimeMarkMs += whole * 1000;
+}
+
+// First valid NTP time: rebase everything recorded so far in this boot.
+static void tryAnchor() {
+  if (gAnchored) return;
+
+  const time_t t = time(nullptr);
+  if (t < EPOCH_VALID) return;
+
+  gEpochOffset = (uint32_t)t - gUptimeS;
+  gAnchored = true;
+
+  for (uint8_t i = 0; i < JOURNAL_ENTRIES; i++) {
+    OutageEntry& e = gImg.entries[i];
+    if (e.boot != gImg.boot || (e.flags & FLAG_ANCHORED)) continue;
+    e.start += gEpochOffset;
+    e.end += gEpochOffset;
+    e.flags |= FLAG_ANCHORED;
+  }
+  gImg.powerStart += gEpochOffset;
+  gImg.powerAlive += gEpochOffset;
+  gImg.powerFlags |= FLAG_ANCHORED;
+
+  markChanged();
+}
+
+static void trackLink(bool wifiUp, bool internetKnown, bool internetUp) {
+  // Wi-Fi loss (opened once it lasted LOSS_MIN_S, starting when it began)
+  if (!wifiUp) {
+    if (!gWifiDown) {
+      gWifiDown = true;
+      gWifiDownSinceS = gUptimeS;
+    } else if (gWifiSlot == NO_SLOT && gUptimeS - gWifiDownSinceS >= LOSS_MIN_S) {
+      gWifiSlot = openInterval(OutageKind::WifiLoss, gWifiDownSinceS);
+    }
+  } else {
+    gWifiDown = false;
+    closeInterval(gWifiSlot);
+  }
+
+  // Internet loss: only meaningful with Wi-Fi up and a completed check.
+  const bool inetDown = wifiUp && internetKnown && !internetUp;
+  if (inetDown) {
+    if (!gInetDown) {
+      gInetDown = true;
+      gInetDownSinceS = gUptimeS;
+    } else if (gInetSlot == NO_SLOT && gUptimeS - gInetDownSinceS >= LOSS_MIN_S) {
+      gInetSlot = openInterval(OutageKind::InternetLoss, gInetDownSinceS);
+    }
+  } else if (!wifiUp || internetKnown) {
+    gInetDown = false;
+    closeInterval(gInetSlot);
+  }
+}
+
+static const char* kindText(uint8_t kind) {
+  switch ((OutageKind)kind) {
+    case OutageKind::PowerOn: return "power";
+    case OutageKind::WifiLoss: return "wifi_loss";
+    case OutageKind::InternetLoss: return "internet_loss";
+    default: return "?";
+  }
+}
+
+static bool entryPending(const OutageEntry& e) {
+  return e.kind != (uint8_t)OutageKind::None && !(e.flags & (FLAG_OPEN | FLAG_SENT));
+}
+
+// ============================================================
+// Upload (non-blocking, one batch per connection)
+// ============================================================
+
+static bool uploadEnabled() { return NOCTUA_OUTAGE_UPLOAD_HOST[0] != 0; }
+
+static bool anchorEnabled() { return NOCTUA_OUTAGE_NTP_SERVER1[0] != 0 && (NOCTUA_OUTAGE_NTP || uploadEnabled()); }
+
+static void uploadSetError(const char* err) {
+  strncpy(gUpError, err, sizeof(gUpError) - 1);
+  gUpError[sizeof(gUpError) - 1] = 0;
+}
+
+static void uploadFinish(bool ok) {
+  gUpConn.close();
+  gUpPhase = UploadPhase::Idle;
+
+  for (uint8_t i = 0; i < JOURNAL_ENTRIES; i++) {
+    OutageEntry& e = gImg.entries[i];
+    if (!(e.flags & FLAG_IN_FLIGHT)) continue;
+    e.flags &= (uint8_t)~FLAG_IN_FLIGHT;
+    if (ok) e.flags |= FLAG_SENT;
+  }
+
+  if (ok) {
+    gUploads++;
+    gUpError[0] = 0;
+    markChanged();
+    // More left over: send the next batch right away.
+    if (outageJournalUnsent() > 0) gUpTried = false;
+  }
+}
+
+static void uploadFail(const char* err) {
+  uploadSetError(err);
+  uploadFinish(false);
+}
+
+static bool uploadBuildRequest() {
+  String body;
+  body.reserve(64 + UPLOAD_BATCH * 112);
+
+  char buf[112];
+  snprintf(buf, sizeof(buf), "{\"device\":\"%06X\",\"boot\":%u,\"intervals\":[", ESP.getChipId(), (unsigned)gImg.boot);
+  body += buf;
+
+  // Oldest first.
+  uint8_t n = 0;
+  const uint8_t oldest = (uint8_t)((gImg.head + JOURNAL_ENTRIES - gImg.count) % JOURNAL_ENTRIES);
+  for (uint8_t i = 0; i < gImg.count && n < UPLOAD_BATCH; i++) {
+    OutageEntry& e = gImg.entries[(oldest + i) % JOURNAL_ENTRIES];
+    if (!entryPending(e)) continue;
+
+    snprintf(buf, sizeof(buf), "%s{\"kind\":\"%s\",\"boot\":%u,\"start\":%lu,\"end\":%lu,\"clock\":\"%s\"%s}",
+             n ? "," : "", kindText(e.kind), (unsigned)e.boot, (unsigned long)e.start, (unsigned long)e.end,
+             (e.flags & FLAG_ANCHORED) ? "unix" : "uptime", (e.flags & FLAG_LAST_GASP) ? ",\"last_gasp\":true" : "");
+    body += buf;
+    e.flags |= FLAG_IN_FLIGHT;
+    n++;
+  }
+  body += "]}";
+  if (n == 0) return false;
+
+  gUpReq = "";
+  gUpReq.reserve(body.length() + 160);
+  snprintf(buf, sizeof(buf), "POST %s HTTP/1.1\r\nHost: %s\r\n", NOCTUA_OUTAGE_UPLOAD_PATH, NOCTUA_OUTAGE_UPLOAD_HOST);
+  gUpReq += buf;
+  snprintf(buf, sizeof(buf), "Content-Type: application/json\r\nContent-Length: %u\r\n", (unsigned)body.length());
+  gUpReq += buf;
+  gUpReq += "Connection: close\r\n\r\n";
+  gUpReq += body;
+  gUpSent = 0;
+  return true;
+}
+
+static void uploadStart() {
+  IPAddress ip;
+  if (!ip.fromString(NOCTUA_OUTAGE_UPLOAD_HOST)) {
+    uploadSetError("upload host must be an IP");
+    return;
+  }
+
+  if (!uploadBuildRequest()) return;
+
+  if (!gUpConn.connect(ip, NOCTUA_OUTAGE_UPLOAD_PORT)) {
+    uploadFail("connect failed");
+    return;
+  }
+  gUpPhase = UploadPhase::Connect;
+  gUpDeadlineMs = millis() + UPLOAD_STEP_TIMEOUT_MS;
+}
+
+static void uploadStep() {
+  const bool expired = (int32_t)(millis() - gUpDeadlineMs) >= 0;
+
+  switch (gUpPhase) {
+    case UploadPhase::Connect:
+      if (gUpConn.connected()) {
+        gUpPhase = UploadPhase::Send;
+        gUpDeadlineMs = millis() + UPLOAD_STEP_TIMEOUT_MS;
+      } else if (expired || gUpConn.state() != TcpConn::State::Connecting) {
+        uploadFail("connect failed");
+      }
+      break;
+
+    case UploadPhase::Send:
+      if (!gUpConn.connected()) {
+        uploadFail("write failed");
+        break;
+      }
+      gUpSent += gUpConn.write((const uint8_t*)gUpReq.c_str() + gUpSent, gUpReq.length() - gUpSent);
+      if (gUpSent >= gUpReq.length()) {
+        gUpPhase = UploadPhase::Status;
+        gUpLineLen = 0;
+        gUpDeadlineMs = millis() + UPLOAD_STEP_TIMEOUT_MS;
+      } else if (expired) {
+        uploadFail("write failed");
+      }
+      break;
+
+    case UploadPhase::Status: {
+      uint8_t c;
+      while (gUpConn.read(&c, 1) == 1) {
+        if (c == '\r') continue;
+        if (c != '\n') {
+          if (gUpLineLen + 1 < sizeof(gUpLine)) gUpLine[gUpLineLen++] = (char)c;
+          continue;
+        }
+
+        gUpLine[gUpLineLen] = 0;
+        const char* sp = strchr(gUpLine, ' ');
+        const int code = sp ? atoi(sp + 1) : 0;
+        if (code >= 200 && code < 300) {
+          uploadFinish(true);
+        } else {
+          char err[24];
+          snprintf(err, sizeof(err), "HTTP %d", code);
+          uploadFail(err);
+        }
+        return;
+      }
+      if (expired || (!gUpConn.available() && (gUpConn.peerClosed() || !gUpConn.connected()))) {
+        uploadFail("read timeout");
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+}
+
+static void uploadLoop(bool healthy) {
+  if (gUpPhase != UploadPhase::Idle) {
+    if (!healthy) {
+      uploadFail("link lost");
+    } else {
+      uploadStep();
+    }
+    return;
+  }
+
+  if (!uploadEnabled() || !healthy || outageJournalUnsent() == 0) return;
+
+  const uint32_t now = millis();
+  if (gUpTried && now - gUpLastTryMs < UPLOAD_RETRY_MS) return;
+  gUpTried = true;
+  gUpLastTryMs = now;
+  uploadStart();
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+void outageJournalSetup() {
+  // Soft reset: RTC copy is the freshest. Power-on: fall back to flash.
+  if (rtcLoad(gImg) || flashLoad(gImg)) {
+    closePreviousBoot();
+    if (gPrevGasp) {
+      Serial.printf("⚡ [Outage] previous boot: supply failed at %lu (%s)\n", (unsigned long)gPrevGaspAt,
+                    gPrevGaspUnix ? "unix" : "uptime s");
+    }
+  } else {
+    imageReset(gImg);
+  }
+
+  gImg.boot++;
+  gImg.powerStart = 0;
+  gImg.powerAlive = 0;
+  gImg.powerFlags = 0;
+
+  gUptimeS = 0;
+  gUptimeMarkMs = millis();
+  gLastAliveMs = gUptimeMarkMs;
+  gLastFlashMs = gUptimeMarkMs;
+
+  // SNTP runs in the background once the network is up; never blocks.
+  if (anchorEnabled()) configTime(0, 0, NOCTUA_OUTAGE_NTP_SERVER1, NOCTUA_OUTAGE_NTP_SERVER2);
+
+  gReady = true;
+  markChanged();
+}
+
+void outageJournalLoop(bool wifiUp, bool internetKnown, bool internetUp) {
+  if (!gReady) return;
+
+  updateUptime();
+  tryAnchor();
+  trackLink(wifiUp, internetKnown, internetUp);
+
+  const uint32_t now = millis();
+  if (!gPowerFailing && now - gLastAliveMs >= ALIVE_EVERY_MS) {
+    gLastAliveMs = now;
+    gImg.powerAlive = stampOf(gUptimeS);
+    rtcStore();
+    gFlashDirty = true;
+  }
+
+  // Flash wears; a power cut loses at most FLASH_EVERY_MS of "alive" time.
+  const uint32_t sinceFlash = now - gLastFlashMs;
+  if (gFlashDirty && (sinceFlash >= FLASH_EVERY_MS || (gChanged && sinceFlash >= FLASH_AFTER_CHANGE_MS))) {
+    gLastFlashMs = now;
+    if (!gPowerFailing) gImg.powerAlive = stampOf(gUptimeS);
+    if (flashStore()) {
+      gFlashDirty = false;
+      gChanged = false;
+    } else {
+      Serial.println("⚠️ [Outage] flash checkpoint failed");
+    }
+  }
+
+  uploadLoop(wifiUp && internetKnown && internetUp);
+}
+
+void outageJournalPowerFailing() {
+  if (!gReady || gPowerFailing) return;
+  gPowerFailing = true;
+
+  updateUptime();
+  gImg.powerAlive = stampOf(gUptimeS);
+  gImg.powerFlags |= FLAG_LAST_GASP;
+  rtcStore();
+
+  // Temp file + rename: a cut mid-write keeps the previous checkpoint.
+  gLastFlashMs = millis();
+  if (flashStore()) {
+    gFlashDirty = false;
+    gChanged = false;
+  } else {
+    gFlashDirty = true;
+  }
+}
+
+void outageJournalPowerRecovered() {
+  if (!gReady || !gPowerFailing) return;
+  gPowerFailing = false;
+
+  updateUptime();
+  gImg.powerFlags &= (uint8_t)~FLAG_LAST_GASP;
+  gImg.powerAlive = stampOf(gUptimeS);
+  markChanged();
+}
+
+bool outageJournalPreviousLastGasp(uint32_t& at, bool& unixTime) {
+  if (!gPrevGasp) return false;
+  at = gPrevGaspAt;
+  unixTime = gPrevGaspUnix;
+  return true;
+}
+
+bool outageJournalTimeAnchored() { return gAnchored; }
+
+uint8_t outageJournalCount() { return gImg.count; }
+
+uint8_t outageJournalUnsent() {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < JOURNAL_ENTRIES; i++) {
+    if (entryPending(gImg.entries[i])) n++;
+  }
+  return n;
+}
+
+uint32_t outageJournalUploads() { return gUploads; }
+
+const char* outageJournalUploadError() { return gUpError; }
@@ -0,0 +1,105 @@
+//ping_latency.cpp
+
+#include "ping_latency.h"
+
+#include <ESP8266WiFi.h>
+#include <time.h>
+
+// ============================================================
+// Tuning
+// ============================================================
+
+static const uint8_t SAMPLE_COUNT = 16;
+static const time_t EPOCH_VALID_AFTER = 1600000000;  // 2020-09: NTP has synced
+
+// ============================================================
+// State
+// ============================================================
+
+struct PhaseAcc {
+  uint32_t count;
+  uint64_t sumUs;
+  uint32_t maxUs;
+  uint32_t buckets[LATENCY_BUCKETS];
+};
+
+static PhaseAcc gPhases[LATENCY_PHASES] = {};
+
+static LatencySample gSamples[SAMPLE_COUNT];
+static uint8_t gSampleHead = 0;  // next slot to write
+static uint8_t gSampleCount = 0;
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static uint8_t bucketFor(uint32_t us) {
+  uint32_t ms = us / 1000;
+  uint8_t b = 0;
+  while (ms && b < LATENCY_BUCKETS - 1) {
+    ms >>= 1;
+    b++;
+  }
+  return b;
+}
+
+static void addPhase(LatencyPhase p, uint32_t us) {
+  if (us == LATENCY_NONE) return;
+  PhaseAcc& a = gPhases[(uint8_t)p];
+  a.count++;
+  a.sumUs += us;
+  if (us > a.maxUs) a.maxUs = us;
+  a.buckets[bucketFor(us)]++;
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+void latencyRecord(const PingTiming& t, int httpCode, bool reused) {
+  for (uint8_t i = 0; i < LATENCY_PHASES; i++) addPhase((LatencyPhase)i, t.us[i]);
+
+  LatencySample& s = gSamples[gSampleHead];
+  s.uptimeS = millis() / 1000;
+  const time_t now = time(nullptr);
+  s.epoch = (now > EPOCH_VALID_AFTER) ? (uint32_t)now : 0;
+  memcpy(s.us, t.us, sizeof(s.us));
+  s.httpCode = (httpCode > 0 && httpCode < 1000) ? (uint16_t)httpCode : 0;
+  s.rssi = (WiFi.status() == WL_CONNECTED) ? (int8_t)WiFi.RSSI() : 0;
+  s.reused = reused;
+
+  gSampleHead = (uint8_t)((gSampleHead + 1) % SAMPLE_COUNT);
+  if (gSampleCount < SAMPLE_COUNT) gSampleCount++;
+}
+
+void latencyGetPhase(LatencyPhase p, LatencyPhaseStats& out) {
+  const PhaseAcc& a = gPhases[(uint8_t)p];
+  out.count = a.count;
+  out.avgUs = a.count ? (uint32_t)(a.sumUs / a.count) : 0;
+  out.maxUs = a.maxUs;
+  memcpy(out.buckets, a.buckets, sizeof(out.buckets));
+}
+
+uint32_t latencyBucketUpperMs(uint8_t bucket) {
+  if (bucket >= LATENCY_BUCKETS - 1) return 0;
+  return 1UL << bucket;
+}
+
+uint8_t latencySampleCount() { return gSampleCount; }
+
+bool latencySampleGet(uint8_t idx, LatencySample& out) {
+  if (idx >= gSampleCount) return false;
+  const uint8_t oldest = (uint8_t)((gSampleHead + SAMPLE_COUNT - gSampleCount) % SAMPLE_COUNT);
+  out = gSamples[(oldest + idx) % SAMPLE_COUNT];
+  return true;
+}
+
+const char* latencyPhaseText(LatencyPhase p) {
+  switch (p) {
+    case LatencyPhase::Dns: return "dns";
+    case LatencyPhase::Connect: return "connect";
+    case LatencyPhase::Ttfb: return "ttfb";
+    case LatencyPhase::Total: return "total";
+    default: return "?";
+  }
+}
@@ -0,0 +1,213 @@
+//ping_scheduler.cpp
+
+#include "ping_scheduler.h"
+
+#include <ESP.h>
+
+// ============================================================
+// Tuning
+// ============================================================
+
+static const uint32_t SLOT_JITTER_MS = 5000;              // per-slot random offset
+static const uint32_t MIN_INTERVAL_MS = 30000;            // server hints are clamped
+static const uint32_t MAX_INTERVAL_MS = 15UL * 60UL * 1000UL;
+static const uint32_t MAX_BACKOFF_MS = 15UL * 60UL * 1000UL;
+static const uint8_t MAX_BACKOFF_LEVEL = 4;               // interval << 4 before the cap
+static const uint32_t RETRY_AFTER_SPREAD_MAX_MS = 30000;  // jitter on top of Retry-After
+
+// Fast retries after a transient failure: 2 s, 4 s, 8 s (+ up to 50% jitter),
+// at most RETRY_BUDGET per interval, never closer than RETRY_GUARD_MS to the
+// next regular slot.
+static const uint32_t RETRY_BASE_MS = 2000;
+static const uint8_t RETRY_BUDGET = 3;
+static const uint32_t RETRY_GUARD_MS = 10000;
+
+// ============================================================
+// State
+// ============================================================
+
+static uint32_t gIntervalMs = 90000;
+static uint32_t gPhaseMs = 0;
+
+static uint32_t gSlotMs = 0;    // anchored slot time (millis)
+static uint32_t gJitterMs = 0;  // random offset for the current slot
+static uint8_t gBackoffLevel = 0;
+static bool gRejoinPhase = false;  // set by pingSchedStartNow()
+
+static uint32_t gRetryDueMs = 0;   // 0 = no retry pending
+static uint8_t gRetriesUsed = 0;   // since the last regular slot
+static bool gLastWasRetry = false;
+static PingRetryStats gRetry = {};
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static uint32_t randomBelow(uint32_t n) { return n ? (ESP.random() % n) : 0; }
+
+static uint32_t dueMs() { return gSlotMs + gJitterMs; }
+
+static bool slotDue() { return (int32_t)(millis() - dueMs()) >= 0; }
+
+static bool retryDue() { return gRetryDueMs != 0 && (int32_t)(millis() - gRetryDueMs) >= 0; }
+
+static void retryReset() {
+  gRetryDueMs = 0;
+  gRetriesUsed = 0;
+}
+
+// Schedules the next quick retry if the budget and the next slot allow it.
+static void retrySchedule() {
+  if (gRetriesUsed >= RETRY_BUDGET) {
+    gRetry.exhausted++;
+    return;
+  }
+
+  const uint32_t backoff = RETRY_BASE_MS << gRetriesUsed;
+  const uint32_t delayMs = backoff + randomBelow(backoff / 2);
+  const uint32_t due = millis() + delayMs;
+
+  // The regular slot is about to fire anyway.
+  if ((int32_t)(dueMs() - due) < (int32_t)RETRY_GUARD_MS) {
+    gRetry.exhausted++;
+    return;
+  }
+
+  gRetriesUsed++;
+  gRetryDueMs = due ? due : 1;
+}
+
+// Stable per-device value in [0, 1<<16) (Knuth multiplicative hash of the chip ID).
+static uint32_t chipPhaseFraction() {
+  return ((ESP.getChipId() * 2654435761UL) >> 16) & 0xFFFF;
+}
+
+// Missed slots (Wi-Fi down, long apply) are skipped, not fired back to back:
+// the ping that just started covers them, the next slot lies ahead.
+static void skipMissedSlots() {
+  const uint32_t now = millis();
+  while ((int32_t)(now - gSlotMs) >= 0) gSlotMs += gIntervalMs;
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+void pingSchedSetup(uint32_t intervalMs) {
+  gIntervalMs = intervalMs;
+  gPhaseMs = (uint32_t)(((uint64_t)chipPhaseFraction() * intervalMs) >> 16);
+}
+
+void pingSchedRestart(uint32_t minDelayMs) {
+  gSlotMs = millis() + minDelayMs + gPhaseMs;
+  gJitterMs = randomBelow(SLOT_JITTER_MS);
+  gRejoinPhase = false;
+  retryReset();
+}
+
+void pingSchedStartNow() {
+  gSlotMs = millis();
+  gJitterMs = 0;
+  gRejoinPhase = true;
+  retryReset();
+}
+
+bool pingSchedDue() { return slotDue() || retryDue(); }
+
+void pingSchedOnStarted() {
+  // A retry runs between slots and leaves them alone.
+  if (!slotDue() && retryDue()) {
+    gRetryDueMs = 0;
+    gLastWasRetry = true;
+    gRetry.scheduled++;
+    return;
+  }
+
+  gLastWasRetry = false;
+  retryReset();
+
+  if (gRejoinPhase) {
+    gRejoinPhase = false;
+    const uint32_t now = millis();
+    gSlotMs = now + gPhaseMs;
+    while (gSlotMs - now < gIntervalMs / 2) gSlotMs += gIntervalMs;
+    gJitterMs = randomBelow(SLOT_JITTER_MS);
+    return;
+  }
+
+  gSlotMs += gIntervalMs;
+  gJitterMs = randomBelow(SLOT_JITTER_MS);
+  skipMissedSlots();
+}
+
+void pingSchedOnResult(const ApiPingResult& r) {
+  const int httpCode = r.httpCode;
+  if (r.intervalHintS > 0) {
+    // Clamped in seconds first: a huge hint must not wrap to a short interval.
+    uint32_t s = (uint32_t)r.intervalHintS;
+    if (s > MAX_INTERVAL_MS / 1000) s = MAX_INTERVAL_MS / 1000;
+    uint32_t ms = s * 1000UL;
+    if (ms < MIN_INTERVAL_MS) ms = MIN_INTERVAL_MS;
+    if (ms > MAX_INTERVAL_MS) ms = MAX_INTERVAL_MS;
+    if (ms != gIntervalMs) {
+      // Keep the slot anchor; the next slot moves by the difference.
+      gSlotMs = gSlotMs - gIntervalMs + ms;
+      gIntervalMs = ms;
+    }
+  }
+
+  const bool throttled = (httpCode == 429 || httpCode == 503);
+  if (!throttled) {
+    if (r.ok) {
+      gBackoffLevel = 0;
+      if (gLastWasRetry) gRetry.recovered++;
+      gRetryDueMs = 0;
+    } else if (r.retryable) {
+      retrySchedule();
+    } else {
+      gRetry.notRetryable++;
+    }
+    gLastWasRetry = false;
+    return;
+  }
+
+  // The server asked us to slow down: no quick retries.
+  gLastWasRetry = false;
+  retryReset();
+
+  if (gBackoffLevel < MAX_BACKOFF_LEVEL) gBackoffLevel++;
+
+  uint32_t delayMs;
+  if (r.retryAfterS >= 0) {
+    const uint32_t s = (uint32_t)r.retryAfterS;
+    delayMs = (s > MAX_BACKOFF_MS / 1000) ? MAX_BACKOFF_MS : s * 1000UL;
+  } else {
+    delayMs = gIntervalMs << gBackoffLevel;
+  }
+  if (delayMs > MAX_BACKOFF_MS) delayMs = MAX_BACKOFF_MS;
+  if (delayMs < gIntervalMs) delayMs = gIntervalMs;
+
+  // The whole fleet may get the same Retry-After: spread the comeback.
+  uint32_t spread = delayMs / 4;
+  if (spread > RETRY_AFTER_SPREAD_MAX_MS) spread = RETRY_AFTER_SPREAD_MAX_MS;
+
+  gSlotMs = millis() + delayMs;
+  gJitterMs = randomBelow(spread);
+}
+
+uint32_t pingSchedMsUntilDue() {
+  int32_t left = (int32_t)(dueMs() - millis());
+  if (gRetryDueMs != 0) {
+    const int32_t retryLeft = (int32_t)(gRetryDueMs - millis());
+    if (retryLeft < left) left = retryLeft;
+  }
+  return (left > 0) ? (uint32_t)left : 0;
+}
+
+uint32_t pingSchedIntervalMs() { return gIntervalMs; }
+
+uint32_t pingSchedPhaseMs() { return gPhaseMs; }
+
+uint8_t pingSchedBackoffLevel() { return gBackoffLevel; }
+
+void pingSchedGetRetryStats(PingRetryStats& out) { out = gRetry; }
@@ -0,0 +1,131 @@
+//power.cpp
+
+#include "power.h"
+
+#include <ESP8266WiFi.h>
+#include <user_interface.h>
+
+// ============================================================
+// Tuning
+// ============================================================
+
+// Light sleep wakes every Nth DTIM. The AP buffers downlink frames meanwhile,
+// so this is the worst-case extra latency for a reply (N x DTIM x beacon).
+static const uint8_t LOW_POWER_LISTEN_INTERVAL = 3;
+
+// Keep the boosted state a little after the last busy signal to avoid
+// toggling the clock between back-to-back portal requests.
+static const uint32_t BUSY_HOLD_MS = 2000;
+
+static const uint32_t LOOP_DELAY_BUSY_MS = 10;
+static const uint32_t LOOP_DELAY_BALANCED_MS = 20;
+static const uint32_t LOOP_DELAY_LOW_POWER_MS = 50;
+
+// ============================================================
+// Internal state
+// ============================================================
+
+static PowerProfile gProfile = PowerProfile::Performance;
+
+static bool gBusy = true;
+static uint32_t gBusyUntilMs = 0;
+
+static uint32_t gStatLastMs = 0;
+static uint32_t gStatBusyMs = 0;
+static uint32_t gStatTotalMs = 0;
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static bool profileSleeps() { return gProfile != PowerProfile::Performance; }
+
+static WiFiSleepType_t profileSleepType() {
+  switch (gProfile) {
+    case PowerProfile::Balanced: return WIFI_MODEM_SLEEP;
+    case PowerProfile::LowPower: return WIFI_LIGHT_SLEEP;
+    default: return WIFI_NONE_SLEEP;
+  }
+}
+
+static void applyBusy(bool busy) {
+  if (busy) {
+    (void)system_update_cpu_freq(SYS_CPU_160MHZ);
+    // Suspend Wi-Fi sleep so portal requests don't wait for the next DTIM.
+    WiFi.setSleepMode(WIFI_NONE_SLEEP);
+  } else {
+    (void)system_update_cpu_freq(SYS_CPU_80MHZ);
+    WiFi.setSleepMode(profileSleepType(), powerWifiListenInterval());
+  }
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+void powerSetup(uint8_t profile) {
+  gProfile = (profile <= (uint8_t)PowerProfile::LowPower) ? (PowerProfile)profile : PowerProfile::Performance;
+
+  // Start boosted; powerLoop() drops to idle once nothing is going on.
+  gBusy = true;
+  gBusyUntilMs = millis() + BUSY_HOLD_MS;
+  gStatLastMs = millis();
+
+  if (profileSleeps()) (void)system_update_cpu_freq(SYS_CPU_160MHZ);
+}
+
+WiFiSleepType_t powerWifiSleepType() {
+  return gBusy ? WIFI_NONE_SLEEP : profileSleepType();
+}
+
+uint8_t powerWifiListenInterval() {
+  // 0 = wake on every DTIM (SDK default, DTIM-aligned).
+  return (gProfile == PowerProfile::LowPower) ? LOW_POWER_LISTEN_INTERVAL : 0;
+}
+
+void powerLoop(bool busy) {
+  const uint32_t now = millis();
+
+  // Busy-time accounting (reported in status.json).
+  const uint32_t dt = now - gStatLastMs;
+  gStatLastMs = now;
+  gStatTotalMs += dt;
+  if (gBusy) gStatBusyMs += dt;
+  if (gStatTotalMs > 0x7FFFFFFFUL) {
+    gStatTotalMs /= 2;
+    gStatBusyMs /= 2;
+  }
+
+  if (!profileSleeps()) return;
+
+  if (busy) gBusyUntilMs = now + BUSY_HOLD_MS;
+  const bool wantBusy = busy || (int32_t)(gBusyUntilMs - now) > 0;
+  if (wantBusy == gBusy) return;
+
+  gBusy = wantBusy;
+  applyBusy(gBusy);
+}
+
+uint32_t powerIdleDelayMs() {
+  if (gBusy) return LOOP_DELAY_BUSY_MS;
+  switch (gProfile) {
+    case PowerProfile::Balanced: return LOOP_DELAY_BALANCED_MS;
+    case PowerProfile::LowPower: return LOOP_DELAY_LOW_POWER_MS;
+    default: return LOOP_DELAY_BUSY_MS;
+  }
+}
+
+const char* powerProfileText() {
+  switch (gProfile) {
+    case PowerProfile::Balanced: return "balanced";
+    case PowerProfile::LowPower: return "low_power";
+    default: return "performance";
+  }
+}
+
+uint8_t powerCpuMHz() { return system_get_cpu_freq(); }
+
+uint8_t powerBusyPercent() {
+  if (gStatTotalMs == 0) return 100;
+  return (uint8_t)((uint64_t)gStatBusyMs * 100 / gStatTotalMs);
+}
@@ -0,0 +1,106 @@
+//provision.cpp
+
+#include "provision.h"
+
+#include <ESP8266WiFi.h>
+
+#include "io_ui.h"
+#include "noctua_portal.h"
+#include "wifi_manager.h"
+
+// ============================================================
+// Tuning
+// ============================================================
+
+static const uint32_t PROVISION_TIMEOUT_MS = 120000;
+
+// ============================================================
+// Internal state
+// ============================================================
+
+static bool gActive = false;
+static uint32_t gStartMs = 0;
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static void provisionStop() {
+  WiFi.stopSmartConfig();
+  gActive = false;
+  ioSetStaBlinkEnabled(false);
+  wifiManagerSuspend(false);
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+void provisionStart() {
+  if (gActive) return;
+
+  Serial.println("[Provision] ESP-Touch: waiting for credentials...");
+
+  // SmartConfig sniffs in STA mode; a running soft AP would pin the channel.
+  wifiManagerSuspend(true);
+  if (portalIsAPRunning()) portalStopAP();
+
+  WiFi.mode(WIFI_STA);
+  WiFi.disconnect(false);
+  delay(50);
+
+  if (!WiFi.beginSmartConfig()) {
+    Serial.println("❌ [Provision] beginSmartConfig failed -> AP mode");
+    wifiManagerSuspend(false);
+    portalStartAP();
+    return;
+  }
+
+  gActive = true;
+  gStartMs = millis();
+  ioSetStaBlinkEnabled(true);
+}
+
+void provisionCancel() {
+  if (!gActive) return;
+  Serial.println("[Provision] cancelled");
+  provisionStop();
+}
+
+void provisionLoop() {
+  if (!gActive) return;
+
+  if (WiFi.smartConfigDone()) {
+    const String ssid = WiFi.SSID();
+    const String pass = WiFi.psk();
+    provisionStop();
+
+    if (ssid.length() == 0 || ssid.length() >= sizeof(portalConfig().wifiSsid) ||
+        pass.length() >= sizeof(portalConfig().wifiPass)) {
+      Serial.println("❌ [Provision] invalid credentials -> AP mode");
+      portalStartAP();
+      return;
+    }
+
+    NoctuaConfig& cfg = portalConfig();
+    strlcpy(cfg.wifiSsid, ssid.c_str(), sizeof(cfg.wifiSsid));
+    strlcpy(cfg.wifiPass, pass.c_str(), sizeof(cfg.wifiPass));
+
+    Serial.printf("✅ [Provision] got SSID '%s'\n", cfg.wifiSsid);
+    if (!portalSaveConfig(cfg)) {
+      Serial.println("⚠️ [Provision] config save failed (using credentials until reboot)");
+    }
+
+    // Same path as a portal save: main loop re-applies Wi-Fi without reboot.
+    portalMarkConfigDirty();
+    return;
+  }
+
+  if (millis() - gStartMs >= PROVISION_TIMEOUT_MS) {
+    Serial.println("⚠️ [Provision] timeout -> AP mode");
+    provisionStop();
+    portalStartAP();
+  }
+}
+
+bool provisionIsActive() { return gActive; }
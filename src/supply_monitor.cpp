@@ -0,0 +1,153 @@
+//supply_monitor.cpp
+
+#include "supply_monitor.h"
+
+#include <ESP.h>
+
+#include "outage_journal.h"
+#include "udp_heartbeat.h"
+
+// ============================================================
+// Config
+// ============================================================
+
+// 0: off, 1: ESP VCC (internal ADC), 2: input rail via a divider on A0.
+#ifndef NOCTUA_SUPPLY_MONITOR
+#define NOCTUA_SUPPLY_MONITOR 0
+#endif
+
+// Below this the supply counts as failing. VCC sags once the regulator
+// drops out; a divider on the 5 V rail sees the loss much earlier.
+#ifndef NOCTUA_SUPPLY_FAIL_MV
+#if NOCTUA_SUPPLY_MONITOR == 2
+#define NOCTUA_SUPPLY_FAIL_MV 4500
+#else
+#define NOCTUA_SUPPLY_FAIL_MV 2900
+#endif
+#endif
+
+#ifndef NOCTUA_SUPPLY_RESTORE_MV
+#define NOCTUA_SUPPLY_RESTORE_MV (NOCTUA_SUPPLY_FAIL_MV + 200)
+#endif
+
+// A0 mode: supply voltage that reads as full scale (1023), divider included.
+#ifndef NOCTUA_SUPPLY_A0_FULL_MV
+#define NOCTUA_SUPPLY_A0_FULL_MV 5000
+#endif
+
+#if NOCTUA_SUPPLY_MONITOR == 1
+// Must appear once, at file scope: routes the ADC to VCC.
+ADC_MODE(ADC_VCC);
+#endif
+
+// ============================================================
+// Tuning
+// ============================================================
+
+static const uint32_t SAMPLE_MS = 10;      // ADC reads much more often than this disturb Wi-Fi
+static const uint8_t CONFIRM_SAMPLES = 2;  // one low reading may be ADC noise
+static const uint32_t RESTORE_MS = 2000;   // back above RESTORE_MV this long = recovered
+
+static const uint16_t FAIL_MV = NOCTUA_SUPPLY_FAIL_MV;
+static const uint16_t RESTORE_MV = NOCTUA_SUPPLY_RESTORE_MV;
+
+// ============================================================
+// State
+// ============================================================
+
+static SupplyStatus gStatus = {NOCTUA_SUPPLY_MONITOR != 0, 0, 0, false, 0, 0, false};
+
+static uint32_t gLastSampleMs = 0;
+static bool gArmed = false;  // seen a healthy supply since boot
+static uint8_t gLowSamples = 0;
+static bool gGood = false;   // failing, but back above RESTORE_MV since gGoodSinceMs
+static uint32_t gGoodSinceMs = 0;
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static uint16_t readMv() {
+#if NOCTUA_SUPPLY_MONITOR == 1
+  return ESP.getVcc();
+#elif NOCTUA_SUPPLY_MONITOR == 2
+  return (uint16_t)((uint32_t)analogRead(A0) * NOCTUA_SUPPLY_A0_FULL_MV / 1023);
+#else
+  return 0;
+#endif
+}
+
+static void lastGasp() {
+  const uint32_t startUs = micros();
+
+  // Network first: it is what the user sees; the journal is for later.
+  gStatus.gaspSent = udpHeartbeatConfigured() && udpHeartbeatLastGasp();
+  outageJournalPowerFailing();
+
+  gStatus.gaspUs = micros() - startUs;
+  gStatus.gasps++;
+  Serial.printf("⚡ supply failing: %u mV -> last gasp (%s, %lu us)\n", (unsigned)gStatus.mv,
+                gStatus.gaspSent ? "sent" : "not sent", (unsigned long)gStatus.gaspUs);
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+void supplyMonitorSetup() {
+  if (!gStatus.enabled) return;
+
+  gLastSampleMs = millis();
+  gStatus.mv = readMv();
+  gStatus.minMv = gStatus.mv;
+  // A unit that boots on a sagging supply must not gasp before it was healthy.
+  gArmed = gStatus.mv >= RESTORE_MV;
+  Serial.printf("supply: %u mV (fail < %u mV)\n", (unsigned)gStatus.mv, (unsigned)FAIL_MV);
+}
+
+void supplyMonitorLoop() {
+  if (!gStatus.enabled) return;
+
+  const uint32_t now = millis();
+  if (now - gLastSampleMs < SAMPLE_MS) return;
+  gLastSampleMs = now;
+
+  const uint16_t mv = readMv();
+  gStatus.mv = mv;
+  if (mv < gStatus.minMv) gStatus.minMv = mv;
+
+  if (!gStatus.failing) {
+    if (mv >= RESTORE_MV) gArmed = true;
+    if (!gArmed || mv >= FAIL_MV) {
+      gLowSamples = 0;
+      return;
+    }
+    if (++gLowSamples < CONFIRM_SAMPLES) return;
+
+    gStatus.failing = true;
+    gGood = false;
+    lastGasp();
+    return;
+  }
+
+  // Still running: the capacitor/UPS held, or the sag was brief.
+  if (mv < RESTORE_MV) {
+    gGood = false;
+    return;
+  }
+  if (!gGood) {
+    gGood = true;
+    gGoodSinceMs = now;
+    return;
+  }
+  if (now - gGoodSinceMs < RESTORE_MS) return;
+
+  gStatus.failing = false;
+  gLowSamples = 0;
+  outageJournalPowerRecovered();
+  Serial.printf("⚡ supply recovered: %u mV\n", (unsigned)mv);
+}
+
+bool supplyMonitorFailing() { return gStatus.failing; }
+
+void supplyMonitorGet(SupplyStatus& out) { out = gStatus; }
@@ -0,0 +1,166 @@
+//tcp_conn.cpp
+
+#include "tcp_conn.h"
+
+#include <lwip/tcp.h>
+
+// ============================================================
+// lwIP callbacks
+// ============================================================
+
+int8_t TcpConn::onConnected(void* arg, tcp_pcb* pcb, int8_t err) {
+  (void)pcb;
+  TcpConn* self = (TcpConn*)arg;
+  if (!self) return ERR_OK;
+  self->_err = err;
+  self->_state = (err == ERR_OK) ? State::Connected : State::Failed;
+  return ERR_OK;
+}
+
+int8_t TcpConn::onRecv(void* arg, tcp_pcb* pcb, pbuf* p, int8_t err) {
+  (void)pcb;
+  (void)err;
+  TcpConn* self = (TcpConn*)arg;
+  if (!self) {
+    if (p) pbuf_free(p);
+    return ERR_OK;
+  }
+
+  // p == nullptr: peer closed its side.
+  if (!p) {
+    self->_peerClosed = true;
+    return ERR_OK;
+  }
+
+  if (self->_rx) {
+    pbuf_cat(self->_rx, p);
+  } else {
+    self->_rx = p;
+    self->_rxOff = 0;
+  }
+  return ERR_OK;
+}
+
+void TcpConn::onError(void* arg, int8_t err) {
+  // The pcb is already freed by lwIP when this runs.
+  TcpConn* self = (TcpConn*)arg;
+  if (!self) return;
+  self->_pcb = nullptr;
+  self->_err = err;
+  self->_state = State::Failed;
+}
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+void TcpConn::detach() {
+  if (!_pcb) return;
+  tcp_arg(_pcb, nullptr);
+  tcp_recv(_pcb, nullptr);
+  tcp_err(_pcb, nullptr);
+}
+
+void TcpConn::freeRx() {
+  if (_rx) pbuf_free(_rx);
+  _rx = nullptr;
+  _rxOff = 0;
+}
+
+void TcpConn::consume(size_t n) {
+  _rxOff += n;
+  if (_rxOff >= _rx->len) {
+    // Keep the rest of the chain alive while freeing the head.
+    pbuf* head = _rx;
+    _rx = head->next;
+    _rxOff = 0;
+    if (_rx) pbuf_ref(_rx);
+    pbuf_free(head);
+  }
+  if (_pcb) tcp_recved(_pcb, (uint16_t)n);
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+bool TcpConn::connect(const IPAddress& ip, uint16_t port) {
+  abort();
+  _peerClosed = false;
+  _err = ERR_OK;
+
+  _pcb = tcp_new();
+  if (!_pcb) {
+    _err = ERR_MEM;
+    _state = State::Failed;
+    return false;
+  }
+
+  tcp_arg(_pcb, this);
+  tcp_recv(_pcb, &TcpConn::onRecv);
+  tcp_err(_pcb, &TcpConn::onError);
+
+  const ip_addr_t addr = ip;
+  _state = State::Connecting;
+  const err_t e = tcp_connect(_pcb, &addr, port, &TcpConn::onConnected);
+  if (e != ERR_OK) {
+    abort();
+    _err = e;
+    _state = State::Failed;
+    return false;
+  }
+  return true;
+}
+
+size_t TcpConn::write(const uint8_t* data, size_t len) {
+  if (!_pcb || _state != State::Connected || len == 0) return 0;
+
+  size_t n = tcp_sndbuf(_pcb);
+  if (n > len) n = len;
+  if (n > 0xFFFF) n = 0xFFFF;
+  if (n == 0) return 0;
+
+  const err_t e = tcp_write(_pcb, data, (uint16_t)n, TCP_WRITE_FLAG_COPY);
+  if (e != ERR_OK) {
+    _err = e;
+    return 0;
+  }
+  (void)tcp_output(_pcb);
+  return n;
+}
+
+size_t TcpConn::available() const {
+  return _rx ? (size_t)(_rx->tot_len - _rxOff) : 0;
+}
+
+size_t TcpConn::read(uint8_t* buf, size_t n) {
+  size_t total = 0;
+  while (_rx && total < n) {
+    size_t chunk = _rx->len - _rxOff;
+    if (chunk > n - total) chunk = n - total;
+    memcpy(buf + total, (const uint8_t*)_rx->payload + _rxOff, chunk);
+    total += chunk;
+    consume(chunk);
+  }
+  return total;
+}
+
+void TcpConn::close() {
+  if (_pcb) {
+    detach();
+    if (tcp_close(_pcb) != ERR_OK) tcp_abort(_pcb);
+    _pcb = nullptr;
+  }
+  freeRx();
+  if (_state != State::Idle) _state = State::Closed;
+}
+
+void TcpConn::abort() {
+  if (_pcb) {
+    detach();
+    tcp_abort(_pcb);
+    _pcb = nullptr;
+  }
+  freeRx();
+  _state = State::Idle;
+}
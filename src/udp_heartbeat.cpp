@@ -0,0 +1,279 @@
+//udp_heartbeat.cpp
+
+#include "udp_heartbeat.h"
+
+#include <ESP8266WiFi.h>
+#include <ESP.h>
+#include <bearssl/bearssl.h>
+#include <lwip/pbuf.h>
+#include <lwip/udp.h>
+
+#include "heartbeat_wire.h"
+#include "noctua_portal.h"
+#include "ping_latency.h"
+
+// ============================================================
+// Config
+// ============================================================
+
+// Receiver address (IP literal); empty = transport disabled.
+#ifndef NOCTUA_HEARTBEAT_UDP_HOST
+#define NOCTUA_HEARTBEAT_UDP_HOST ""
+#endif
+
+#ifndef NOCTUA_HEARTBEAT_UDP_PORT
+#define NOCTUA_HEARTBEAT_UDP_PORT 7710
+#endif
+
+// 0: fire-and-forget (no ack, no retransmits; reported as HTTP 202).
+#ifndef NOCTUA_HEARTBEAT_ACK
+#define NOCTUA_HEARTBEAT_ACK 1
+#endif
+
+// ============================================================
+// Tuning
+// ============================================================
+
+static const uint8_t GASP_COPIES = 2;  // no ack: the supply will not wait for one
+
+// ============================================================
+// State
+// ============================================================
+
+static IPAddress gDst;
+static udp_pcb* gPcb = nullptr;
+
+// Precomputed: only seq, uptime and the MAC change per heartbeat.
+static uint8_t gPacket[HB_LEN];
+static uint8_t gGasp[HB_LEN];
+static br_hmac_key_context gKey;
+static bool gKeyReady = false;
+
+static uint32_t gNonce = 0;
+static uint32_t gSeq = 0;
+
+static bool gBusy = false;
+static HbRetransmit gRetx = {};
+static uint32_t gStartUs = 0;
+
+// Filled by the UDP callback.
+static bool gAcked = false;
+static HbAck gAck = {};
+
+static UdpHeartbeatStats gStats = {0, 0, 0, 0, -1, 0};
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static void mac(const uint8_t* data, size_t len, uint8_t* out) {
+  br_hmac_context ctx;
+  uint8_t full[br_sha256_SIZE];
+  br_hmac_init(&ctx, &gKey, 0);
+  br_hmac_update(&ctx, data, len);
+  br_hmac_out(&ctx, full);
+  memcpy(out, full, HB_MAC_LEN);
+}
+
+static void loadKey() {
+  const char* key = portalConfig().channelKey;
+  const size_t len = strnlen(key, sizeof(NoctuaConfig::channelKey));
+  gKeyReady = len > 0;
+  if (!gKeyReady) return;
+
+  br_hmac_key_init(&gKey, &br_sha256_vtable, key, len);
+
+  // The receiver looks the channel up by key id; the key itself never travels.
+  br_sha256_context sha;
+  uint8_t digest[br_sha256_SIZE];
+  br_sha256_init(&sha);
+  br_sha256_update(&sha, key, len);
+  br_sha256_out(&sha, digest);
+
+  hbWireInit(gPacket, "NHB1", NOCTUA_HEARTBEAT_ACK ? 0x01 : 0x00, gNonce, digest);
+  hbWireInit(gGasp, "NLG1", 0, gNonce, digest);
+}
+
+static void onUdpRecv(void* arg, udp_pcb* pcb, pbuf* p, const ip_addr_t* addr, uint16_t port) {
+  (void)arg;
+  (void)pcb;
+  if (!p) return;
+
+  uint8_t buf[HB_ACK_LEN + 1];
+  const uint16_t n = pbuf_copy_partial(p, buf, sizeof(buf), 0);
+  pbuf_free(p);
+
+  if (!gBusy || gAcked || port != NOCTUA_HEARTBEAT_UDP_PORT || IPAddress(addr) != gDst) return;
+
+  if (!hbWireParseAck(buf, n, gNonce, gSeq, mac, gAck)) {
+    gStats.badAcks++;
+    return;
+  }
+  gAcked = true;
+}
+
+static bool ensurePcb() {
+  if (gPcb) return true;
+  gPcb = udp_new();
+  if (!gPcb) return false;
+  if (udp_bind(gPcb, IP_ADDR_ANY, 0) != ERR_OK) {
+    udp_remove(gPcb);
+    gPcb = nullptr;
+    return false;
+  }
+  udp_recv(gPcb, onUdpRecv, nullptr);
+  return true;
+}
+
+static bool sendDatagram(const uint8_t* data) {
+  pbuf* p = pbuf_alloc(PBUF_TRANSPORT, (uint16_t)HB_LEN, PBUF_RAM);
+  if (!p) return false;
+  memcpy(p->payload, data, HB_LEN);
+  const ip_addr_t dst = gDst;
+  const err_t err = udp_sendto(gPcb, p, &dst, NOCTUA_HEARTBEAT_UDP_PORT);
+  pbuf_free(p);
+  return err == ERR_OK;
+}
+
+static int ackHttpCode(uint8_t status) {
+  switch (status) {
+    case 0: return 200;
+    case 1: return 403;
+    case 2: return 429;
+    default: return 500;
+  }
+}
+
+static void finish(bool acked, ApiError err) {
+  gBusy = false;
+
+  PingTiming t;
+  for (uint8_t i = 0; i < LATENCY_PHASES; i++) t.us[i] = LATENCY_NONE;
+
+  PingReport r = {acked, 0, err, -1, -1, ""};
+  if (acked) {
+    const uint32_t us = micros() - gStartUs;
+    t.us[(uint8_t)LatencyPhase::Total] = us;
+    gStats.acks++;
+    gStats.lastRttMs = (int32_t)(us / 1000);
+    r.code = ackHttpCode(gAck.status);
+    r.intervalHintS = gAck.intervalS ? gAck.intervalS : -1;
+    r.retryAfterS = gAck.retryAfterS ? gAck.retryAfterS : -1;
+    if (gAck.status == 1) r.detail = "unknown channel key";
+  }
+  latencyRecord(t, r.code, false);
+  apiPingReport(r);
+}
+
+// ============================================================
+// Transport
+// ============================================================
+
+static void udpSetup() {
+  if (!gDst.fromString(NOCTUA_HEARTBEAT_UDP_HOST)) return;
+  // A fresh nonce per boot: seq restarts at 1 without looking like a replay.
+  gNonce = ESP.random();
+  loadKey();
+  // Opened up front: a last gasp has no time to set anything up.
+  (void)ensurePcb();
+}
+
+static void udpConfigChanged() { loadKey(); }
+
+static bool udpStart() {
+  if (!gKeyReady || !ensurePcb()) {
+    PingReport r = {false, 0, ApiError::WriteFailed, -1, -1, ""};
+    apiPingReport(r);
+    return false;
+  }
+
+  gSeq++;
+  hbWireSeal(gPacket, gSeq, millis() / 1000, mac);
+
+  gBusy = true;
+  gAcked = false;
+  hbRetxStart(gRetx, millis());
+  gStartUs = micros();
+  gStats.sent++;
+
+  if (!sendDatagram(gPacket)) {
+    finish(false, ApiError::WriteFailed);
+    return false;
+  }
+
+  if (!NOCTUA_HEARTBEAT_ACK) {
+    // Nothing to wait for: "accepted", delivery unknown.
+    gBusy = false;
+    PingReport r = {true, 202, ApiError::None, -1, -1, ""};
+    apiPingReport(r);
+  }
+  return true;
+}
+
+static void udpLoop() {
+  if (!gBusy) return;
+
+  if (gAcked) {
+    finish(true, ApiError::None);
+    return;
+  }
+
+  if (WiFi.status() != WL_CONNECTED) {
+    finish(false, ApiError::NoWiFi);
+    return;
+  }
+
+  switch (hbRetxPoll(gRetx, millis())) {
+    case HbRetxAction::Wait:
+      return;
+    case HbRetxAction::GiveUp:
+      finish(false, ApiError::ReadTimeout);
+      return;
+    case HbRetxAction::Resend:
+      gStats.retransmits++;
+      (void)sendDatagram(gPacket);
+      return;
+  }
+}
+
+static bool udpBusy() { return gBusy; }
+
+static void udpRelease() {}
+
+static const char* udpPhaseText() { return gBusy ? "ack" : "idle"; }
+
+const PingTransport UDP_PING_TRANSPORT = {
+  "udp",
+  udpSetup,
+  udpConfigChanged,
+  udpStart,
+  udpLoop,
+  udpBusy,
+  udpRelease,
+  udpPhaseText,
+};
+
+// ============================================================
+// Public API
+// ============================================================
+
+bool udpHeartbeatConfigured() {
+  IPAddress ip;
+  return ip.fromString(NOCTUA_HEARTBEAT_UDP_HOST);
+}
+
+bool udpHeartbeatLastGasp() {
+  if (!gKeyReady || !gPcb || WiFi.status() != WL_CONNECTED) return false;
+
+  // Only seq, uptime and the MAC are filled in here (HMAC of 26 bytes).
+  hbWireSeal(gGasp, gSeq, millis() / 1000, mac);
+
+  bool sent = false;
+  for (uint8_t i = 0; i < GASP_COPIES; i++) {
+    if (sendDatagram(gGasp)) sent = true;
+  }
+  if (sent) gStats.lastGasps++;
+  return sent;
+}
+
+void udpHeartbeatGetStats(UdpHeartbeatStats& out) { out = gStats; }
@@ -0,0 +1,183 @@
+//wifi_journal.cpp
+
+#include "wifi_journal.h"
+
+#include <ESP8266WiFi.h>
+#include <ESP.h>
+#include <LittleFS.h>
+
+#include "rtc_mem.h"
+
+// ============================================================
+// Tuning
+// ============================================================
+
+static const uint8_t JOURNAL_ENTRIES = 16;
+static const uint32_t JOURNAL_FLASH_EVERY_MS = 15UL * 60UL * 1000UL;  // 15 minutes
+
+static const char* JOURNAL_PATH = "/wifi_journal.bin";
+static const char* JOURNAL_TMP_PATH = "/wifi_journal.tmp";
+
+static const uint32_t JOURNAL_MAGIC = 0x4E574A31;  // 'NWJ1'
+
+// ============================================================
+// Storage image (same layout in RTC memory and on flash)
+// ============================================================
+
+struct JournalImage {
+  uint32_t magic;
+  uint16_t boot;
+  uint8_t head;   // index of the next slot to write
+  uint8_t count;
+  WifiJournalEntry entries[JOURNAL_ENTRIES];
+};
+
+static_assert(sizeof(WifiJournalEntry) == 12, "journal entry layout changed");
+static_assert(sizeof(JournalImage) <= RTC_WIFI_JOURNAL_BLOCKS * 4, "journal does not fit its RTC slot");
+
+static JournalImage gImg;
+static bool gReady = false;
+static bool gFlashDirty = false;
+static uint32_t gLastFlashMs = 0;
+
+// ============================================================
+// Internal helpers
+// ============================================================
+
+static bool imageValid(const JournalImage& img) {
+  return img.magic == JOURNAL_MAGIC && img.head < JOURNAL_ENTRIES && img.count <= JOURNAL_ENTRIES;
+}
+
+static void imageReset(JournalImage& img) {
+  memset(&img, 0, sizeof(img));
+  img.magic = JOURNAL_MAGIC;
+}
+
+static void rtcStore() {
+  (void)ESP.rtcUserMemoryWrite(RTC_BLOCK_WIFI_JOURNAL, (uint32_t*)&gImg, sizeof(gImg));
+}
+
+static bool rtcLoad(JournalImage& img) {
+  if (!ESP.rtcUserMemoryRead(RTC_BLOCK_WIFI_JOURNAL, (uint32_t*)&img, sizeof(img))) return false;
+  return imageValid(img);
+}
+
+static bool flashLoad(JournalImage& img) {
+  if (!LittleFS.exists(JOURNAL_PATH)) return false;
+
+  File f = LittleFS.open(JOURNAL_PATH, "r");
+  if (!f) return false;
+
+  const size_t n = f.read((uint8_t*)&img, sizeof(img));
+  f.close();
+  return n == sizeof(img) && imageValid(img);
+}
+
+static bool flashStore() {
+  // Runtime writes should never format flash. If mount fails, fail fast.
+  if (!LittleFS.begin()) return false;
+
+  // Write to a temp file and rename, so a power cut mid-write keeps the old copy.
+  File f = LittleFS.open(JOURNAL_TMP_PATH, "w");
+  if (!f) return false;
+  const size_t n = f.write((const uint8_t*)&gImg, sizeof(gImg));
+  f.close();
+
+  if (n != sizeof(gImg)) {
+    (void)LittleFS.remove(JOURNAL_TMP_PATH);
+    return false;
+  }
+
+  (void)LittleFS.remove(JOURNAL_PATH);
+  return LittleFS.rename(JOURNAL_TMP_PATH, JOURNAL_PATH);
+}
+
+// ============================================================
+// Public API
+// ============================================================
+
+void wifiJournalSetup() {
+  // Soft reset: RTC copy is the freshest. Power-on: fall back to flash.
+  if (!rtcLoad(gImg) && !flashLoad(gImg)) {
+    imageReset(gImg);
+  }
+
+  gImg.boot++;
+  gReady = true;
+
+  const rst_info* ri = ESP.getResetInfoPtr();
+  wifiJournalAdd(WifiJournalEvent::Boot, ri ? (uint8_t)ri->reason : 0xFF);
+
+  gLastFlashMs = millis();
+}
+
+void wifiJournalAdd(WifiJournalEvent ev, uint8_t arg, uint32_t value) {
+  if (!gReady) return;
+
+  // While the AP is gone, every retry ends with the same disconnect reason.
+  // Coalesce those into a repeat counter so an outage can't flush the history.
+  if (ev == WifiJournalEvent::Disconnect && gImg.count > 0) {
+    WifiJournalEntry& last = gImg.entries[(gImg.head + JOURNAL_ENTRIES - 1) % JOURNAL_ENTRIES];
+    if (last.type == (uint8_t)ev && last.arg == arg && last.boot == gImg.boot) {
+      if (last.value < 0xFFFF) last.value++;
+      rtcStore();
+      gFlashDirty = true;
+      return;
+    }
+  }
+
+  WifiJournalEntry& e = gImg.entries[gImg.head];
+  e.ms = millis();
+  e.boot = gImg.boot;
+  e.type = (uint8_t)ev;
+  e.arg = arg;
+  e.value = (value > 0xFFFF) ? 0xFFFF : (uint16_t)value;
+  e.rssi = (WiFi.status() == WL_CONNECTED) ? (int8_t)WiFi.RSSI() : 0;
+  e.reserved = 0;
+
+  gImg.head = (uint8_t)((gImg.head + 1) % JOURNAL_ENTRIES);
+  if (gImg.count < JOURNAL_ENTRIES) gImg.count++;
+
+  // RTC writes are cheap; keep it always current so a crash loses nothing.
+  rtcStore();
+  gFlashDirty = true;
+}
+
+void wifiJournalLoop() {
+  if (!gReady || !gFlashDirty) return;
+
+  const uint32_t now = millis();
+  if (now - gLastFlashMs < JOURNAL_FLASH_EVERY_MS) return;
+
+  gLastFlashMs = now;
+  if (flashStore()) {
+    gFlashDirty = false;
+  } else {
+    Serial.println("⚠️ [WiFiJournal] flash checkpoint failed");
+  }
+}
+
+uint8_t wifiJournalCount() { return gImg.count; }
+
+bool wifiJournalGet(uint8_t idx, WifiJournalEntry& out) {
+  if (idx >= gImg.count) return false;
+  const uint8_t oldest = (uint8_t)((gImg.head + JOURNAL_ENTRIES - gImg.count) % JOURNAL_ENTRIES);
+  out = gImg.entries[(oldest + idx) % JOURNAL_ENTRIES];
+  return true;
+}
+
+uint16_t wifiJournalBootSeq() { return gImg.boot; }
+
+const char* wifiJournalEventText(uint8_t type) {
+  switch ((WifiJournalEvent)type) {
+    case WifiJournalEvent::Boot: return "boot";
+    case WifiJournalEvent::Assoc: return "assoc";
+    case WifiJournalEvent::GotIp: return "got_ip";
+    case WifiJournalEvent::Disconnect: return "disconnect";
+    case WifiJournalEvent::DhcpKick: return "dhcp_kick";
+    case WifiJournalEvent::StaRestart: return "sta_restart";
+    case WifiJournalEvent::AutoApStart: return "auto_ap";
+    case WifiJournalEvent::CoexApMove: return "ap_move";
+    default: return "?";
+  }
+}
@@ -1,10 +1,15 @@
 //wifi_manager.cpp
 
 #include <ESP8266WiFi.h>
+#include <LittleFS.h>
 #include <user_interface.h>
 
+#include "wifi_manager.h"
+
 #include "io_ui.h"
 #include "noctua_portal.h"
+#include "power.h"
+#include "wifi_journal.h"
 
 // ============================================================
 // Tuning
@@ -17,6 +22,33 @@ static const uint8_t  AUTO_AP_AFTER_FAILS = 3;
 static const uint32_t AUTO_AP_KEEP_MS = 60000;
 static const uint32_t AUTO_AP_RECHECK_MS = AUTO_AP_KEEP_MS;
 
+// AP+STA coexistence: while a portal client is active, blind reconnects are
+// paused (each one drags the soft AP across channels). Instead we scan the AP's
+// own channel often (no hop) and all channels rarely.
+static const uint32_t COEX_SCAN_EVERY_MS = 15000;
+static const uint8_t  COEX_FULL_SCAN_EVERY = 4;  // every Nth scan covers all channels
+
+// Adaptive PHY mode / TX power.
+// Note: we can only measure downlink RSSI; the controller assumes the link is
+// roughly symmetric and keeps a generous margin before lowering TX power.
+static const uint32_t RADIO_TUNE_EVERY_MS = 30000;
+static const uint32_t RADIO_STABLE_MS = 5UL * 60UL * 1000UL;      // healthy this long before stepping down
+static const uint32_t RADIO_DROP_WINDOW_MS = 15UL * 60UL * 1000UL;
+static const uint8_t  RADIO_FALLBACK_DROPS = 3;                    // drops in window => 11b / max power
+static const uint32_t RADIO_FALLBACK_HOLD_MS = 30UL * 60UL * 1000UL;
+static const int8_t   RADIO_RSSI_GOOD = -60;   // step power down above this
+static const int8_t   RADIO_RSSI_WEAK = -72;   // step power up below this
+static const int8_t   RADIO_RSSI_11N_MIN = -75;  // below this prefer 11g
+static const float    RADIO_TX_MAX_DBM = 20.5f;
+static const float    RADIO_TX_MIN_DBM = 10.5f;
+static const float    RADIO_TX_STEP_DBM = 2.0f;
+
+// Last good channel/BSSID, so a cold boot can associate without a scan.
+static const uint32_t HINT_ASSOC_TIMEOUT_MS = 4000;  // then fall back to a scan
+static const char* HINT_PATH = "/wifi_hint.bin";
+static const char* HINT_TMP_PATH = "/wifi_hint.tmp";
+static const uint32_t HINT_MAGIC = 0x4E574831;  // 'NWH1'
+
 // ============================================================
 // Internal state
 // ============================================================
@@ -32,11 +64,43 @@ static bool gAutoApStarted = false;
 static uint32_t gAutoApStopDueMs = 0;
 
 // Station event tracking (for diagnostics + DHCP recovery)
+static volatile uint32_t gBeginMs = 0;
 static volatile uint32_t gStaConnectedMs = 0;
 static volatile uint8_t gStaConnectedCh = 0;
 static volatile uint32_t gGotIpMs = 0;
 static volatile bool gGotIp = false;
 
+// AP+STA coexistence
+static uint32_t gCoexLastScanMs = 0;
+static uint8_t gCoexScanCount = 0;
+static uint32_t gLinkLostMs = 0;
+static WifiCoexStats gCoex = {};
+
+// Radio tuning
+static WiFiPhyMode_t gPhyMode = WIFI_PHY_MODE_11N;
+static float gTxDbm = RADIO_TX_MAX_DBM;
+static int16_t gRssiEma = 0;                 // 0 = no sample yet
+static uint32_t gDropMs[RADIO_FALLBACK_DROPS] = {};
+static uint8_t gDropHead = 0;
+static uint32_t gFallbackUntilMs = 0;
+static uint32_t gRadioLastTuneMs = 0;
+static uint32_t gRadioLastChangeMs = 0;
+static uint32_t gRadioLastAccountMs = 0;
+static uint64_t gTxQdbmMsSum = 0;            // TX power in 0.25 dBm (SDK unit) x ms, for the average
+static WifiRadioStats gRadio = {};
+
+// Connect hint (flash copy + the one seen on the current link)
+struct WifiHint {
+  uint32_t magic;
+  uint32_t ssidHash;
+  uint8_t channel;
+  uint8_t bssid[6];
+  uint8_t reserved;
+};
+
+static WifiHint gHint = {};
+static volatile bool gHintDirty = false;
+
 // ============================================================
 // Internal helpers
 // ============================================================
@@ -44,10 +108,10 @@ static volatile bool gGotIp = false;
 static void wifiApplyDefaults() {
   WiFi.persistent(false);
   WiFi.setAutoReconnect(false);
-  WiFi.setSleepMode(WIFI_NONE_SLEEP);
 
-  // Disable power saving features that may cause connection drops
-  wifi_set_sleep_type(NONE_SLEEP_T);
+  // Sleep mode comes from the power profile. The default (Performance) keeps
+  // power saving off, since it may cause connection drops on some APs.
+  WiFi.setSleepMode(powerWifiSleepType(), powerWifiListenInterval());
 
   // Some routers pick channels 12/13 on 2.4GHz (common in EU).
   // Ensure the SDK allows channels 1-13 so STA can associate reliably.
@@ -62,6 +126,68 @@ static void wifiApplyDefaults() {
   (void)wifi_set_country(&c);
 }
 
+static uint32_t ssidHash(const char* s) {
+  // FNV-1a
+  uint32_t h = 2166136261UL;
+  while (s && *s) {
+    h ^= (uint8_t)*s++;
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+static void hintLoad() {
+  memset(&gHint, 0, sizeof(gHint));
+  if (!LittleFS.exists(HINT_PATH)) return;
+
+  File f = LittleFS.open(HINT_PATH, "r");
+  if (!f) return;
+  const size_t n = f.read((uint8_t*)&gHint, sizeof(gHint));
+  f.close();
+  if (n != sizeof(gHint) || gHint.magic != HINT_MAGIC) memset(&gHint, 0, sizeof(gHint));
+}
+
+static void hintStore() {
+  // Runtime writes should never format flash. If mount fails, skip.
+  if (!LittleFS.begin()) return;
+
+  // Write to a temp file and rename, so a power cut mid-write keeps the old hint.
+  File f = LittleFS.open(HINT_TMP_PATH, "w");
+  if (!f) return;
+  const size_t n = f.write((const uint8_t*)&gHint, sizeof(gHint));
+  f.close();
+
+  if (n != sizeof(gHint)) {
+    (void)LittleFS.remove(HINT_TMP_PATH);
+    return;
+  }
+
+  (void)LittleFS.remove(HINT_PATH);
+  (void)LittleFS.rename(HINT_TMP_PATH, HINT_PATH);
+}
+
+static bool hintUsable() {
+  return gHint.magic == HINT_MAGIC && gHint.channel >= 1 && gHint.channel <= 13 &&
+         gHint.ssidHash == ssidHash(portalConfig().wifiSsid);
+}
+
+// Called on GotIP: remember where we are; flash is written later from the loop.
+static void hintUpdateFromLink() {
+  const uint8_t ch = (uint8_t)WiFi.channel();
+  const uint8_t* bssid = WiFi.BSSID();
+  const uint32_t hash = ssidHash(portalConfig().wifiSsid);
+  if (!bssid || ch == 0) return;
+  if (gHint.magic == HINT_MAGIC && gHint.ssidHash == hash && gHint.channel == ch &&
+      memcmp(gHint.bssid, bssid, sizeof(gHint.bssid)) == 0) {
+    return;
+  }
+  gHint.magic = HINT_MAGIC;
+  gHint.ssidHash = hash;
+  gHint.channel = ch;
+  memcpy(gHint.bssid, bssid, sizeof(gHint.bssid));
+  gHintDirty = true;
+}
+
 static const char* wifiStatusText(wl_status_t st) {
   switch (st) {
     case WL_IDLE_STATUS: return "IDLE";
@@ -93,18 +219,238 @@ static void wifiDumpDiag(const char* tag) {
                 (unsigned)sdkSt);
 }
 
-static void wifiBeginFromConfig() {
+static uint8_t phyIndex(WiFiPhyMode_t m) {
+  return (m == WIFI_PHY_MODE_11B) ? 0 : (m == WIFI_PHY_MODE_11G) ? 1 : 2;
+}
+
+static bool radioInFallback() {
+  return gFallbackUntilMs != 0 && (int32_t)(millis() - gFallbackUntilMs) < 0;
+}
+
+// Counts recent link drops (ring holds the last RADIO_FALLBACK_DROPS).
+static uint8_t radioRecentDrops() {
+  const uint32_t now = millis();
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < RADIO_FALLBACK_DROPS; i++) {
+    if (gDropMs[i] != 0 && now - gDropMs[i] < RADIO_DROP_WINDOW_MS) n++;
+  }
+  return n;
+}
+
+static void radioSetTxPower(float dbm) {
+  if (dbm > RADIO_TX_MAX_DBM) dbm = RADIO_TX_MAX_DBM;
+  if (dbm < RADIO_TX_MIN_DBM) dbm = RADIO_TX_MIN_DBM;
+  if (dbm == gTxDbm) return;
+  gTxDbm = dbm;
+  gRadioLastChangeMs = millis();
+  WiFi.setOutputPower(gTxDbm);
+  Serial.printf("[WiFi][radio] tx=%.1fdBm rssi_ema=%d\n", gTxDbm, (int)gRssiEma);
+}
+
+// Picks PHY mode + TX power before a (re)connect. PHY changes force a
+// reassociation, so they are only applied here, never on a live link.
+static void radioApplyForConnect() {
+  WiFiPhyMode_t want = WIFI_PHY_MODE_11N;
+  if (radioRecentDrops() >= RADIO_FALLBACK_DROPS) {
+    if (!radioInFallback()) {
+      Serial.println("[WiFi][radio] repeated drops -> 11b / max power");
+      gRadio.fallbacks++;
+    }
+    gFallbackUntilMs = millis() + RADIO_FALLBACK_HOLD_MS;
+  }
+
+  if (radioInFallback()) {
+    want = WIFI_PHY_MODE_11B;
+    radioSetTxPower(RADIO_TX_MAX_DBM);
+  } else if (gRssiEma != 0 && gRssiEma < RADIO_RSSI_11N_MIN) {
+    want = WIFI_PHY_MODE_11G;
+  }
+
+  if (want != gPhyMode) {
+    gPhyMode = want;
+    gRadioLastChangeMs = millis();
+  }
+  WiFi.setPhyMode(gPhyMode);
+  WiFi.setOutputPower(gTxDbm);
+}
+
+// Time accounting for the stats (drops/hour per PHY mode, average TX power).
+static void radioAccount(uint32_t now, bool connected) {
+  const uint32_t dt = (gRadioLastAccountMs == 0) ? 0 : now - gRadioLastAccountMs;
+  gRadioLastAccountMs = now;
+  if (!connected || dt == 0) return;
+
+  gRadio.connectedMs[phyIndex(gPhyMode)] += dt;
+  gTxQdbmMsSum += (uint64_t)(uint32_t)(gTxDbm * 4.0f + 0.5f) * dt;
+}
+
+// Live TX power control (connected only).
+static void radioTuneLoop(uint32_t now) {
+  radioAccount(now, true);
+
+  if (gRadioLastTuneMs != 0 && now - gRadioLastTuneMs < RADIO_TUNE_EVERY_MS) return;
+  gRadioLastTuneMs = now;
+
+  const int32_t rssi = WiFi.RSSI();
+  if (rssi >= 0) return;  // invalid sample
+  gRssiEma = (gRssiEma == 0) ? (int16_t)rssi : (int16_t)((gRssiEma * 3 + rssi) / 4);
+
+  if (radioInFallback()) return;
+
+  if (gRssiEma < RADIO_RSSI_WEAK || radioRecentDrops() > 0) {
+    radioSetTxPower(gTxDbm + RADIO_TX_STEP_DBM);
+    return;
+  }
+
+  const bool stable = (now - gStaConnectedMs) > RADIO_STABLE_MS && (now - gRadioLastChangeMs) > RADIO_STABLE_MS;
+  if (stable && gRssiEma > RADIO_RSSI_GOOD) {
+    radioSetTxPower(gTxDbm - RADIO_TX_STEP_DBM);
+  }
+}
+
+// Channel/BSSID hints skip the SDK's own all-channel scan (which would
+// also drag a running soft AP across channels).
+static void wifiBeginFromConfig(int32_t channel = 0, const uint8_t* bssid = nullptr) {
   const auto& cfg = portalConfig();
 
   // Ensure we're in DHCP mode (clears any stale static config).
   WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0));
-  WiFi.begin(cfg.wifiSsid, cfg.wifiPass);
+  radioApplyForConnect();
+  gBeginMs = millis();
+  WiFi.begin(cfg.wifiSsid, cfg.wifiPass, channel, bssid);
+}
+
+// Never drop a running soft AP when (re)configuring the STA side.
+static WiFiMode_t wifiStaMode() {
+  return portalIsAPRunning() ? WIFI_AP_STA : WIFI_STA;
+}
+
+static void wifiRestartDhcp() {
+  wifiJournalAdd(WifiJournalEvent::DhcpKick);
+  wifi_station_dhcpc_stop();
+  delay(50);
+  wifi_station_dhcpc_start();
+}
+
+static void wifiRestartSta(const char* diagTag) {
+  wifiJournalAdd(WifiJournalEvent::StaRestart);
+  wifiDumpDiag(diagTag);
+
+  WiFi.disconnect(false);
+  delay(150);
+  if (!portalIsAPRunning()) {
+    // Full radio cycle only when no portal client can be kicked off by it.
+    WiFi.mode(WIFI_OFF);
+    delay(250);
+  }
+  wifiApplyDefaults();
+  WiFi.mode(wifiStaMode());
+  delay(150);
+  wifiBeginFromConfig();
+}
+
+// Applies a finished async scan: if the configured SSID was found, pin the
+// soft AP to its channel first, then associate directly on that channel.
+// Returns true if an attempt was started.
+static bool wifiCoexTakeScan(int8_t n) {
+  const char* ssid = portalConfig().wifiSsid;
+
+  int best = -1;
+  int32_t bestRssi = -1000;
+  for (int i = 0; i < n; i++) {
+    if (WiFi.SSID(i) != ssid) continue;
+    const int32_t rssi = WiFi.RSSI(i);
+    if (rssi > bestRssi) {
+      best = i;
+      bestRssi = rssi;
+    }
+  }
+
+  if (best < 0) {
+    WiFi.scanDelete();
+    return false;
+  }
+
+  const uint8_t ch = (uint8_t)WiFi.channel(best);
+  uint8_t bssid[6];
+  memcpy(bssid, WiFi.BSSID(best), sizeof(bssid));
+  WiFi.scanDelete();
+
+  Serial.printf("[WiFi][coex] target found ch=%u rssi=%d\n", (unsigned)ch, (int)bestRssi);
+
+  // Move both radios together: AP first (clients follow), then STA.
+  if (portalSetApChannel(ch)) {
+    gCoex.apMoves++;
+    wifiJournalAdd(WifiJournalEvent::CoexApMove, ch);
+  }
+
+  const uint32_t now = millis();
+  gLastAttemptMs = now;
+  gAttemptStartMs = now;
+  gAttempting = true;
+
+  WiFi.disconnect(false);
+  delay(50);
+  ioSetStaBlinkEnabled(true);
+  wifiBeginFromConfig(ch, bssid);
+  gCoex.targetedAttempts++;
+  return true;
+}
+
+// Coexistence scheduler for AP+STA mode. Returns true if the regular blind
+// retry must be skipped this iteration.
+static bool wifiCoexLoop(uint32_t now) {
+  const int8_t n = WiFi.scanComplete();
+  if (n == WIFI_SCAN_RUNNING) return true;
+  if (n >= 0) return wifiCoexTakeScan(n) || portalHasActiveClient();
+
+  // Nobody on the portal: regular retries are harmless.
+  if (!portalHasActiveClient()) return false;
+
+  if (gCoexLastScanMs == 0 || now - gCoexLastScanMs >= COEX_SCAN_EVERY_MS) {
+    gCoexLastScanMs = now;
+    gCoexScanCount++;
+
+    // Scanning only the AP's own channel doesn't hop, so clients stay put.
+    const bool full = (gCoexScanCount % COEX_FULL_SCAN_EVERY) == 0 || portalApChannel() == 0;
+    (void)WiFi.scanNetworks(true, false, full ? 0 : portalApChannel());
+    if (full) gCoex.fullScans++;
+    else gCoex.channelScans++;
+    return true;
+  }
+
+  if (now - gLastAttemptMs >= WIFI_RETRY_EVERY_MS) {
+    // A blind retry would have happened here.
+    gLastAttemptMs = now;
+    gCoex.pausedRetries++;
+  }
+  return true;
 }
 
 // ============================================================
 // Public API
 // ============================================================
 
+const char* wifiDisconnectReasonText(uint8_t reason) {
+  // Map common disconnect reasons (not exhaustive).
+  switch (reason) {
+    case 2: return "AUTH_EXPIRE";
+    case 4: return "ASSOC_EXPIRE";
+    case 5: return "ASSOC_TOOMANY";
+    case 6: return "NOT_AUTHED";
+    case 7: return "NOT_ASSOCED";
+    case 8: return "ASSOC_LEAVE";
+    case 11: return "BEACON_TIMEOUT";
+    case 13: return "NO_AP_FOUND";
+    case 15: return "HANDSHAKE_TIMEOUT";
+    case 201: return "NO_AP_FOUND"; // some cores use 201+
+    case 202: return "AUTH_FAIL";
+    case 203: return "ASSOC_FAIL";
+    case 204: return "HANDSHAKE_TIMEOUT";
+    default: return "?";
+  }
+}
+
 void wifiManagerSuspend(bool en) {
   gSuspend = en;
 
@@ -122,56 +468,65 @@ void wifiManagerSetup() {
   // Intentionally do not force WIFI_STA here.
   // The main loop / portal may temporarily use WIFI_AP_STA.
 
+  hintLoad();
+
   // Register event handlers once for better diagnostics.
   static WiFiEventHandler onDisconnected;
   static WiFiEventHandler onGotIp;
   static WiFiEventHandler onConnected;
-
-  // Map common disconnect reasons (not exhaustive).
-  auto reasonText = [](uint8_t r) -> const char* {
-    switch (r) {
-      case 2: return "AUTH_EXPIRE";
-      case 4: return "ASSOC_EXPIRE";
-      case 5: return "ASSOC_TOOMANY";
-      case 6: return "NOT_AUTHED";
-      case 7: return "NOT_ASSOCED";
-      case 8: return "ASSOC_LEAVE";
-      case 11: return "BEACON_TIMEOUT";
-      case 13: return "NO_AP_FOUND";
-      case 15: return "HANDSHAKE_TIMEOUT";
-      case 201: return "NO_AP_FOUND"; // some cores use 201+
-      case 202: return "AUTH_FAIL";
-      case 203: return "ASSOC_FAIL";
-      case 204: return "HANDSHAKE_TIMEOUT";
-      default: return "?";
-    }
-  };
+  static WiFiEventHandler onApStaDisconnected;
 
   onConnected = WiFi.onStationModeConnected([](const WiFiEventStationModeConnected& evt) {
     gStaConnectedMs = millis();
     gStaConnectedCh = evt.channel;
     gGotIp = false;
+    // Pin the portal AP to the last known STA channel (single radio).
+    (void)portalSetApChannel(evt.channel);
+    wifiJournalAdd(WifiJournalEvent::Assoc, evt.channel, gStaConnectedMs - gBeginMs);
     Serial.printf("[WiFi] connected to '%s' ch=%u\n", evt.ssid.c_str(), (unsigned)evt.channel);
   });
 
   onGotIp = WiFi.onStationModeGotIP([](const WiFiEventStationModeGotIP& evt) {
     gGotIp = true;
     gGotIpMs = millis();
+    wifiJournalAdd(WifiJournalEvent::GotIp, 0, gGotIpMs - gStaConnectedMs);
+    if (gLinkLostMs != 0 && portalIsAPRunning()) {
+      // Reconnect completed while running AP+STA.
+      const uint32_t dt = gGotIpMs - gLinkLostMs;
+      gCoex.reconnects++;
+      gCoex.lastReconnectMs = dt;
+      if (dt > gCoex.maxReconnectMs) gCoex.maxReconnectMs = dt;
+    }
+    gLinkLostMs = 0;
+    hintUpdateFromLink();
     Serial.printf("[WiFi] got IP: %s gw=%s\n",
                   evt.ip.toString().c_str(),
                   evt.gw.toString().c_str());
   });
 
-  onDisconnected = WiFi.onStationModeDisconnected([reasonText](const WiFiEventStationModeDisconnected& evt) {
+  onDisconnected = WiFi.onStationModeDisconnected([](const WiFiEventStationModeDisconnected& evt) {
+    if (gGotIp && gLinkLostMs == 0) gLinkLostMs = millis();
+    if (gGotIp && evt.reason != 8) {
+      // Link drop we didn't cause (8 = ASSOC_LEAVE, our own disconnect).
+      gDropMs[gDropHead] = millis();
+      gDropHead = (uint8_t)((gDropHead + 1) % RADIO_FALLBACK_DROPS);
+      gRadio.drops[phyIndex(gPhyMode)]++;
+    }
     gGotIp = false;
+    wifiJournalAdd(WifiJournalEvent::Disconnect, evt.reason);
     Serial.printf("[WiFi] disconnected from '%s' reason=%u(%s)\n",
                   evt.ssid.c_str(),
                   (unsigned)evt.reason,
-                  reasonText(evt.reason));
+                  wifiDisconnectReasonText(evt.reason));
+  });
+
+  // Portal stability: count phones dropping off the soft AP.
+  onApStaDisconnected = WiFi.onSoftAPModeStationDisconnected([](const WiFiEventSoftAPModeStationDisconnected&) {
+    gCoex.apClientDrops++;
   });
 }
 
-bool wifiConnectOnce(uint32_t timeoutMs) {
+bool wifiConnectOnce(uint32_t timeoutMs, bool fast) {
   if (!portalHasStaConfig()) {
     Serial.println("WiFi config invalid: missing SSID");
     return false;
@@ -180,19 +535,41 @@ bool wifiConnectOnce(uint32_t timeoutMs) {
   wifiApplyDefaults();
 
   WiFi.mode(WIFI_STA);
-  // Do not erase config on disconnect; just drop the link.
-  WiFi.disconnect(false);
-  delay(50);
-  yield();
+  if (!fast) {
+    // Do not erase config on disconnect; just drop the link.
+    WiFi.disconnect(false);
+    delay(50);
+    yield();
+  }
 
   ioSetStaBlinkEnabled(true);
-  wifiBeginFromConfig();
+  bool hinted = hintUsable();
+  if (hinted) {
+    Serial.printf("[WiFi] using last channel %u\n", (unsigned)gHint.channel);
+    wifiBeginFromConfig(gHint.channel, gHint.bssid);
+  } else {
+    wifiBeginFromConfig();
+  }
 
   bool dhcpRestarted = false;
   bool staRestarted = false;
 
+  // Power-on: every poll step is added to the "power is back" latency.
+  const uint32_t pollMs = fast ? 10 : 100;
+
   const uint32_t t0 = millis();
   while (WiFi.status() != WL_CONNECTED && (millis() - t0) < timeoutMs) {
+    // The remembered AP is gone (moved channel / replaced): scan normally.
+    const bool assocSeen = gStaConnectedMs != 0 && gStaConnectedMs >= t0;
+    if (hinted && !assocSeen &&
+        (WiFi.status() == WL_NO_SSID_AVAIL || (millis() - t0) > HINT_ASSOC_TIMEOUT_MS)) {
+      hinted = false;
+      Serial.println("[WiFi] last channel/BSSID failed -> full scan");
+      WiFi.disconnect(false);
+      delay(50);
+      wifiBeginFromConfig();
+    }
+
     // Allow the user to force AP mode immediately while we're connecting.
     // This avoids being stuck until timeout during boot/connect attempts.
     if (ioBootPressedOnce()) {
@@ -208,9 +585,7 @@ bool wifiConnectOnce(uint32_t timeoutMs) {
     if (!dhcpRestarted && assocMs != 0 && assocMs >= t0 && !gGotIp && (millis() - assocMs) > 7000) {
       dhcpRestarted = true;
       Serial.println("[WiFi] assoc but no IP -> restart DHCP");
-      wifi_station_dhcpc_stop();
-      delay(50);
-      wifi_station_dhcpc_start();
+      wifiRestartDhcp();
     }
 
     // Escalation: if DHCP still doesn't complete, restart STA stack once.
@@ -218,19 +593,10 @@ bool wifiConnectOnce(uint32_t timeoutMs) {
     if (dhcpRestarted && !staRestarted && assocMs != 0 && assocMs >= t0 && !gGotIp && (millis() - assocMs) > 15000) {
       staRestarted = true;
       Serial.println("[WiFi] assoc but still no IP -> restart STA stack");
-      wifiDumpDiag("sta_restart_before");
-
-      WiFi.disconnect(false);
-      delay(150);
-      WiFi.mode(WIFI_OFF);
-      delay(250);
-      wifiApplyDefaults();
-      WiFi.mode(WIFI_STA);
-      delay(150);
-      wifiBeginFromConfig();
+      wifiRestartSta("sta_restart_before");
     }
 
-    delay(100);
+    delay(pollMs);
     yield();
     portalLoop();  // keep HTTP/DNS responsive while connecting
   }
@@ -265,10 +631,16 @@ void wifiManagerLoop() {
 
   // Connected => clear state
   if (wifiIsConnected()) {
+    if (gHintDirty) {
+      gHintDirty = false;
+      hintStore();
+    }
     gAttempting = false;
     gConsecutiveFails = 0;
     ioSetStaBlinkEnabled(false);
 
+    radioTuneLoop(millis());
+
     // If AP was started automatically due to repeated reconnect failures,
     // keep it for a short window after STA comes back, then shut it down.
     if (gAutoApStarted && portalIsAPRunning()) {
@@ -295,6 +667,7 @@ void wifiManagerLoop() {
   gAutoApStopDueMs = 0;
 
   const uint32_t now = millis();
+  radioAccount(now, false);
 
   // If an attempt is in progress, wait up to WIFI_RETRY_TIMEOUT_MS
   if (gAttempting) {
@@ -322,24 +695,13 @@ void wifiManagerLoop() {
     if (!dhcpKickedThisAttempt && assocMs != 0 && assocMs >= gAttemptStartMs && !gGotIp && (now - assocMs) > 7000) {
       dhcpKickedThisAttempt = true;
       Serial.println("[WiFi] (bg) assoc but no IP -> restart DHCP");
-      wifi_station_dhcpc_stop();
-      delay(50);
-      wifi_station_dhcpc_start();
+      wifiRestartDhcp();
     }
 
     if (dhcpKickedThisAttempt && !staRestartedThisAttempt && assocMs != 0 && assocMs >= gAttemptStartMs && !gGotIp && (now - assocMs) > 15000) {
       staRestartedThisAttempt = true;
       Serial.println("[WiFi] (bg) assoc but still no IP -> restart STA stack");
-      wifiDumpDiag("bg_sta_restart_before");
-
-      WiFi.disconnect(false);
-      delay(150);
-      WiFi.mode(WIFI_OFF);
-      delay(250);
-      wifiApplyDefaults();
-      WiFi.mode(WIFI_STA);
-      delay(150);
-      wifiBeginFromConfig();
+      wifiRestartSta("bg_sta_restart_before");
     }
 
     if (now - gAttemptStartMs > WIFI_RETRY_TIMEOUT_MS) {
@@ -351,7 +713,9 @@ void wifiManagerLoop() {
       if (gConsecutiveFails < 255) gConsecutiveFails++;
       if (gConsecutiveFails >= AUTO_AP_AFTER_FAILS) {
         if (!portalIsAPRunning()) {
+          if (gLinkLostMs == 0) gLinkLostMs = now;
           Serial.println("⚠️ WiFi reconnect failed multiple times -> starting AP");
+          wifiJournalAdd(WifiJournalEvent::AutoApStart, gConsecutiveFails);
           portalStartAP();
           gAutoApStarted = true;
         }
@@ -360,6 +724,9 @@ void wifiManagerLoop() {
     return;
   }
 
+  // AP+STA: let the coexistence scheduler decide whether to retry blindly.
+  if (portalIsAPRunning() && wifiCoexLoop(now)) return;
+
   // Start a new attempt every WIFI_RETRY_EVERY_MS
   if (now - gLastAttemptMs < WIFI_RETRY_EVERY_MS) return;
 
@@ -372,9 +739,24 @@ void wifiManagerLoop() {
   Serial.println("WiFi reconnect attempt...");
   WiFi.disconnect(false);
   delay(100);
-  WiFi.mode(WIFI_STA);
+  WiFi.mode(wifiStaMode());
   delay(50);
   
   ioSetStaBlinkEnabled(true);
   wifiBeginFromConfig();
 }
+
+void wifiCoexGetStats(WifiCoexStats& out) {
+  out = gCoex;
+}
+
+void wifiRadioGetStats(WifiRadioStats& out) {
+  out = gRadio;
+  out.phyMode = (gPhyMode == WIFI_PHY_MODE_11B) ? 'b' : (gPhyMode == WIFI_PHY_MODE_11G) ? 'g' : 'n';
+  out.txDbmX10 = (uint16_t)(gTxDbm * 10.0f + 0.5f);
+  out.rssiEma = gRssiEma;
+
+  const uint64_t totalMs = gRadio.connectedMs[0] + gRadio.connectedMs[1] + gRadio.connectedMs[2];
+  out.avgTxDbmX10 = (totalMs > 0) ? (uint16_t)((gTxQdbmMsSum * 10 + totalMs * 2) / (totalMs * 4)) : out.txDbmX10;
+  out.fallback = radioInFallback();
+}
@@ -0,0 +1,98 @@
+//Arduino.h
+#pragma once
+
+// Host stand-in for the few Arduino core calls the natively tested modules
+// make (env:native only). Tests drive the clock with fakeMillisSet() and
+// fakeMillisAdvance(), and the GPIOs with fakePinWrite(), which also runs
+// the attached interrupt handler like the hardware would.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define IRAM_ATTR
+
+#define LOW 0
+#define HIGH 1
+
+#define INPUT 0x00
+#define INPUT_PULLUP 0x02
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+// ============================================================
+// Clock
+// ============================================================
+
+inline uint32_t& fakeMillisRef() {
+  static uint32_t ms = 0;
+  return ms;
+}
+
+inline void fakeMillisSet(uint32_t ms) { fakeMillisRef() = ms; }
+inline void fakeMillisAdvance(uint32_t ms) { fakeMillisRef() += ms; }
+
+inline uint32_t millis() { return fakeMillisRef(); }
+
+// ============================================================
+// GPIO
+// ============================================================
+
+struct FakePin {
+  int level;
+  uint8_t mode;
+  void (*isr)(void*);
+  void* arg;
+  int edge;
+};
+
+static const uint8_t FAKE_PIN_COUNT = 17;
+
+inline FakePin* fakePins() {
+  static FakePin pins[FAKE_PIN_COUNT] = {};
+  return pins;
+}
+
+inline void pinMode(uint8_t pin, uint8_t mode) { fakePins()[pin].mode = mode; }
+
+inline int digitalRead(uint8_t pin) { return fakePins()[pin].level; }
+
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+
+inline void attachInterruptArg(uint8_t irq, void (*fn)(void*), void* arg, int edge) {
+  FakePin& p = fakePins()[irq];
+  p.isr = fn;
+  p.arg = arg;
+  p.edge = edge;
+}
+
+// Drives the pin; an edge that matches the attached mode runs the handler.
+inline void fakePinWrite(uint8_t pin, int level) {
+  FakePin& p = fakePins()[pin];
+  const int old = p.level;
+  p.level = level;
+  if (!p.isr || old == level) return;
+  const bool rising = level == HIGH;
+  if (p.edge == CHANGE || (p.edge == RISING && rising) || (p.edge == FALLING && !rising)) {
+    p.isr(p.arg);
+  }
+}
+
+// Detaches everything and sets all pins to `level` (no interrupts).
+inline void fakePinsReset(int level) {
+  for (uint8_t i = 0; i < FAKE_PIN_COUNT; i++) fakePins()[i] = FakePin{level, 0, nullptr, nullptr, 0};
+}
+
+// ============================================================
+// Serial
+// ============================================================
+
+// Output is dropped: tests check state, not logs.
+struct FakeSerial {
+  int printf(const char*, ...) { return 0; }
+  void println(const char*) {}
+};
+
+inline FakeSerial Serial;
@@ -0,0 +1,23 @@
+//ESP.h
+#pragma once
+
+#include <Arduino.h>
+
+// Host stand-in for the ESP object: the chip id is settable and random()
+// is a seeded xorshift, so a test run is reproducible.
+class EspClass {
+ public:
+  uint32_t chipId = 0x00C0FFEE;
+  uint32_t seed = 1;
+
+  uint32_t getChipId() { return chipId; }
+
+  uint32_t random() {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+  }
+};
+
+inline EspClass ESP;
@@ -0,0 +1,137 @@
+//hmac_sha256.h
+#pragma once
+
+// Plain SHA-256 / HMAC-SHA-256 for host tests (the firmware uses BearSSL).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+struct TestSha256 {
+  uint32_t h[8];
+  uint8_t buf[64];
+  size_t bufLen;
+  uint64_t total;
+};
+
+inline uint32_t testSha256Rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+inline void testSha256Block(TestSha256& s, const uint8_t* p) {
+  static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+  };
+  uint32_t w[64];
+  for (int i = 0; i < 16; i++) {
+    w[i] = ((uint32_t)p[4 * i] << 24) | ((uint32_t)p[4 * i + 1] << 16) |
+           ((uint32_t)p[4 * i + 2] << 8) | p[4 * i + 3];
+  }
+  for (int i = 16; i < 64; i++) {
+    const uint32_t s0 = testSha256Rotr(w[i - 15], 7) ^ testSha256Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    const uint32_t s1 = testSha256Rotr(w[i - 2], 17) ^ testSha256Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t a = s.h[0], b = s.h[1], c = s.h[2], d = s.h[3];
+  uint32_t e = s.h[4], f = s.h[5], g = s.h[6], h = s.h[7];
+  for (int i = 0; i < 64; i++) {
+    const uint32_t t1 = h + (testSha256Rotr(e, 6) ^ testSha256Rotr(e, 11) ^ testSha256Rotr(e, 25)) +
+                        ((e & f) ^ (~e & g)) + K[i] + w[i];
+    const uint32_t t2 = (testSha256Rotr(a, 2) ^ testSha256Rotr(a, 13) ^ testSha256Rotr(a, 22)) +
+                        ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  s.h[0] += a;
+  s.h[1] += b;
+  s.h[2] += c;
+  s.h[3] += d;
+  s.h[4] += e;
+  s.h[5] += f;
+  s.h[6] += g;
+  s.h[7] += h;
+}
+
+inline void testSha256Init(TestSha256& s) {
+  static const uint32_t IV[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+  memcpy(s.h, IV, sizeof(IV));
+  s.bufLen = 0;
+  s.total = 0;
+}
+
+inline void testSha256Update(TestSha256& s, const void* data, size_t len) {
+  const uint8_t* p = (const uint8_t*)data;
+  s.total += len;
+  while (len) {
+    const size_t n = (64 - s.bufLen < len) ? 64 - s.bufLen : len;
+    memcpy(s.buf + s.bufLen, p, n);
+    s.bufLen += n;
+    p += n;
+    len -= n;
+    if (s.bufLen == 64) {
+      testSha256Block(s, s.buf);
+      s.bufLen = 0;
+    }
+  }
+}
+
+inline void testSha256Out(TestSha256& s, uint8_t out[32]) {
+  const uint64_t bits = s.total * 8;
+  const uint8_t pad = 0x80;
+  const uint8_t zero = 0;
+  testSha256Update(s, &pad, 1);
+  while (s.bufLen != 56) testSha256Update(s, &zero, 1);
+  uint8_t len[8];
+  for (int i = 0; i < 8; i++) len[i] = (uint8_t)(bits >> (56 - 8 * i));
+  testSha256Update(s, len, 8);
+  for (int i = 0; i < 8; i++) {
+    out[4 * i] = (uint8_t)(s.h[i] >> 24);
+    out[4 * i + 1] = (uint8_t)(s.h[i] >> 16);
+    out[4 * i + 2] = (uint8_t)(s.h[i] >> 8);
+    out[4 * i + 3] = (uint8_t)s.h[i];
+  }
+}
+
+inline void testSha256(const void* data, size_t len, uint8_t out[32]) {
+  TestSha256 s;
+  testSha256Init(s);
+  testSha256Update(s, data, len);
+  testSha256Out(s, out);
+}
+
+inline void testHmacSha256(const void* key, size_t keyLen, const void* data, size_t len,
+                           uint8_t out[32]) {
+  uint8_t k[64] = {0};
+  if (keyLen > 64) {
+    testSha256(key, keyLen, k);
+  } else {
+    memcpy(k, key, keyLen);
+  }
+
+  uint8_t pad[64];
+  uint8_t inner[32];
+  TestSha256 s;
+  for (int i = 0; i < 64; i++) pad[i] = (uint8_t)(k[i] ^ 0x36);
+  testSha256Init(s);
+  testSha256Update(s, pad, 64);
+  testSha256Update(s, data, len);
+  testSha256Out(s, inner);
+
+  for (int i = 0; i < 64; i++) pad[i] = (uint8_t)(k[i] ^ 0x5c);
+  testSha256Init(s);
+  testSha256Update(s, pad, 64);
+  testSha256Update(s, inner, 32);
+  testSha256Out(s, out);
+}
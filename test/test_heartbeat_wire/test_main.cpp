@@ -0,0 +1,187 @@
+//test_main.cpp
+// UDP heartbeat wire format against vectors from tools/heartbeat_receiver.py:
+// heartbeat/last-gasp layout and MAC, ack checks (MAC, nonce, seq, length)
+// and the retransmit schedule.
+
+#include <hmac_sha256.h>
+#include <string.h>
+#include <unity.h>
+
+#include "heartbeat_wire.h"
+
+static const char KEY[] = "test-channel-key";
+static const uint32_t NONCE = 0x12345678;
+
+// build_ack()/heartbeat from the receiver script: key KEY, nonce NONCE,
+// seq 7, uptime 3600 s; ack status 2, interval 300 s, Retry-After 120 s.
+static const char HEARTBEAT_HEX[] =
+    "4e4842310100123456780000000700000e10624e64b968bf17cc66645cf274180e7fbd653a3c54c9fb85";
+static const char ACK_HEX[] =
+    "4e48413102001234567800000007012c007869850dfb037cec649adfa39e05057000";
+
+// ============================================================
+// Helpers
+// ============================================================
+
+static void keyMac(const uint8_t* data, size_t len, uint8_t* out) {
+  uint8_t full[32];
+  testHmacSha256(KEY, strlen(KEY), data, len, full);
+  memcpy(out, full, HB_MAC_LEN);
+}
+
+static void otherKeyMac(const uint8_t* data, size_t len, uint8_t* out) {
+  uint8_t full[32];
+  testHmacSha256("other-key", 9, data, len, full);
+  memcpy(out, full, HB_MAC_LEN);
+}
+
+static size_t fromHex(const char* hex, uint8_t* out) {
+  size_t n = 0;
+  for (; hex[0] && hex[1]; hex += 2) {
+    auto nib = [](char c) { return (uint8_t)(c <= '9' ? c - '0' : c - 'a' + 10); };
+    out[n++] = (uint8_t)((nib(hex[0]) << 4) | nib(hex[1]));
+  }
+  return n;
+}
+
+static void keyId(uint8_t* out) {
+  uint8_t digest[32];
+  testSha256(KEY, strlen(KEY), digest);
+  memcpy(out, digest, HB_KEY_ID_LEN);
+}
+
+static void golden(const char* hex, uint8_t* buf, size_t expectLen) {
+  TEST_ASSERT_EQUAL_UINT32(expectLen, fromHex(hex, buf));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+// ============================================================
+// Tests
+// ============================================================
+
+static void test_hmac_sha256_rfc4231() {
+  // RFC 4231 test case 2.
+  static const uint8_t EXPECT[32] = {
+    0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e, 0x6a, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xc7,
+    0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83, 0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43,
+  };
+  uint8_t out[32];
+  testHmacSha256("Jefe", 4, "what do ya want for nothing?", 28, out);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(EXPECT, out, 32);
+}
+
+static void test_heartbeat_matches_receiver() {
+  uint8_t expect[HB_LEN];
+  golden(HEARTBEAT_HEX, expect, HB_LEN);
+
+  uint8_t id[HB_KEY_ID_LEN];
+  keyId(id);
+  uint8_t pkt[HB_LEN];
+  hbWireInit(pkt, "NHB1", 0x01, NONCE, id);
+  hbWireSeal(pkt, 7, 3600, keyMac);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expect, pkt, HB_LEN);
+
+  // Resealing with the next seq changes seq, uptime and the MAC only.
+  hbWireSeal(pkt, 8, 3690, keyMac);
+  TEST_ASSERT_EQUAL_MEMORY(expect, pkt, 10);
+  TEST_ASSERT_EQUAL_MEMORY(&expect[18], &pkt[18], HB_KEY_ID_LEN);
+  TEST_ASSERT_EQUAL_UINT8(8, pkt[13]);
+  TEST_ASSERT_FALSE(memcmp(&expect[HB_MAC_AT], &pkt[HB_MAC_AT], HB_MAC_LEN) == 0);
+}
+
+static void test_last_gasp_layout() {
+  uint8_t id[HB_KEY_ID_LEN];
+  keyId(id);
+  uint8_t hb[HB_LEN];
+  uint8_t gasp[HB_LEN];
+  hbWireInit(hb, "NHB1", 0x01, NONCE, id);
+  hbWireInit(gasp, "NLG1", 0, NONCE, id);
+  hbWireSeal(hb, 7, 3600, keyMac);
+  hbWireSeal(gasp, 7, 3600, keyMac);
+
+  TEST_ASSERT_EQUAL_MEMORY("NLG1", gasp, 4);
+  TEST_ASSERT_EQUAL_UINT8(0, gasp[4]);
+  TEST_ASSERT_EQUAL_MEMORY(&hb[5], &gasp[5], HB_MAC_AT - 5);
+
+  uint8_t mac[HB_MAC_LEN];
+  keyMac(gasp, HB_MAC_AT, mac);
+  TEST_ASSERT_EQUAL_MEMORY(mac, &gasp[HB_MAC_AT], HB_MAC_LEN);
+}
+
+static void test_ack_accepted() {
+  uint8_t ack[HB_ACK_LEN];
+  golden(ACK_HEX, ack, HB_ACK_LEN);
+
+  HbAck out = {};
+  TEST_ASSERT_TRUE(hbWireParseAck(ack, HB_ACK_LEN, NONCE, 7, keyMac, out));
+  TEST_ASSERT_EQUAL_UINT8(2, out.status);
+  TEST_ASSERT_EQUAL_UINT16(300, out.intervalS);
+  TEST_ASSERT_EQUAL_UINT16(120, out.retryAfterS);
+}
+
+static void test_ack_rejected() {
+  uint8_t ack[HB_ACK_LEN + 1];
+  golden(ACK_HEX, ack, HB_ACK_LEN);
+  ack[HB_ACK_LEN] = 0;
+  HbAck out = {};
+
+  // Not ours: another boot, another heartbeat, another key.
+  TEST_ASSERT_FALSE(hbWireParseAck(ack, HB_ACK_LEN, NONCE + 1, 7, keyMac, out));
+  TEST_ASSERT_FALSE(hbWireParseAck(ack, HB_ACK_LEN, NONCE, 6, keyMac, out));
+  TEST_ASSERT_FALSE(hbWireParseAck(ack, HB_ACK_LEN, NONCE, 8, keyMac, out));
+  TEST_ASSERT_FALSE(hbWireParseAck(ack, HB_ACK_LEN, NONCE, 7, otherKeyMac, out));
+
+  // Truncated / padded.
+  TEST_ASSERT_FALSE(hbWireParseAck(ack, HB_ACK_LEN - 1, NONCE, 7, keyMac, out));
+  TEST_ASSERT_FALSE(hbWireParseAck(ack, HB_ACK_LEN + 1, NONCE, 7, keyMac, out));
+
+  // Any bit flipped in the signed part or the MAC.
+  for (size_t i = 0; i < HB_ACK_LEN; i++) {
+    ack[i] ^= 0x01;
+    TEST_ASSERT_FALSE(hbWireParseAck(ack, HB_ACK_LEN, NONCE, 7, keyMac, out));
+    ack[i] ^= 0x01;
+  }
+
+  // The unsigned "unknown key" reply of a receiver that lacks the key.
+  memset(&ack[HB_ACK_MAC_AT], 0, HB_MAC_LEN);
+  ack[4] = 1;
+  TEST_ASSERT_FALSE(hbWireParseAck(ack, HB_ACK_LEN, NONCE, 7, keyMac, out));
+}
+
+static void test_retransmit_schedule() {
+  static const uint32_t STARTS[] = {1000, 0xFFFFFF00};  // also across the millis() wrap
+
+  for (const uint32_t t0 : STARTS) {
+    HbRetransmit r;
+    hbRetxStart(r, t0);
+    TEST_ASSERT_EQUAL(HbRetxAction::Wait, hbRetxPoll(r, t0 + 599));
+    TEST_ASSERT_EQUAL(HbRetxAction::Resend, hbRetxPoll(r, t0 + 600));
+    TEST_ASSERT_EQUAL(HbRetxAction::Wait, hbRetxPoll(r, t0 + 1799));
+    TEST_ASSERT_EQUAL(HbRetxAction::Resend, hbRetxPoll(r, t0 + 1800));
+    TEST_ASSERT_EQUAL_UINT8(HB_MAX_SENDS, r.sends);
+    TEST_ASSERT_EQUAL(HbRetxAction::Wait, hbRetxPoll(r, t0 + 4199));
+    TEST_ASSERT_EQUAL(HbRetxAction::GiveUp, hbRetxPoll(r, t0 + 4200));
+    TEST_ASSERT_EQUAL_UINT8(HB_MAX_SENDS, r.sends);
+  }
+
+  // A late loop pass resends once and restarts the wait from then.
+  HbRetransmit r;
+  hbRetxStart(r, 0);
+  TEST_ASSERT_EQUAL(HbRetxAction::Resend, hbRetxPoll(r, 5000));
+  TEST_ASSERT_EQUAL(HbRetxAction::Wait, hbRetxPoll(r, 6199));
+  TEST_ASSERT_EQUAL(HbRetxAction::Resend, hbRetxPoll(r, 6200));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_hmac_sha256_rfc4231);
+  RUN_TEST(test_heartbeat_matches_receiver);
+  RUN_TEST(test_last_gasp_layout);
+  RUN_TEST(test_ack_accepted);
+  RUN_TEST(test_ack_rejected);
+  RUN_TEST(test_retransmit_schedule);
+  return UNITY_END();
+}
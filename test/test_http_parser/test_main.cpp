@@ -0,0 +1,170 @@
+//test_main.cpp
+// HttpResponseParser against recorded responses, fed in 1-byte, 3-byte and
+// whole-buffer pieces (the socket may split a response anywhere).
+
+#include <string.h>
+#include <unity.h>
+
+#include "http_parser.h"
+
+// ============================================================
+// Recorded responses
+// ============================================================
+
+static const char OK_WITH_NEXT[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/plain\r\n"
+    "content-length: 2\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n"
+    "ok"
+    "HTTP/1.1 200 OK\r\n";  // next response on the same connection
+
+static const char CHUNKED[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Transfer-Encoding: gzip, chunked\r\n"
+    "Content-Length: 999\r\n"
+    "\r\n"
+    "5;name=value\r\n"
+    "hello\r\n"
+    "7\r\n"
+    ", world\r\n"
+    "0\r\n"
+    "X-Checksum: abc\r\n"
+    "\r\n";
+
+static const char THROTTLED[] =
+    "HTTP/1.1 429 Too Many Requests\r\n"
+    "Retry-After: 120\r\n"
+    "Content-Length: 4\r\n"
+    "\r\n"
+    "slow";
+
+static const char INTERVAL_HINT[] =
+    "HTTP/1.1 200 OK\r\n"
+    "X-Ping-Interval:   300\r\n"
+    "Content-Length: 0\r\n"
+    "\r\n";
+
+static const char HTTP10_UNFRAMED[] =
+    "HTTP/1.0 200 OK\r\n"
+    "Server: legacy\r\n"
+    "\r\n"
+    "body until close";
+
+static const size_t STEPS[] = {1, 3, 0};  // 0 = whole buffer
+
+// ============================================================
+// Helpers
+// ============================================================
+
+static HttpResponseParser gParser;
+static char gBody[64];
+
+// Feeds text in pieces of `step` bytes until the parser stops; returns the
+// number of bytes it consumed.
+static size_t feedInSteps(const char* text, size_t step) {
+  const size_t len = strlen(text);
+  gParser.reset(gBody, sizeof(gBody));
+  size_t used = 0;
+  while (used < len && !gParser.done() && !gParser.failed()) {
+    size_t n = step ? step : len;
+    if (n > len - used) n = len - used;
+    const size_t took = gParser.feed((const uint8_t*)text + used, n);
+    used += took;
+    if (took < n) break;
+  }
+  return used;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// ============================================================
+// Tests
+// ============================================================
+
+static void test_content_length_leaves_next_response() {
+  for (size_t step : STEPS) {
+    const size_t used = feedInSteps(OK_WITH_NEXT, step);
+    TEST_ASSERT_TRUE(gParser.done());
+    TEST_ASSERT_EQUAL_INT(200, gParser.statusCode());
+    TEST_ASSERT_EQUAL_INT32(2, gParser.contentLength());
+    TEST_ASSERT_TRUE(gParser.framed());
+    TEST_ASSERT_FALSE(gParser.connectionClose());
+    TEST_ASSERT_EQUAL_STRING("ok", gBody);
+    // The pipelined status line is not consumed.
+    TEST_ASSERT_EQUAL_size_t(strlen(OK_WITH_NEXT) - strlen("HTTP/1.1 200 OK\r\n"), used);
+  }
+}
+
+static void test_chunked_with_extensions_and_trailers() {
+  for (size_t step : STEPS) {
+    const size_t used = feedInSteps(CHUNKED, step);
+    TEST_ASSERT_TRUE(gParser.done());
+    TEST_ASSERT_TRUE(gParser.chunked());
+    TEST_ASSERT_EQUAL_INT32(-1, gParser.contentLength());  // chunked wins
+    TEST_ASSERT_EQUAL_STRING("hello, world", gBody);
+    TEST_ASSERT_EQUAL_UINT32(12, gParser.bodyBytes());
+    TEST_ASSERT_EQUAL_size_t(strlen(CHUNKED), used);
+  }
+}
+
+static void test_429_with_retry_after() {
+  for (size_t step : STEPS) {
+    feedInSteps(THROTTLED, step);
+    TEST_ASSERT_TRUE(gParser.done());
+    TEST_ASSERT_EQUAL_INT(429, gParser.statusCode());
+    TEST_ASSERT_EQUAL_INT32(120, gParser.retryAfterS());
+    TEST_ASSERT_EQUAL_INT32(-1, gParser.intervalHintS());
+    TEST_ASSERT_EQUAL_STRING("slow", gBody);
+  }
+}
+
+static void test_ping_interval_hint() {
+  for (size_t step : STEPS) {
+    feedInSteps(INTERVAL_HINT, step);
+    TEST_ASSERT_TRUE(gParser.done());
+    TEST_ASSERT_EQUAL_INT32(300, gParser.intervalHintS());
+    TEST_ASSERT_EQUAL_INT32(-1, gParser.retryAfterS());
+    TEST_ASSERT_EQUAL_UINT32(0, gParser.bodyBytes());
+  }
+}
+
+static void test_http10_unframed_body_ends_at_eof() {
+  for (size_t step : STEPS) {
+    const size_t used = feedInSteps(HTTP10_UNFRAMED, step);
+    TEST_ASSERT_EQUAL_size_t(strlen(HTTP10_UNFRAMED), used);
+    TEST_ASSERT_FALSE(gParser.done());  // only the close ends it
+    TEST_ASSERT_FALSE(gParser.framed());
+    TEST_ASSERT_TRUE(gParser.connectionClose());
+
+    gParser.finishEof();
+    TEST_ASSERT_TRUE(gParser.done());
+    TEST_ASSERT_EQUAL_STRING("body until close", gBody);
+  }
+}
+
+static void test_eof_inside_framed_body_is_an_error() {
+  const char truncated[] = "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nabc";
+  feedInSteps(truncated, 0);
+  gParser.finishEof();
+  TEST_ASSERT_TRUE(gParser.failed());
+}
+
+static void test_garbage_status_line_fails() {
+  feedInSteps("SSH-2.0-OpenSSH\r\n", 1);
+  TEST_ASSERT_TRUE(gParser.failed());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_content_length_leaves_next_response);
+  RUN_TEST(test_chunked_with_extensions_and_trailers);
+  RUN_TEST(test_429_with_retry_after);
+  RUN_TEST(test_ping_interval_hint);
+  RUN_TEST(test_http10_unframed_body_ends_at_eof);
+  RUN_TEST(test_eof_inside_framed_body_is_an_error);
+  RUN_TEST(test_garbage_status_line_fails);
+  return UNITY_END();
+}
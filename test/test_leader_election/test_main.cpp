@@ -0,0 +1,257 @@
+//test_main.cpp
+// LAN leader election with three units on a simulated multicast bus and
+// clock: one leader, takeover when it dies, the incumbent keeps its role,
+// hand-over on a failing supply, and recorded hellos that go stale.
+
+#include <hmac_sha256.h>
+#include <string.h>
+#include <unity.h>
+
+#include "leader_election.h"
+
+static const uint8_t UNITS = 3;
+static const uint32_t IDS[UNITS] = {0x10, 0x20, 0x30};  // unit 0 wins a fair election
+static const uint32_t STEP_MS = 100;
+
+static LeaderElection gUnits[UNITS];
+static bool gUp[UNITS];
+static bool gCanLead[UNITS];
+static uint32_t gNow;
+static uint32_t gRandom;
+
+// One datagram in flight at a time: each send is delivered before the next.
+static uint8_t gLastHello[UNITS][LEADER_HELLO_LEN];
+static uint8_t gSender;
+
+// ============================================================
+// Helpers
+// ============================================================
+
+static void keyMac(const uint8_t* data, size_t len, uint8_t* out) {
+  uint8_t full[32];
+  testHmacSha256("channel-key", 11, data, len, full);
+  memcpy(out, full, LEADER_MAC_LEN);
+}
+
+static uint32_t xorshift() {
+  gRandom ^= gRandom << 13;
+  gRandom ^= gRandom >> 17;
+  gRandom ^= gRandom << 5;
+  return gRandom;
+}
+
+static bool busSend(const uint8_t* pkt, size_t len) {
+  memcpy(gLastHello[gSender], pkt, len);
+  for (uint8_t i = 0; i < UNITS; i++) {
+    if (gUp[i]) leaderRecv(gUnits[i], pkt, len, gNow);
+  }
+  return true;
+}
+
+static void start(uint8_t i) {
+  gUp[i] = true;
+  leaderStart(gUnits[i], gNow);
+}
+
+static void runFor(uint32_t ms) {
+  for (uint32_t t = 0; t < ms; t += STEP_MS) {
+    gNow += STEP_MS;
+    for (uint8_t i = 0; i < UNITS; i++) {
+      if (!gUp[i]) continue;
+      gSender = i;
+      leaderLoop(gUnits[i], gNow, gCanLead[i]);
+    }
+  }
+}
+
+// Runs until unit i leads; returns the time it took (or `limit`).
+static uint32_t runUntilLeader(uint8_t i, uint32_t limit) {
+  uint32_t t = 0;
+  while (t < limit && gUnits[i].role != LeaderRole::Leader) {
+    runFor(STEP_MS);
+    t += STEP_MS;
+  }
+  return t;
+}
+
+static uint8_t leaders() {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < UNITS; i++) {
+    if (gUp[i] && gUnits[i].role == LeaderRole::Leader) n++;
+  }
+  return n;
+}
+
+static void replay(uint8_t from, uint8_t to) {
+  leaderRecv(gUnits[to], gLastHello[from], LEADER_HELLO_LEN, gNow);
+}
+
+void setUp() {
+  gNow = 0xFFFF0000;  // crosses the millis() wrap during the longer tests
+  gRandom = 0x2545F491;
+  for (uint8_t i = 0; i < UNITS; i++) {
+    leaderInit(gUnits[i], IDS[i], 0xB0070000 + i, keyMac, busSend, xorshift);
+    memset(gUnits[i].groupId, 0x5A, LEADER_GROUP_ID_LEN);
+    gUp[i] = false;
+    gCanLead[i] = true;
+  }
+}
+
+void tearDown() {}
+
+// ============================================================
+// Tests
+// ============================================================
+
+static void test_single_leader() {
+  for (uint8_t i = 0; i < UNITS; i++) start(i);
+  runFor(LEADER_LISTEN_MS + 1000);
+
+  TEST_ASSERT_EQUAL(LeaderRole::Leader, gUnits[0].role);
+  TEST_ASSERT_EQUAL(LeaderRole::Follower, gUnits[1].role);
+  TEST_ASSERT_EQUAL(LeaderRole::Follower, gUnits[2].role);
+  TEST_ASSERT_EQUAL_UINT32(IDS[0], gUnits[2].leaderId);
+  TEST_ASSERT_FALSE(leaderTakeTakeover(gUnits[0]));  // elected, not a takeover
+
+  // Stays that way over many hellos.
+  runFor(10 * LEADER_HELLO_MS);
+  TEST_ASSERT_EQUAL_UINT8(1, leaders());
+  TEST_ASSERT_EQUAL(LeaderRole::Leader, gUnits[0].role);
+  TEST_ASSERT_EQUAL_UINT32(1, gUnits[0].elections);
+  for (uint8_t i = 0; i < UNITS; i++) {
+    TEST_ASSERT_EQUAL_UINT8(UNITS - 1, gUnits[i].livePeers);
+    TEST_ASSERT_EQUAL_UINT32(0, gUnits[i].rejected);
+  }
+  TEST_ASSERT_FALSE(leaderSkipPing(gUnits[0], gNow));
+  TEST_ASSERT_TRUE(leaderSkipPing(gUnits[1], gNow));
+}
+
+static void test_follower_takes_over_within_live_ms() {
+  for (uint8_t i = 0; i < UNITS; i++) start(i);
+  runFor(LEADER_LISTEN_MS + 2 * LEADER_HELLO_MS);
+  TEST_ASSERT_EQUAL(LeaderRole::Leader, gUnits[0].role);
+
+  // The leader dies right after a hello.
+  const uint32_t sent = gUnits[0].sent;
+  while (gUnits[0].sent == sent) runFor(STEP_MS);
+  gUp[0] = false;
+
+  // Followers keep skipping for a while: two lost hellos are not a failover.
+  runFor(2 * LEADER_HELLO_MS);
+  TEST_ASSERT_TRUE(leaderSkipPing(gUnits[1], gNow));
+
+  const uint32_t took = 2 * LEADER_HELLO_MS + runUntilLeader(1, LEADER_LIVE_MS);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(LEADER_LIVE_MS, took);
+  TEST_ASSERT_TRUE(leaderTakeTakeover(gUnits[1]));
+  TEST_ASSERT_FALSE(leaderTakeTakeover(gUnits[1]));
+
+  runFor(1000);
+  TEST_ASSERT_EQUAL(LeaderRole::Follower, gUnits[2].role);
+  TEST_ASSERT_EQUAL_UINT32(IDS[1], gUnits[2].leaderId);
+  TEST_ASSERT_TRUE(leaderSkipPing(gUnits[2], gNow));
+}
+
+static void test_incumbent_keeps_role() {
+  start(1);
+  start(2);
+  runFor(LEADER_LISTEN_MS + 1000);
+  TEST_ASSERT_EQUAL(LeaderRole::Leader, gUnits[1].role);
+
+  // A better unit boots later: it follows instead of taking over.
+  start(0);
+  runFor(1000);
+  TEST_ASSERT_EQUAL(LeaderRole::Follower, gUnits[0].role);
+  TEST_ASSERT_EQUAL_UINT32(IDS[1], gUnits[0].leaderId);
+
+  runFor(10 * LEADER_HELLO_MS);
+  TEST_ASSERT_EQUAL(LeaderRole::Leader, gUnits[1].role);
+  TEST_ASSERT_EQUAL(LeaderRole::Follower, gUnits[0].role);
+  TEST_ASSERT_EQUAL_UINT32(1, gUnits[1].elections);
+  TEST_ASSERT_EQUAL_UINT32(0, gUnits[0].elections);
+}
+
+static void test_failing_supply_hands_over() {
+  for (uint8_t i = 0; i < UNITS; i++) start(i);
+  runFor(LEADER_LISTEN_MS + 2 * LEADER_HELLO_MS);
+  TEST_ASSERT_EQUAL(LeaderRole::Leader, gUnits[0].role);
+
+  gCanLead[0] = false;
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(STEP_MS, runUntilLeader(1, LEADER_HELLO_MS));
+  TEST_ASSERT_EQUAL(LeaderRole::Follower, gUnits[0].role);
+  TEST_ASSERT_TRUE(leaderTakeTakeover(gUnits[1]));
+
+  // The unhealthy unit does not win it back while its supply fails.
+  runFor(5 * LEADER_HELLO_MS);
+  TEST_ASSERT_EQUAL(LeaderRole::Leader, gUnits[1].role);
+  TEST_ASSERT_EQUAL_UINT8(1, leaders());
+
+  // Supply back: it follows the incumbent like a newcomer would.
+  gCanLead[0] = true;
+  runFor(5 * LEADER_HELLO_MS);
+  TEST_ASSERT_EQUAL(LeaderRole::Follower, gUnits[0].role);
+  TEST_ASSERT_EQUAL(LeaderRole::Leader, gUnits[1].role);
+}
+
+static void test_recorded_hello_goes_stale() {
+  for (uint8_t i = 0; i < UNITS; i++) start(i);
+  runFor(LEADER_LISTEN_MS + 2 * LEADER_HELLO_MS);
+  gUp[0] = false;
+
+  // Replaying the dead leader's last hello every second does not keep it
+  // alive: it echoes challenges that age out.
+  uint32_t t = 0;
+  while (t < LEADER_LIVE_MS + LEADER_HELLO_MS && gUnits[1].role != LeaderRole::Leader) {
+    replay(0, 1);
+    replay(0, 2);
+    runFor(1000);
+    t += 1000;
+  }
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(LEADER_LIVE_MS + 1000, t);
+  TEST_ASSERT_EQUAL(LeaderRole::Leader, gUnits[1].role);
+  // Same boot, same seq: counted as a replay while its challenge is live.
+  TEST_ASSERT_GREATER_THAN_UINT32(0, gUnits[1].rejected);
+
+  // A unit that rejoins (Wi-Fi back) does not follow the recording either.
+  start(2);
+  replay(0, 2);
+  runFor(1000);
+  TEST_ASSERT_EQUAL(LeaderRole::Follower, gUnits[2].role);
+  TEST_ASSERT_EQUAL_UINT32(IDS[1], gUnits[2].leaderId);
+}
+
+static void test_old_boot_hello_is_not_fresh() {
+  start(0);
+  runFor(LEADER_LISTEN_MS + 1000);
+  uint8_t oldBoot[LEADER_HELLO_LEN];
+  memcpy(oldBoot, gLastHello[0], sizeof(oldBoot));
+
+  // Unit 0 reboots with a new nonce and comes back much later; unit 1 has
+  // never heard the old boot.
+  leaderInit(gUnits[0], IDS[0], 0xB0071000, keyMac, busSend, xorshift);
+  memset(gUnits[0].groupId, 0x5A, LEADER_GROUP_ID_LEN);
+  gUp[0] = false;
+  runFor(LEADER_LIVE_MS);
+
+  start(1);
+  leaderRecv(gUnits[1], oldBoot, sizeof(oldBoot), gNow);
+  runFor(LEADER_LISTEN_MS + 1000);
+  TEST_ASSERT_EQUAL(LeaderRole::Leader, gUnits[1].role);
+  TEST_ASSERT_EQUAL_UINT8(0, gUnits[1].livePeers);
+
+  // A tampered hello is rejected outright.
+  oldBoot[4] ^= 0x02;
+  const uint32_t rejected = gUnits[1].rejected;
+  leaderRecv(gUnits[1], oldBoot, sizeof(oldBoot), gNow);
+  TEST_ASSERT_EQUAL_UINT32(rejected + 1, gUnits[1].rejected);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_single_leader);
+  RUN_TEST(test_follower_takes_over_within_live_ms);
+  RUN_TEST(test_incumbent_keeps_role);
+  RUN_TEST(test_failing_supply_hands_over);
+  RUN_TEST(test_recorded_hello_goes_stale);
+  RUN_TEST(test_old_boot_hello_is_not_fresh);
+  return UNITY_END();
+}
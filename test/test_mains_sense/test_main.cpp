@@ -0,0 +1,194 @@
+//test_main.cpp
+// Mains sense, level mode, on simulated pins: the ISR -> loop ring, debounce,
+// resync after a queue overflow and the pin -> channel key slot mapping.
+
+#include <unity.h>
+
+// GPIO5 -> slot 0, slot 1 unused, GPIO4 -> slot 2; GPIO16 has no interrupt;
+// GPIO12 would be slot 4, beyond the 3 extra keys.
+#define NOCTUA_MAINS_SENSE_PINS 5, -1, 4, 16, 12
+#define NOCTUA_MAINS_SENSE_ZERO_CROSS 0
+#define NOCTUA_MAINS_SENSE_ACTIVE_LOW 1
+#define NOCTUA_MAINS_SENSE_DEBOUNCE_MS 100
+#define NOCTUA_EXTRA_CHANNEL_KEYS 3
+
+// The pin list is a build flag: the module is compiled here with this one.
+#include "../../src/mains_sense.cpp"
+
+static const uint8_t PIN_A = 5;
+static const uint8_t PIN_B = 4;
+
+// ============================================================
+// Helpers
+// ============================================================
+
+// Active low: the optocoupler pulls the pin down while there is power.
+static void power(uint8_t pin, bool on) { fakePinWrite(pin, on ? LOW : HIGH); }
+
+static void runFor(uint32_t ms, uint32_t stepMs = 10) {
+  for (uint32_t t = 0; t < ms; t += stepMs) {
+    fakeMillisAdvance(stepMs);
+    mainsSenseLoop();
+  }
+}
+
+static uint8_t takeAll(MainsEvent* out, uint8_t cap) {
+  uint8_t n = 0;
+  MainsEvent e;
+  while (mainsSenseTakeEvent(e)) {
+    if (n < cap) out[n] = e;
+    n++;
+  }
+  return n;
+}
+
+void setUp() {
+  fakeMillisAdvance(1000);
+  fakePinsReset(HIGH);  // no power on any circuit
+  mainsSenseSetup();
+  mainsSenseLoop();     // drains edges left by the previous test
+  runFor(100);
+
+  // The first known state counts as an event.
+  MainsEvent ev[4];
+  TEST_ASSERT_EQUAL_UINT8(2, takeAll(ev, 4));
+  TEST_ASSERT_FALSE(ev[0].powered);
+  TEST_ASSERT_FALSE(ev[1].powered);
+}
+
+void tearDown() {}
+
+// ============================================================
+// Tests
+// ============================================================
+
+static void test_pins_map_to_fixed_slots() {
+  TEST_ASSERT_EQUAL_UINT8(2, mainsSenseInputs());
+
+  MainsInputStatus s;
+  TEST_ASSERT_TRUE(mainsSenseGet(0, s));
+  TEST_ASSERT_EQUAL_UINT8(PIN_A, s.pin);
+  TEST_ASSERT_EQUAL_UINT8(0, s.slot);
+  TEST_ASSERT_EQUAL_UINT8(INPUT_PULLUP, fakePins()[PIN_A].mode);
+
+  TEST_ASSERT_TRUE(mainsSenseGet(1, s));
+  TEST_ASSERT_EQUAL_UINT8(PIN_B, s.pin);
+  TEST_ASSERT_EQUAL_UINT8(2, s.slot);  // not compacted to 1
+
+  TEST_ASSERT_FALSE(mainsSenseGet(2, s));
+  TEST_ASSERT_NULL(fakePins()[12].isr);
+  TEST_ASSERT_NULL(fakePins()[16].isr);
+}
+
+static void test_change_after_debounce() {
+  const uint32_t t0 = millis();
+  power(PIN_B, true);
+
+  runFor(90);
+  MainsEvent ev[2];
+  TEST_ASSERT_EQUAL_UINT8(0, takeAll(ev, 2));
+
+  runFor(10);
+  TEST_ASSERT_EQUAL_UINT8(1, takeAll(ev, 2));
+  TEST_ASSERT_EQUAL_UINT8(1, ev[0].input);
+  TEST_ASSERT_EQUAL_UINT8(2, ev[0].slot);
+  TEST_ASSERT_TRUE(ev[0].powered);
+  TEST_ASSERT_EQUAL_UINT32(t0, ev[0].atMs);  // stamped in the ISR
+
+  MainsInputStatus s;
+  mainsSenseGet(1, s);
+  TEST_ASSERT_TRUE(s.powered);
+  TEST_ASSERT_EQUAL_UINT32(1, s.changes);
+}
+
+static void test_glitch_is_ignored() {
+  power(PIN_A, true);
+  fakeMillisAdvance(30);
+  power(PIN_A, false);
+  runFor(300);
+
+  MainsEvent ev[2];
+  TEST_ASSERT_EQUAL_UINT8(0, takeAll(ev, 2));
+  MainsInputStatus s;
+  mainsSenseGet(0, s);
+  TEST_ASSERT_FALSE(s.powered);
+  TEST_ASSERT_EQUAL_UINT32(0, s.changes);
+}
+
+static void test_bounce_settles_on_last_edge() {
+  // Contact bounce: the state counts from the last edge.
+  power(PIN_A, true);
+  fakeMillisAdvance(5);
+  power(PIN_A, false);
+  fakeMillisAdvance(5);
+  power(PIN_A, true);
+  const uint32_t settled = millis();
+
+  runFor(200);
+  MainsEvent ev[2];
+  TEST_ASSERT_EQUAL_UINT8(1, takeAll(ev, 2));
+  TEST_ASSERT_TRUE(ev[0].powered);
+  TEST_ASSERT_EQUAL_UINT32(settled, ev[0].atMs);
+}
+
+static void test_ring_keeps_inputs_apart() {
+  // Interleaved edges of both inputs between two loop passes.
+  const uint32_t t0 = millis();
+  power(PIN_A, true);
+  fakeMillisAdvance(1);
+  power(PIN_B, true);
+  fakeMillisAdvance(1);
+  power(PIN_A, false);
+  fakeMillisAdvance(1);
+  power(PIN_A, true);
+
+  runFor(200);
+  MainsEvent ev[3];
+  TEST_ASSERT_EQUAL_UINT8(2, takeAll(ev, 3));
+  TEST_ASSERT_EQUAL_UINT8(0, ev[0].input);
+  TEST_ASSERT_EQUAL_UINT32(t0 + 3, ev[0].atMs);
+  TEST_ASSERT_EQUAL_UINT8(1, ev[1].input);
+  TEST_ASSERT_EQUAL_UINT32(t0 + 1, ev[1].atMs);
+}
+
+static void test_overflow_resyncs_from_pin() {
+  const uint32_t dropped = mainsSenseDropped();
+
+  // 42 edges without a loop pass: the ring holds QUEUE_SIZE - 1. Input A's
+  // queued edges end on "no power" (its start state), the pin on "power".
+  power(PIN_B, true);
+  for (uint8_t i = 0; i < 41; i++) {
+    power(PIN_A, (i & 1) == 0);
+    fakeMillisAdvance(1);
+  }
+  const uint32_t lost = 42 - (QUEUE_SIZE - 1);
+  TEST_ASSERT_EQUAL_UINT32(dropped + lost, mainsSenseDropped());
+  TEST_ASSERT_EQUAL_INT(LOW, digitalRead(PIN_A));
+
+  // The pin wins over the stale queue.
+  runFor(200);
+  MainsEvent ev[3];
+  TEST_ASSERT_EQUAL_UINT8(2, takeAll(ev, 3));
+  TEST_ASSERT_EQUAL_UINT8(0, ev[0].input);
+  TEST_ASSERT_TRUE(ev[0].powered);
+  TEST_ASSERT_EQUAL_UINT8(1, ev[1].input);
+  TEST_ASSERT_TRUE(ev[1].powered);
+
+  // The ring is usable again.
+  power(PIN_A, false);
+  runFor(200);
+  TEST_ASSERT_EQUAL_UINT8(1, takeAll(ev, 3));
+  TEST_ASSERT_FALSE(ev[0].powered);
+  TEST_ASSERT_EQUAL_UINT32(dropped + lost, mainsSenseDropped());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_pins_map_to_fixed_slots);
+  RUN_TEST(test_change_after_debounce);
+  RUN_TEST(test_glitch_is_ignored);
+  RUN_TEST(test_bounce_settles_on_last_edge);
+  RUN_TEST(test_ring_keeps_inputs_apart);
+  RUN_TEST(test_overflow_resyncs_from_pin);
+  return UNITY_END();
+}
@@ -0,0 +1,139 @@
+//test_main.cpp
+// Mains sense, zero-cross mode, on a simulated 50 Hz detector: one queued
+// edge per pulse train, loss of pulses = loss of power, short dropouts and
+// blips filtered.
+
+#include <unity.h>
+
+#define NOCTUA_MAINS_SENSE_PINS 5
+#define NOCTUA_MAINS_SENSE_ZERO_CROSS 1
+#define NOCTUA_MAINS_SENSE_DEBOUNCE_MS 100
+#define NOCTUA_EXTRA_CHANNEL_KEYS 3
+
+// The pin list is a build flag: the module is compiled here with this one.
+#include "../../src/mains_sense.cpp"
+
+static const uint8_t PIN = 5;
+static const uint32_t HALF_CYCLE_MS = 10;
+
+// ============================================================
+// Helpers
+// ============================================================
+
+// Detector pulses (rising edges) at 100 Hz for `ms`, with the main loop
+// running every millisecond in between.
+static void pulsesFor(uint32_t ms) {
+  for (uint32_t t = 0; t < ms; t++) {
+    if (t % HALF_CYCLE_MS == 0) {
+      fakePinWrite(PIN, HIGH);
+      fakePinWrite(PIN, LOW);
+    }
+    fakeMillisAdvance(1);
+    mainsSenseLoop();
+  }
+}
+
+static void quietFor(uint32_t ms) {
+  for (uint32_t t = 0; t < ms; t++) {
+    fakeMillisAdvance(1);
+    mainsSenseLoop();
+  }
+}
+
+static uint8_t takeAll(MainsEvent* out, uint8_t cap) {
+  uint8_t n = 0;
+  MainsEvent e;
+  while (mainsSenseTakeEvent(e)) {
+    if (n < cap) out[n] = e;
+    n++;
+  }
+  return n;
+}
+
+void setUp() {
+  fakeMillisAdvance(1000);
+  fakePinsReset(LOW);
+  mainsSenseSetup();
+  mainsSenseLoop();
+  quietFor(100);
+
+  MainsEvent ev[2];
+  TEST_ASSERT_EQUAL_UINT8(1, takeAll(ev, 2));
+  TEST_ASSERT_FALSE(ev[0].powered);
+}
+
+void tearDown() {}
+
+// ============================================================
+// Tests
+// ============================================================
+
+static void test_pulse_train_is_one_edge() {
+  TEST_ASSERT_EQUAL(RISING, fakePins()[PIN].edge);
+
+  const uint32_t t0 = millis();
+  const uint32_t dropped = mainsSenseDropped();
+  // 100 pulses without a loop pass would overflow the ring if each were queued.
+  for (uint8_t i = 0; i < 100; i++) {
+    fakePinWrite(PIN, HIGH);
+    fakePinWrite(PIN, LOW);
+    fakeMillisAdvance(HALF_CYCLE_MS);
+  }
+  TEST_ASSERT_EQUAL_UINT32(dropped, mainsSenseDropped());
+  TEST_ASSERT_EQUAL_UINT8(1, (uint8_t)((gHead - gTail) & QUEUE_MASK));
+
+  pulsesFor(50);
+  MainsEvent ev[2];
+  TEST_ASSERT_EQUAL_UINT8(1, takeAll(ev, 2));
+  TEST_ASSERT_TRUE(ev[0].powered);
+  TEST_ASSERT_EQUAL_UINT32(t0, ev[0].atMs);
+}
+
+static void test_loss_of_pulses_is_loss_of_power() {
+  pulsesFor(300);
+  MainsEvent ev[2];
+  TEST_ASSERT_EQUAL_UINT8(1, takeAll(ev, 2));
+  TEST_ASSERT_TRUE(ev[0].powered);
+
+  const uint32_t lastPulse = millis() - HALF_CYCLE_MS;
+  quietFor(150);
+  TEST_ASSERT_EQUAL_UINT8(1, takeAll(ev, 2));
+  TEST_ASSERT_FALSE(ev[0].powered);
+  TEST_ASSERT_EQUAL_UINT32(lastPulse, ev[0].atMs);  // right after the last pulse
+
+  MainsInputStatus s;
+  mainsSenseGet(0, s);
+  TEST_ASSERT_EQUAL_UINT32(2, s.changes);
+}
+
+static void test_missing_pulses_are_not_an_outage() {
+  pulsesFor(300);
+  MainsEvent ev[2];
+  TEST_ASSERT_EQUAL_UINT8(1, takeAll(ev, 2));
+
+  // A 50 ms gap (4 pulses missing) stays under ZC_ABSENT_MS.
+  quietFor(ZC_ABSENT_MS - 2 * HALF_CYCLE_MS);
+  pulsesFor(300);
+  TEST_ASSERT_EQUAL_UINT8(0, takeAll(ev, 2));
+}
+
+static void test_blip_is_ignored() {
+  // Power for 50 ms only: shorter than the debounce.
+  pulsesFor(50);
+  quietFor(300);
+
+  MainsEvent ev[2];
+  TEST_ASSERT_EQUAL_UINT8(0, takeAll(ev, 2));
+  MainsInputStatus s;
+  mainsSenseGet(0, s);
+  TEST_ASSERT_FALSE(s.powered);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_pulse_train_is_one_edge);
+  RUN_TEST(test_loss_of_pulses_is_loss_of_power);
+  RUN_TEST(test_missing_pulses_are_not_an_outage);
+  RUN_TEST(test_blip_is_ignored);
+  return UNITY_END();
+}
@@ -0,0 +1,243 @@
+//test_main.cpp
+// MQTT codec: remaining-length encoding, framing, CONNECT/PUBLISH/PINGREQ
+// bytes (CONNECT checked against an independent encoder), and the reader
+// fed CONNACK/PINGRESP streams one byte at a time.
+
+#include <string.h>
+#include <unity.h>
+
+#include "mqtt_packet.h"
+
+// Anonymous, keep-alive 60 s; and with user "home" / "s3cret", 300 s.
+static const char CONNECT_ANON_HEX[] =
+    "103800044d5154540426003c000d6e6f637475612d43304646454500146e6f637475612f4330464645"
+    "452f73746174757300076f66666c696e65";
+static const char CONNECT_AUTH_HEX[] =
+    "104600044d51545404e6012c000d6e6f637475612d43304646454500146e6f637475612f4330464645"
+    "452f73746174757300076f66666c696e650004686f6d650006733363726574";
+
+// ============================================================
+// Helpers
+// ============================================================
+
+static size_t fromHex(const char* hex, uint8_t* out) {
+  size_t n = 0;
+  for (; hex[0] && hex[1]; hex += 2) {
+    auto nib = [](char c) { return (uint8_t)(c <= '9' ? c - '0' : c - 'a' + 10); };
+    out[n++] = (uint8_t)((nib(hex[0]) << 4) | nib(hex[1]));
+  }
+  return n;
+}
+
+static MqttConnectOptions options(const char* user, const char* pass, uint16_t keepAliveS) {
+  MqttConnectOptions o;
+  o.clientId = "noctua-C0FFEE";
+  o.willTopic = "noctua/C0FFEE/status";
+  o.willMessage = "offline";
+  o.user = user;
+  o.pass = pass;
+  o.keepAliveS = keepAliveS;
+  return o;
+}
+
+// Feeds a stream; records the type of each completed packet.
+static size_t feed(MqttPacketReader& r, const uint8_t* data, size_t len, uint8_t* types,
+                   size_t cap) {
+  size_t n = 0;
+  for (size_t i = 0; i < len; i++) {
+    if (r.push(data[i]) && n < cap) types[n++] = r.type();
+  }
+  return n;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+// ============================================================
+// Tests
+// ============================================================
+
+static void test_put_length() {
+  static const struct {
+    uint32_t len;
+    uint8_t bytes[4];
+    size_t n;
+  } CASES[] = {
+    {0, {0x00}, 1},
+    {127, {0x7F}, 1},
+    {128, {0x80, 0x01}, 2},
+    {16383, {0xFF, 0x7F}, 2},
+    {16384, {0x80, 0x80, 0x01}, 3},
+    {2097151, {0xFF, 0xFF, 0x7F}, 3},
+    {2097152, {0x80, 0x80, 0x80, 0x01}, 4},
+    {268435455, {0xFF, 0xFF, 0xFF, 0x7F}, 4},
+  };
+  for (const auto& c : CASES) {
+    uint8_t out[4] = {0};
+    TEST_ASSERT_EQUAL_UINT32(c.n, mqttPutLength(out, c.len));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(c.bytes, out, c.n);
+  }
+}
+
+static void test_frame_moves_body_behind_header() {
+  uint8_t buf[MQTT_HEADER_MAX + 200];
+
+  memcpy(buf + MQTT_HEADER_MAX, "abc", 3);
+  TEST_ASSERT_EQUAL_UINT32(5, mqttFrame(buf, MQTT_PUBLISH_RETAIN, 3));
+  static const uint8_t SHORT[] = {0x31, 0x03, 'a', 'b', 'c'};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(SHORT, buf, sizeof(SHORT));
+
+  // 200 bytes: two length bytes, the body overlaps its new place.
+  for (size_t i = 0; i < 200; i++) buf[MQTT_HEADER_MAX + i] = (uint8_t)i;
+  TEST_ASSERT_EQUAL_UINT32(203, mqttFrame(buf, MQTT_PUBLISH_RETAIN, 200));
+  TEST_ASSERT_EQUAL_HEX8(0x31, buf[0]);
+  TEST_ASSERT_EQUAL_HEX8(0xC8, buf[1]);
+  TEST_ASSERT_EQUAL_HEX8(0x01, buf[2]);
+  for (size_t i = 0; i < 200; i++) TEST_ASSERT_EQUAL_UINT8((uint8_t)i, buf[3 + i]);
+}
+
+static void test_connect_bytes() {
+  uint8_t expect[128];
+  uint8_t buf[256];
+
+  size_t n = fromHex(CONNECT_ANON_HEX, expect);
+  TEST_ASSERT_EQUAL_UINT32(n, mqttBuildConnect(buf, sizeof(buf), options("", "", 60)));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expect, buf, n);
+
+  // A password without a user is not sent.
+  TEST_ASSERT_EQUAL_UINT32(n, mqttBuildConnect(buf, sizeof(buf), options("", "s3cret", 60)));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expect, buf, n);
+
+  n = fromHex(CONNECT_AUTH_HEX, expect);
+  TEST_ASSERT_EQUAL_UINT32(n, mqttBuildConnect(buf, sizeof(buf), options("home", "s3cret", 300)));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expect, buf, n);
+
+  // User without a password: user flag only.
+  TEST_ASSERT_EQUAL_UINT32(n - 8, mqttBuildConnect(buf, sizeof(buf), options("home", "", 300)));
+  TEST_ASSERT_EQUAL_HEX8(0xA6, buf[9]);
+}
+
+static void test_connect_too_long() {
+  uint8_t buf[256];
+  const size_t n = mqttBuildConnect(buf, sizeof(buf), options("home", "s3cret", 300));
+  // The body is built behind room for the longest header.
+  TEST_ASSERT_EQUAL_UINT32(0, mqttBuildConnect(buf, n + MQTT_HEADER_MAX - 3, options("home", "s3cret", 300)));
+  TEST_ASSERT_EQUAL_UINT32(n, mqttBuildConnect(buf, n + MQTT_HEADER_MAX - 2, options("home", "s3cret", 300)));
+}
+
+static void test_publish_bytes() {
+  uint8_t buf[256];
+
+  static const uint8_t PING_OK[] = {0x31, 0x16, 0x00, 0x12, 'n', 'o', 'c', 't', 'u', 'a',
+                                    '/',  'C',  '0',  'F',  'F', 'E', 'E', '/', 'p', 'i',
+                                    'n',  'g',  'o',  'k'};
+  TEST_ASSERT_EQUAL_UINT32(sizeof(PING_OK),
+                           mqttBuildPublish(buf, sizeof(buf), "noctua/C0FFEE/ping", "ok"));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(PING_OK, buf, sizeof(PING_OK));
+
+  // Empty payload (ping_error after a good ping) clears the retained value.
+  TEST_ASSERT_EQUAL_UINT32(4 + 24, mqttBuildPublish(buf, sizeof(buf), "noctua/C0FFEE/ping_error", ""));
+  TEST_ASSERT_EQUAL_HEX8(0x1A, buf[1]);
+
+  // Over 127 bytes: two length bytes.
+  char topic[140];
+  memset(topic, 't', sizeof(topic) - 1);
+  topic[sizeof(topic) - 1] = 0;
+  TEST_ASSERT_EQUAL_UINT32(3 + 2 + 139 + 2, mqttBuildPublish(buf, sizeof(buf), topic, "up"));
+  TEST_ASSERT_EQUAL_HEX8(0x8F, buf[1]);
+  TEST_ASSERT_EQUAL_HEX8(0x01, buf[2]);
+  TEST_ASSERT_EQUAL_HEX8(139, buf[4]);
+
+  TEST_ASSERT_EQUAL_UINT32(0, mqttBuildPublish(buf, 100, topic, "up"));
+}
+
+static void test_pingreq_bytes() {
+  uint8_t buf[4];
+  TEST_ASSERT_EQUAL_UINT32(2, mqttBuildPingReq(buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL_HEX8(0xC0, buf[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x00, buf[1]);
+  TEST_ASSERT_EQUAL_UINT32(0, mqttBuildPingReq(buf, 1));
+}
+
+static void test_reader_connack() {
+  MqttPacketReader r;
+  r.reset();
+
+  static const uint8_t ACCEPTED[] = {0x20, 0x02, 0x00, 0x00};
+  for (size_t i = 0; i < 3; i++) TEST_ASSERT_FALSE(r.push(ACCEPTED[i]));
+  TEST_ASSERT_TRUE(r.push(ACCEPTED[3]));
+  TEST_ASSERT_EQUAL_HEX8(MQTT_CONNACK, r.type() & 0xF0);
+  TEST_ASSERT_EQUAL_UINT32(2, r.bodyKept());
+  TEST_ASSERT_EQUAL_UINT8(0, r.body()[1]);
+
+  static const uint8_t REFUSED[] = {0x20, 0x02, 0x01, 0x05};  // not authorized
+  uint8_t types[2];
+  TEST_ASSERT_EQUAL_UINT32(1, feed(r, REFUSED, sizeof(REFUSED), types, 2));
+  TEST_ASSERT_EQUAL_UINT8(1, r.body()[0]);
+  TEST_ASSERT_EQUAL_UINT8(5, r.body()[1]);
+
+  // Truncated CONNACK: too short to carry a return code.
+  static const uint8_t SHORT[] = {0x20, 0x01, 0x00};
+  TEST_ASSERT_EQUAL_UINT32(1, feed(r, SHORT, sizeof(SHORT), types, 2));
+  TEST_ASSERT_EQUAL_UINT32(1, r.bodyKept());
+}
+
+static void test_reader_stream() {
+  // PINGRESP, a retained PUBLISH echoed by the broker (body skipped, 2-byte
+  // length), PINGRESP, back to back.
+  uint8_t stream[3 + 2 + 130 + 2];
+  size_t n = 0;
+  stream[n++] = 0xD0;
+  stream[n++] = 0x00;
+  stream[n++] = 0x30;
+  stream[n++] = 0x82;
+  stream[n++] = 0x01;
+  for (uint8_t i = 0; i < 130; i++) stream[n++] = i;
+  stream[n++] = 0xD0;
+  stream[n++] = 0x00;
+
+  MqttPacketReader r;
+  r.reset();
+  uint8_t types[4];
+  TEST_ASSERT_EQUAL_UINT32(3, feed(r, stream, n, types, 4));
+  TEST_ASSERT_EQUAL_HEX8(MQTT_PINGRESP, types[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x30, types[1]);
+  TEST_ASSERT_EQUAL_HEX8(MQTT_PINGRESP, types[2]);
+  TEST_ASSERT_FALSE(r.failed());
+}
+
+static void test_reader_bad_length() {
+  MqttPacketReader r;
+  r.reset();
+
+  // Four length bytes is the maximum.
+  static const uint8_t MAX_LEN[] = {0x30, 0xFF, 0xFF, 0xFF, 0x7F};
+  uint8_t types[2];
+  TEST_ASSERT_EQUAL_UINT32(0, feed(r, MAX_LEN, sizeof(MAX_LEN), types, 2));
+  TEST_ASSERT_FALSE(r.failed());
+  TEST_ASSERT_EQUAL_UINT32(268435455, r.length());
+
+  r.reset();
+  static const uint8_t TOO_LONG[] = {0x30, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0xD0, 0x00};
+  TEST_ASSERT_EQUAL_UINT32(0, feed(r, TOO_LONG, sizeof(TOO_LONG), types, 2));
+  TEST_ASSERT_TRUE(r.failed());
+
+  r.reset();
+  static const uint8_t PINGRESP[] = {0xD0, 0x00};
+  TEST_ASSERT_EQUAL_UINT32(1, feed(r, PINGRESP, sizeof(PINGRESP), types, 2));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_put_length);
+  RUN_TEST(test_frame_moves_body_behind_header);
+  RUN_TEST(test_connect_bytes);
+  RUN_TEST(test_connect_too_long);
+  RUN_TEST(test_publish_bytes);
+  RUN_TEST(test_pingreq_bytes);
+  RUN_TEST(test_reader_connack);
+  RUN_TEST(test_reader_stream);
+  RUN_TEST(test_reader_bad_length);
+  return UNITY_END();
+}
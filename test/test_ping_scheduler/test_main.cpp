@@ -0,0 +1,265 @@
+//test_main.cpp
+// Ping scheduler on a fake clock: drift-free slots, device phase,
+// Retry-After / 429 backoff, X-Ping-Interval and the fast-retry budget.
+
+#include <ESP.h>
+#include <unity.h>
+
+#include "ping_scheduler.h"
+
+static const uint32_t INTERVAL_MS = 90000;
+static const uint32_t JITTER_MS = 5000;
+static const uint32_t START_MS = 1000000;
+
+// ============================================================
+// Helpers
+// ============================================================
+
+static ApiPingResult result(int httpCode, bool retryable = false, int32_t retryAfterS = -1,
+                            int32_t intervalHintS = -1) {
+  ApiPingResult r = {};
+  r.ok = httpCode >= 200 && httpCode < 300;
+  r.httpCode = httpCode;
+  r.retryAfterS = retryAfterS;
+  r.intervalHintS = intervalHintS;
+  r.error = r.ok ? ApiError::None : ApiError::Non200;
+  r.retryable = retryable;
+  return r;
+}
+
+// Advances the clock to the next due ping and returns that time.
+static uint32_t runUntilDue() {
+  fakeMillisAdvance(pingSchedMsUntilDue());
+  TEST_ASSERT_TRUE(pingSchedDue());
+  return millis();
+}
+
+// Offset of t from the device's slot grid (phase + k * interval).
+static uint32_t gridOffset(uint32_t t, uint32_t intervalMs) {
+  return (t - START_MS - pingSchedPhaseMs()) % intervalMs;
+}
+
+static PingRetryStats retryStats() {
+  PingRetryStats s;
+  pingSchedGetRetryStats(s);
+  return s;
+}
+
+void setUp() {
+  fakeMillisSet(START_MS);
+  ESP.chipId = 0x00C0FFEE;
+  ESP.seed = 1;
+  pingSchedSetup(INTERVAL_MS);
+  pingSchedRestart(0);
+  pingSchedOnResult(result(200));  // clears the backoff left by a previous test
+}
+
+void tearDown() {}
+
+// ============================================================
+// Tests
+// ============================================================
+
+static void test_phase_from_chip_id() {
+  const uint32_t fraction = ((0x00C0FFEEUL * 2654435761UL) >> 16) & 0xFFFF;
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)(((uint64_t)fraction * INTERVAL_MS) >> 16),
+                           pingSchedPhaseMs());
+  const uint32_t first = pingSchedPhaseMs();
+
+  ESP.chipId = 0x00C0FFEF;
+  pingSchedSetup(INTERVAL_MS);
+  TEST_ASSERT_LESS_THAN_UINT32(INTERVAL_MS, pingSchedPhaseMs());
+  TEST_ASSERT_NOT_EQUAL(first, pingSchedPhaseMs());
+}
+
+static void test_slots_do_not_drift() {
+  const uint32_t first = runUntilDue();
+  TEST_ASSERT_LESS_THAN_UINT32(JITTER_MS, first - START_MS - pingSchedPhaseMs());
+
+  for (uint32_t k = 1; k <= 20; k++) {
+    pingSchedOnStarted();
+    TEST_ASSERT_FALSE(pingSchedDue());
+    fakeMillisAdvance(7000);  // a slow ping must not shift the cadence
+    pingSchedOnResult(result(200));
+
+    const uint32_t due = runUntilDue();
+    const uint32_t slot = START_MS + pingSchedPhaseMs() + k * INTERVAL_MS;
+    TEST_ASSERT_LESS_THAN_UINT32(JITTER_MS, due - slot);
+  }
+}
+
+static void test_missed_slots_are_skipped() {
+  runUntilDue();
+  fakeMillisAdvance(5 * INTERVAL_MS + INTERVAL_MS / 2);  // Wi-Fi was down
+  TEST_ASSERT_TRUE(pingSchedDue());
+  pingSchedOnStarted();
+
+  // One catch-up ping, then the next slot of the grid (half an interval on).
+  TEST_ASSERT_FALSE(pingSchedDue());
+  TEST_ASSERT_LESS_THAN_UINT32(INTERVAL_MS / 2 + JITTER_MS, pingSchedMsUntilDue());
+  const uint32_t due = runUntilDue();
+  TEST_ASSERT_LESS_THAN_UINT32(JITTER_MS, gridOffset(due, INTERVAL_MS));
+}
+
+static void test_start_now_rejoins_phase() {
+  fakeMillisAdvance(12345);
+  pingSchedStartNow();
+  TEST_ASSERT_TRUE(pingSchedDue());
+  TEST_ASSERT_EQUAL_UINT32(0, pingSchedMsUntilDue());
+
+  pingSchedOnStarted();
+  const uint32_t left = pingSchedMsUntilDue();
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(INTERVAL_MS / 2, left);
+  TEST_ASSERT_LESS_THAN_UINT32(INTERVAL_MS + INTERVAL_MS / 2 + JITTER_MS, left);
+  // Phase is taken from the StartNow ping, not from START_MS.
+  TEST_ASSERT_LESS_THAN_UINT32(JITTER_MS, (left - pingSchedPhaseMs()) % INTERVAL_MS);
+}
+
+static void test_retry_after_pushes_slot() {
+  runUntilDue();
+  pingSchedOnStarted();
+  pingSchedOnResult(result(429, false, 120));
+
+  TEST_ASSERT_EQUAL_UINT8(1, pingSchedBackoffLevel());
+  TEST_ASSERT_FALSE(pingSchedDue());  // no quick retry after a 429
+  const uint32_t left = pingSchedMsUntilDue();
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(120000, left);
+  TEST_ASSERT_LESS_THAN_UINT32(120000 + 30000, left);  // spread = min(delay / 4, 30 s)
+
+  // Shorter than the interval: the interval wins.
+  runUntilDue();
+  pingSchedOnStarted();
+  pingSchedOnResult(result(503, false, 10));
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(INTERVAL_MS, pingSchedMsUntilDue());
+  TEST_ASSERT_LESS_THAN_UINT32(INTERVAL_MS + INTERVAL_MS / 4, pingSchedMsUntilDue());
+
+  // Longer than 15 min: capped.
+  runUntilDue();
+  pingSchedOnStarted();
+  pingSchedOnResult(result(429, false, 3600));
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(900000, pingSchedMsUntilDue());
+  TEST_ASSERT_LESS_THAN_UINT32(900000 + 30000, pingSchedMsUntilDue());
+
+  // So large it would wrap once multiplied to ms: still capped, not shortened.
+  runUntilDue();
+  pingSchedOnStarted();
+  pingSchedOnResult(result(429, false, 4294968));
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(900000, pingSchedMsUntilDue());
+  TEST_ASSERT_LESS_THAN_UINT32(900000 + 30000, pingSchedMsUntilDue());
+}
+
+static void test_throttle_backs_off_exponentially() {
+  static const uint32_t EXPECTED[] = {180000, 360000, 720000, 900000, 900000};
+  static const uint8_t LEVEL[] = {1, 2, 3, 4, 4};
+
+  for (uint8_t i = 0; i < 5; i++) {
+    runUntilDue();
+    pingSchedOnStarted();
+    pingSchedOnResult(result(503));
+    TEST_ASSERT_EQUAL_UINT8(LEVEL[i], pingSchedBackoffLevel());
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(EXPECTED[i], pingSchedMsUntilDue());
+    TEST_ASSERT_LESS_THAN_UINT32(EXPECTED[i] + 30000, pingSchedMsUntilDue());
+  }
+
+  runUntilDue();
+  pingSchedOnStarted();
+  pingSchedOnResult(result(200));
+  TEST_ASSERT_EQUAL_UINT8(0, pingSchedBackoffLevel());
+}
+
+static void test_interval_hint() {
+  const uint32_t first = runUntilDue();
+  pingSchedOnStarted();
+  pingSchedOnResult(result(200, false, -1, 300));
+  TEST_ASSERT_EQUAL_UINT32(300000, pingSchedIntervalMs());
+
+  // The slot anchor is kept: the next slot is one new interval after the last.
+  const uint32_t due = runUntilDue();
+  TEST_ASSERT_INT_WITHIN(JITTER_MS, 0, (int32_t)(due - first - 300000));
+
+  pingSchedOnStarted();
+  pingSchedOnResult(result(200, false, -1, 5));
+  TEST_ASSERT_EQUAL_UINT32(30000, pingSchedIntervalMs());
+
+  pingSchedOnResult(result(200, false, -1, 100000));
+  TEST_ASSERT_EQUAL_UINT32(900000, pingSchedIntervalMs());
+
+  // Seconds that would wrap once multiplied to ms (4294968 s -> 704 ms).
+  pingSchedOnResult(result(200, false, -1, 4294968));
+  TEST_ASSERT_EQUAL_UINT32(900000, pingSchedIntervalMs());
+  pingSchedOnResult(result(200, false, -1, INT32_MAX));
+  TEST_ASSERT_EQUAL_UINT32(900000, pingSchedIntervalMs());
+}
+
+static void test_fast_retry_budget_and_backoff() {
+  static const uint32_t BACKOFF[] = {2000, 4000, 8000};
+  const PingRetryStats before = retryStats();
+
+  runUntilDue();
+  pingSchedOnStarted();
+  const uint32_t slotDue = millis() + pingSchedMsUntilDue();
+
+  for (uint8_t i = 0; i < 3; i++) {
+    pingSchedOnResult(result(0, true));
+    const uint32_t left = pingSchedMsUntilDue();
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(BACKOFF[i], left);
+    TEST_ASSERT_LESS_THAN_UINT32(BACKOFF[i] + BACKOFF[i] / 2, left);
+    runUntilDue();
+    pingSchedOnStarted();
+  }
+
+  // Budget used up: the failure stands until the regular slot.
+  pingSchedOnResult(result(0, true));
+  TEST_ASSERT_EQUAL_UINT32(slotDue, millis() + pingSchedMsUntilDue());
+
+  PingRetryStats s = retryStats();
+  TEST_ASSERT_EQUAL_UINT32(before.scheduled + 3, s.scheduled);
+  TEST_ASSERT_EQUAL_UINT32(before.exhausted + 1, s.exhausted);
+
+  // The regular slot renews the budget; a retry that succeeds is counted.
+  TEST_ASSERT_EQUAL_UINT32(slotDue, runUntilDue());
+  pingSchedOnStarted();
+  pingSchedOnResult(result(0, true));
+  runUntilDue();
+  pingSchedOnStarted();
+  pingSchedOnResult(result(200));
+
+  s = retryStats();
+  TEST_ASSERT_EQUAL_UINT32(before.scheduled + 4, s.scheduled);
+  TEST_ASSERT_EQUAL_UINT32(before.recovered + 1, s.recovered);
+}
+
+static void test_fast_retry_guard_and_not_retryable() {
+  const PingRetryStats before = retryStats();
+
+  runUntilDue();
+  pingSchedOnStarted();
+  const uint32_t slotDue = millis() + pingSchedMsUntilDue();
+
+  pingSchedOnResult(result(401));
+  TEST_ASSERT_EQUAL_UINT32(slotDue, millis() + pingSchedMsUntilDue());
+
+  // Next slot 11 s away: a 2-3 s retry would land inside the 10 s guard.
+  fakeMillisSet(slotDue - 11000);
+  pingSchedOnResult(result(0, true));
+  TEST_ASSERT_EQUAL_UINT32(11000, pingSchedMsUntilDue());
+
+  const PingRetryStats s = retryStats();
+  TEST_ASSERT_EQUAL_UINT32(before.notRetryable + 1, s.notRetryable);
+  TEST_ASSERT_EQUAL_UINT32(before.exhausted + 1, s.exhausted);
+  TEST_ASSERT_EQUAL_UINT32(before.scheduled, s.scheduled);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_phase_from_chip_id);
+  RUN_TEST(test_slots_do_not_drift);
+  RUN_TEST(test_missed_slots_are_skipped);
+  RUN_TEST(test_start_now_rejoins_phase);
+  RUN_TEST(test_retry_after_pushes_slot);
+  RUN_TEST(test_throttle_backs_off_exponentially);
+  RUN_TEST(test_interval_hint);
+  RUN_TEST(test_fast_retry_budget_and_backoff);
+  RUN_TEST(test_fast_retry_guard_and_not_retryable);
+  return UNITY_END();
+}
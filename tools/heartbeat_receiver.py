@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""Stand-in receiver for the UDP heartbeat, to try the transport on a LAN.
+
+Build the firmware against it:
+
+    -DNOCTUA_HEARTBEAT_UDP_HOST=\\"192.168.1.50\\"
+
+then run
+
+    tools/heartbeat_receiver.py --key <channel key> [--key <another>]
+
+Wire format (all integers big-endian, mac = HMAC-SHA-256(channel key,
+preceding bytes) truncated to 16 bytes; the key itself never travels):
+
+  Heartbeat, 42 bytes
+    0  "NHB1"
+    4  flags          bit0: ack wanted
+    5  0
+    6  boot nonce[4]  fresh random value per boot
+   10  seq[4]         1, 2, ... per boot; a retransmit repeats it
+   14  uptime_s[4]
+   18  key id[8]      SHA-256(channel key)[0..8)
+   26  mac[16]
+
+  Ack, 34 bytes
+    0  "NHA1"
+    4  status         0 ok, 1 unknown key, 2 throttled, 3 server error
+    5  0
+    6  boot nonce[4]  copied from the heartbeat
+   10  seq[4]         copied from the heartbeat
+   14  interval_s[2]  ping interval hint, 0 = none
+   16  retry_after_s[2]  0 = none
+   18  mac[16]
+
+  Last gasp, 42 bytes, never acked, sent twice when the supply fails:
+    the heartbeat layout with "NLG1", flags 0 and the last heartbeat's seq.
+
+The unit waits 600 ms for an ack and resends the same datagram, doubling
+the wait: sends at 0, 0.6 and 1.8 s, gives up at 4.2 s. A receiver keys
+replays on (type, key id, nonce, seq): a repeated seq is a retransmit and
+is acked again, an older one is dropped. An unknown key id cannot be
+MACed; it gets an unsigned status-1 ack, which the unit rejects as bad.
+
+--drop N ignores the first N copies of every heartbeat, to watch the
+retransmits; --throttle S answers "throttled" with Retry-After S.
+"""
+
+import argparse
+import hashlib
+import hmac
+import socket
+import struct
+import time
+
+HB_LEN = 42
+HB_MAC_AT = 26
+ACK_MAC_AT = 18
+MAC_LEN = 16
+
+
+def key_id(key):
+    return hashlib.sha256(key).digest()[:8]
+
+
+def mac(key, data):
+    return hmac.new(key, data, hashlib.sha256).digest()[:MAC_LEN]
+
+
+def build_ack(key, nonce, seq, status, interval_s=0, retry_after_s=0):
+    head = b"NHA1" + struct.pack(">BBIIHH", status, 0, nonce, seq, interval_s, retry_after_s)
+    return head + (mac(key, head) if key else bytes(MAC_LEN))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--bind", default="0.0.0.0")
+    ap.add_argument("--port", type=int, default=7710)
+    ap.add_argument("--key", action="append", required=True, help="channel key (repeatable)")
+    ap.add_argument("--interval", type=int, default=0, help="interval hint sent in acks (s)")
+    ap.add_argument("--throttle", type=int, default=0, help="answer 'throttled' with this Retry-After (s)")
+    ap.add_argument("--drop", type=int, default=0, help="ignore the first N copies of each heartbeat")
+    args = ap.parse_args()
+
+    keys = {key_id(k.encode()): k.encode() for k in args.key}
+    last_seq = {}  # (type, key id, nonce) -> highest seq seen
+    copies = {}    # (key id, nonce, seq) -> copies received
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((args.bind, args.port))
+    print("listening on %s:%d, %d key(s)" % (args.bind, args.port, len(keys)))
+
+    while True:
+        data, peer = sock.recvfrom(512)
+        now = time.strftime("%H:%M:%S")
+        if len(data) != HB_LEN or data[:4] not in (b"NHB1", b"NLG1"):
+            print("%s %s junk (%d bytes)" % (now, peer[0], len(data)))
+            continue
+
+        kind = data[:4].decode()
+        flags, nonce, seq, uptime = data[4], *struct.unpack(">III", data[6:18])
+        kid = data[18:26]
+        key = keys.get(kid)
+        tag = "%s %s %s nonce=%08x seq=%u up=%us" % (now, peer[0], kind, nonce, seq, uptime)
+
+        if key is None:
+            print(tag + " unknown key id %s" % kid.hex())
+            if kind == "NHB1" and flags & 1:
+                sock.sendto(build_ack(None, nonce, seq, 1), peer)
+            continue
+        if not hmac.compare_digest(data[HB_MAC_AT:], mac(key, data[:HB_MAC_AT])):
+            print(tag + " bad mac")
+            continue
+
+        slot = (kind, kid, nonce)
+        if seq < last_seq.get(slot, 0):
+            print(tag + " replay, dropped")
+            continue
+        repeat = seq == last_seq.get(slot)
+        last_seq[slot] = seq
+
+        if kind == "NLG1":
+            if not repeat:
+                print(tag + " LAST GASP")
+            continue
+
+        if len(copies) > 4096:
+            copies.clear()
+        n = copies.get((kid, nonce, seq), 0) + 1
+        copies[(kid, nonce, seq)] = n
+        if n <= args.drop:
+            print(tag + " copy %d dropped (--drop)" % n)
+            continue
+        print(tag + (" retransmit %d" % n if n > 1 else ""))
+
+        if flags & 1:
+            status, retry = (2, args.throttle) if args.throttle else (0, 0)
+            sock.sendto(build_ack(key, nonce, seq, status, args.interval, retry), peer)
+
+
+if __name__ == "__main__":
+    main()
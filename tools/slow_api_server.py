@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Slow stand-in for the ping API, to measure how long loop() stalls.
+
+Build the firmware against it:
+
+    -DNOCTUA_API_HOST=\\"192.168.1.50\\" -DNOCTUA_API_PORT=8080
+
+then run
+
+    tools/slow_api_server.py --port 8080 --device 192.168.1.77
+
+Every ping gets the next scenario in turn (or only --scenario). With
+--device, the unit's /status.json is read after each ping and the worst
+loop() pass during that ping (loop_max_ping_us) is printed next to it; a
+non-blocking ping keeps it in the low milliseconds whatever the server does.
+
+Scenarios:
+  slow     first byte after --first-byte-delay, then the reply trickled
+           one byte every --byte-delay seconds (Content-Length framed)
+  chunked  the same, chunked, split inside chunk headers
+  hang     accepts and reads the request but never answers (response timeout)
+  close    accepts and closes at once (no status line)
+  ok       answers right away (baseline)
+"""
+
+import argparse
+import itertools
+import json
+import socket
+import threading
+import time
+import urllib.request
+
+SCENARIOS = ("slow", "chunked", "hang", "close", "ok")
+
+OK_BODY = b"ok"
+
+
+def reply_plain():
+    return (b"HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: %d\r\n\r\n" % len(OK_BODY)) + OK_BODY
+
+
+def reply_chunked():
+    return (b"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+            b"1;x=y\r\no\r\n1\r\nk\r\n0\r\n\r\n")
+
+
+def read_request(conn, timeout):
+    conn.settimeout(timeout)
+    data = b""
+    try:
+        while b"\r\n\r\n" not in data:
+            part = conn.recv(1024)
+            if not part:
+                break
+            data += part
+    except socket.timeout:
+        pass
+    return data.split(b"\r\n", 1)[0].decode("latin-1", "replace")
+
+
+def trickle(conn, data, first_delay, byte_delay):
+    time.sleep(first_delay)
+    for i in range(len(data)):
+        conn.sendall(data[i:i + 1])
+        time.sleep(byte_delay)
+
+
+def serve_one(conn, scenario, args):
+    line = read_request(conn, args.hang)
+    started = time.monotonic()
+    try:
+        if scenario == "close":
+            pass
+        elif scenario == "hang":
+            time.sleep(args.hang)
+        elif scenario == "ok":
+            conn.sendall(reply_plain())
+        elif scenario == "chunked":
+            trickle(conn, reply_chunked(), args.first_byte_delay, args.byte_delay)
+        else:
+            trickle(conn, reply_plain(), args.first_byte_delay, args.byte_delay)
+    except OSError as e:
+        print("  send failed: %s" % e)
+    finally:
+        conn.close()
+    return line, time.monotonic() - started
+
+
+def device_loop_max(device):
+    try:
+        with urllib.request.urlopen("http://%s/status.json" % device, timeout=3) as r:
+            s = json.load(r)
+        return s.get("loop_max_ping_us"), s.get("loop_max_us")
+    except (OSError, ValueError) as e:
+        return "n/a (%s)" % e, None
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--bind", default="0.0.0.0")
+    ap.add_argument("--port", type=int, default=8080)
+    ap.add_argument("--scenario", choices=SCENARIOS, help="always use this one")
+    ap.add_argument("--first-byte-delay", type=float, default=3.0)
+    ap.add_argument("--byte-delay", type=float, default=0.05)
+    ap.add_argument("--hang", type=float, default=10.0, help="seconds a 'hang' connection is held")
+    ap.add_argument("--device", help="unit address; prints its loop timing after each ping")
+    args = ap.parse_args()
+
+    order = itertools.cycle([args.scenario] if args.scenario else SCENARIOS)
+    srv = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    srv.bind((args.bind, args.port))
+    srv.listen(4)
+    print("listening on %s:%d" % (args.bind, args.port))
+
+    def handle(conn, peer, scenario):
+        line, took = serve_one(conn, scenario, args)
+        msg = "%s %-8s %5.1f s  %s" % (peer[0], scenario, took, line)
+        if args.device:
+            # Let the unit finish the ping and publish the figure.
+            time.sleep(1.0)
+            ping_us, any_us = device_loop_max(args.device)
+            msg += "  | loop_max_ping_us=%s loop_max_us=%s" % (ping_us, any_us)
+        print(msg, flush=True)
+
+    while True:
+        conn, peer = srv.accept()
+        threading.Thread(target=handle, args=(conn, peer, next(order)), daemon=True).start()
+
+
+if __name__ == "__main__":
+    main()